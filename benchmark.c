@@ -0,0 +1,414 @@
+/* BENCHMARK.C
+ *
+ * End to end scaling benchmark. Sweeps engines, thread counts and point counts, running
+ * warmup estimations and then timed repetitions on the same engine, so thread creation is
+ * not measured. Reports samples per second, its standard deviation and the parallel
+ * efficiency as CSV or JSON, to compare scaling between builds.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <math.h>
+#include <getopt.h>
+#include "engine.h"
+#include "kernel.h"
+#include "stats.h"
+
+// Most engines, thread counts or point counts in one sweep
+#define BENCHMARK_MAX_VALUES 64
+
+/* Enum: OutputFormat
+ * Format of the results.
+ */
+typedef enum OutputFormatEnum{
+    FORMAT_CSV,
+    FORMAT_JSON
+}OutputFormat;
+
+/* Structure: Result
+ * Measurements of one engine, thread count and point count.
+ *
+ * @variable engineType       - The engine measured
+ * @variable threadCount      - Number of worker threads
+ * @variable pointCount       - Number of points of each estimation
+ * @variable seconds          - Mean time of one estimation in seconds
+ * @variable samplesPerSecond - Mean points per second over the repetitions
+ * @variable stddev           - Standard deviation of the points per second
+ * @variable efficiency       - samplesPerSecond / (threadCount * single thread samplesPerSecond)
+ * @variable area             - Area of the last estimation, to check the run is sane
+ */
+typedef struct ResultStruct{
+    EngineType engineType;
+    int threadCount;
+    uint64_t pointCount;
+    double seconds;
+    double samplesPerSecond;
+    double stddev;
+    double efficiency;
+    double area;
+}Result;
+
+static const struct option longOptions[] = {
+    {"engines", required_argument, NULL, 'm'},
+    {"threads", required_argument, NULL, 't'},
+    {"points", required_argument, NULL, 'p'},
+    {"warmups", required_argument, NULL, 'w'},
+    {"repetitions", required_argument, NULL, 'n'},
+    {"format", required_argument, NULL, 'f'},
+    {"output", required_argument, NULL, 'o'},
+    {"generator", required_argument, NULL, 'g'},
+    {"kernel", required_argument, NULL, 'k'},
+    {"precision", required_argument, NULL, 'P'},
+    {"affinity", required_argument, NULL, 'a'},
+    {"strategy", required_argument, NULL, 's'},
+    {NULL, 0, NULL, 0}
+};
+
+/*
+ * Function: parsePointCounts
+ * ------------------------
+ * Parses a comma separated list of point counts.
+ *
+ * @param *text        - The command line argument
+ * @param *pointCounts - Filled with the parsed counts, BENCHMARK_MAX_VALUES at most
+ *
+ * @return int of the number of counts parsed, 0 if the list is invalid
+ */
+static int parsePointCounts(const char *text, uint64_t *pointCounts){
+    int count = 0;
+
+    while(*text != '\0' && count < BENCHMARK_MAX_VALUES){
+        char *end;
+        errno = 0;
+        unsigned long long value = strtoull(text, &end, 10);
+        if(errno != 0 || end == text || value == 0 || *text == '-' || (*end != ',' && *end != '\0')){
+            return 0;
+        }
+        pointCounts[count++] = value;
+        text = *end == ',' ? end + 1 : end;
+    }
+    return *text == '\0' ? count : 0;
+}
+
+/*
+ * Function: parseEngines
+ * ------------------------
+ * Parses a comma separated list of engine names.
+ *
+ * @param *text    - The command line argument
+ * @param *engines - Filled with the parsed engines, BENCHMARK_MAX_VALUES at most
+ *
+ * @return int of the number of engines parsed, 0 if a name is unknown
+ */
+static int parseEngines(const char *text, EngineType *engines){
+    char names[256];
+    int count = 0;
+
+    snprintf(names, sizeof(names), "%s", text);
+    for(char *name = strtok(names, ","); name != NULL && count < BENCHMARK_MAX_VALUES; name = strtok(NULL, ",")){
+        if(!engineTypeFromName(name, &engines[count++])){
+            fprintf(stderr, "Unknown engine: %s\n", name);
+            return 0;
+        }
+    }
+    return count;
+}
+
+/*
+ * Function: sweepThreadCounts
+ * ------------------------
+ * Thread counts of a sweep up to maxThreads: powers of two, then maxThreads itself.
+ *
+ * @param maxThreads    - Largest thread count
+ * @param *threadCounts - Filled with the thread counts
+ *
+ * @return int of the number of thread counts
+ */
+static int sweepThreadCounts(int maxThreads, int *threadCounts){
+    int count = 0;
+
+    for(int threads = 1; threads < maxThreads && count < BENCHMARK_MAX_VALUES - 1; threads *= 2){
+        threadCounts[count++] = threads;
+    }
+    threadCounts[count++] = maxThreads;
+    return count;
+}
+
+/*
+ * Function: measure
+ * ------------------------
+ * Runs the warmups and timed repetitions of one engine and point count.
+ *
+ * @param *engine      - The engine to run
+ * @param pointCount   - Number of points of each estimation
+ * @param warmups      - Untimed estimations run first
+ * @param repetitions  - Timed estimations
+ * @param *result      - Filled with the measurements, except efficiency
+ */
+static void measure(Engine *engine, uint64_t pointCount, int warmups, int repetitions, Result *result){
+    double mean = 0, m2 = 0, totalSeconds = 0;
+
+    for(int i = 0; i < warmups; i++){
+        result->area = engineRun(engine, pointCount, 1.0);
+    }
+    for(int i = 1; i <= repetitions; i++){
+        double start = monotonicSeconds();
+        result->area = engineRun(engine, pointCount, 1.0);
+        double seconds = monotonicSeconds() - start;
+
+        // Welford's algorithm over the samples per second of each repetition
+        double samplesPerSecond = (double)pointCount / seconds;
+        double delta = samplesPerSecond - mean;
+        mean += delta / i;
+        m2 += delta * (samplesPerSecond - mean);
+        totalSeconds += seconds;
+    }
+
+    result->pointCount = pointCount;
+    result->seconds = totalSeconds / repetitions;
+    result->samplesPerSecond = mean;
+    result->stddev = repetitions > 1 ? sqrt(m2 / (repetitions - 1)) : 0;
+}
+
+/*
+ * Function: printResults
+ * ------------------------
+ * Writes every result as CSV, one header line then one line per result, or as a JSON array.
+ *
+ * @param *file        - Where to write the results
+ * @param format       - CSV or JSON
+ * @param *results     - The results
+ * @param resultCount  - Number of results
+ * @param *options     - Settings shared by every engine
+ * @param repetitions  - Timed estimations of each result
+ */
+static void printResults(FILE *file, OutputFormat format, const Result *results, int resultCount,
+                         const EngineOptions *options, int repetitions){
+    const char *kernel = kernelTypeName(kernelSelected());
+    const char *precision = precisionName(kernelSelectedPrecision());
+    const char *generator = randomTypeName(options->randomType);
+    const char *strategy = strategyName(options->strategy);
+
+    if(format == FORMAT_CSV){
+        fprintf(file, "engine,threads,points,repetitions,kernel,precision,generator,strategy,"
+                      "mean_seconds,samples_per_second,stddev_samples_per_second,efficiency,area\n");
+        for(int i = 0; i < resultCount; i++){
+            const Result *r = &results[i];
+            fprintf(file, "%s,%d,%" PRIu64 ",%d,%s,%s,%s,%s,%.9f,%.1f,%.1f,%.4f,%.6f\n",
+                    engineTypeName(r->engineType), r->threadCount, r->pointCount, repetitions, kernel, precision,
+                    generator, r->engineType == ENGINE_SHARED ? strategy : "", r->seconds, r->samplesPerSecond,
+                    r->stddev, r->efficiency, r->area);
+        }
+        return;
+    }
+
+    fprintf(file, "[\n");
+    for(int i = 0; i < resultCount; i++){
+        const Result *r = &results[i];
+        fprintf(file, "  {\"engine\": \"%s\", \"threads\": %d, \"points\": %" PRIu64 ", \"repetitions\": %d, "
+                      "\"kernel\": \"%s\", \"precision\": \"%s\", \"generator\": \"%s\", \"strategy\": \"%s\", "
+                      "\"mean_seconds\": %.9f, "
+                      "\"samples_per_second\": %.1f, \"stddev_samples_per_second\": %.1f, \"efficiency\": %.4f, "
+                      "\"area\": %.6f}%s\n",
+                engineTypeName(r->engineType), r->threadCount, r->pointCount, repetitions, kernel, precision,
+                generator, r->engineType == ENGINE_SHARED ? strategy : "", r->seconds, r->samplesPerSecond, r->stddev,
+                r->efficiency, r->area, i + 1 < resultCount ? "," : "");
+    }
+    fprintf(file, "]\n");
+}
+
+/*
+ * Function: main
+ * ------------------------
+ * Runs the benchmark sweep and prints the results.
+ *
+ * @param argc - Number of command line arguments provided
+ * @param *argv[] - array of pointers to the command line arguments
+ *        argv[0] - The name of the this executable file.
+ *        argv[1...n]:
+ *          [-m, --engines]     comma separated engines to run: serial,sharded,shared (default)
+ *          [-t, --threads]     largest thread count, the sweep runs 1, 2, 4, ... up to it.
+ *                              Defaults to the number of CPUs. The serial engine only runs 1.
+ *          [-p, --points]      comma separated point counts (default 10000000,100000000)
+ *          [-w, --warmups]     untimed estimations before each measurement (default 1)
+ *          [-n, --repetitions] timed estimations of each measurement (default 5)
+ *          [-f, --format]      csv (default) or json
+ *          [-o, --output]      file to write the results to, instead of stdout
+ *          [-g, --generator]   random number generator: xoshiro (default) or philox
+ *          [-k, --kernel]      sampling kernel: auto (default), scalar, sse2, avx2, avx512 or fixed
+ *          [-P, --precision]   kernel precision: auto (default, chosen for the largest point count),
+ *                              double or float
+ *          [-a, --affinity]    worker thread affinity: none (default), compact or scatter
+ *          [-s, --strategy]    shared engine strategy: mutex, atomic, batched (default) or sharded
+ *
+ * @return int of how program exits
+ */
+int main(int argc, char *argv[]){
+    EngineType engines[BENCHMARK_MAX_VALUES] = {ENGINE_SERIAL, ENGINE_SHARDED, ENGINE_SHARED};
+    int engineCount = 3;
+    uint64_t pointCounts[BENCHMARK_MAX_VALUES] = {10000000, 100000000};
+    int pointCountCount = 2;
+    int maxThreads = cpuCount();
+    int warmups = 1;
+    int repetitions = 5;
+    OutputFormat format = FORMAT_CSV;
+    const char *outputPath = NULL;
+    KernelType kernelType = KERNEL_AUTO;
+    Precision precision = PRECISION_AUTO;
+    EngineOptions options = {
+        .threadCount = 1,
+        .randomType = RANDOM_XOSHIRO,
+        .affinity = AFFINITY_NONE,
+        .strategy = STRATEGY_BATCHED,
+        .instrument = 0,
+        .sequence = SEQUENCE_RANDOM,
+        .estimatorType = ESTIMATOR_HIT,
+        .seed = 1 // Fixed, so every thread count and build gives the same area for a point count
+    };
+    int c;
+
+    // Retrieving Arguments
+    while((c = getopt_long(argc, argv, "m:t:p:w:n:f:o:g:k:P:a:s:", longOptions, NULL)) != -1){
+        switch(c){
+            case 'm': // Engines
+                if((engineCount = parseEngines(optarg, engines)) == 0){
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 't': // Largest thread count
+                maxThreads = atoi(optarg);
+                break;
+            case 'p': // Point counts
+                if((pointCountCount = parsePointCounts(optarg, pointCounts)) == 0){
+                    fprintf(stderr, "Invalid list of point counts: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'w': // Warmups
+                warmups = atoi(optarg);
+                break;
+            case 'n': // Repetitions
+                repetitions = atoi(optarg);
+                break;
+            case 'f': // Output format
+                if(strcmp(optarg, "csv") == 0){
+                    format = FORMAT_CSV;
+                } else if(strcmp(optarg, "json") == 0){
+                    format = FORMAT_JSON;
+                } else {
+                    fprintf(stderr, "Unknown output format: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'o': // Output file
+                outputPath = optarg;
+                break;
+            case 'g': // Random number generator
+                if(!randomTypeFromName(optarg, &options.randomType)){
+                    fprintf(stderr, "Unknown random number generator: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'k': // Sampling kernel
+                if(!kernelTypeFromName(optarg, &kernelType)){
+                    fprintf(stderr, "Unknown sampling kernel: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'P': // Kernel precision
+                if(!precisionFromName(optarg, &precision)){
+                    fprintf(stderr, "Unknown precision: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'a': // Thread affinity
+                if(!affinityFromName(optarg, &options.affinity)){
+                    fprintf(stderr, "Unknown affinity policy: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 's': // Shared total strategy
+                if(!strategyFromName(optarg, &options.strategy)){
+                    fprintf(stderr, "Unknown strategy: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            default:
+                return EXIT_FAILURE;
+        }
+    }
+    if(maxThreads < 1 || warmups < 0 || repetitions < 1){
+        fprintf(stderr, "Thread count and repetitions must be at least 1, warmups at least 0\n");
+        return EXIT_FAILURE;
+    }
+    if(precision == PRECISION_AUTO){
+        uint64_t largestPointCount = 0;
+        for(int i = 0; i < pointCountCount; i++){
+            largestPointCount = pointCounts[i] > largestPointCount ? pointCounts[i] : largestPointCount;
+        }
+        precision = precisionFor(largestPointCount, 0, 1.0);
+    }
+    if(!kernelSelect(kernelType, precision)){
+        fprintf(stderr, "Sampling kernel %s is not supported by this CPU\n", kernelTypeName(kernelType));
+        return EXIT_FAILURE;
+    }
+
+    int threadCounts[BENCHMARK_MAX_VALUES];
+    int threadCountCount = sweepThreadCounts(maxThreads, threadCounts);
+    Result *results = malloc(sizeof(Result) * engineCount * threadCountCount * pointCountCount);
+    if(results == NULL){
+        perror("Error allocating Results: ");
+        return EXIT_FAILURE;
+    }
+    int resultCount = 0;
+
+    for(int e = 0; e < engineCount; e++){
+        int firstResult = resultCount;
+
+        for(int t = 0; t < threadCountCount; t++){
+            if(engines[e] == ENGINE_SERIAL && threadCounts[t] > 1){
+                break;
+            }
+            // One engine per thread count, reused for every point count
+            Engine engine;
+            options.threadCount = threadCounts[t];
+            if(!engineCreate(&engine, engines[e], &options)){
+                perror("Error creating Engine: ");
+                free(results);
+                return EXIT_FAILURE;
+            }
+            for(int p = 0; p < pointCountCount; p++){
+                Result *result = &results[resultCount++];
+                result->engineType = engines[e];
+                result->threadCount = threadCounts[t];
+                measure(&engine, pointCounts[p], warmups, repetitions, result);
+                fprintf(stderr, "%s, %d threads, %" PRIu64 " points: %.3e samples/s\n",
+                        engineTypeName(engines[e]), threadCounts[t], pointCounts[p], result->samplesPerSecond);
+            }
+            engineDestroy(&engine);
+        }
+
+        // Efficiency against the single thread run of the same engine and point count
+        for(int i = firstResult; i < resultCount; i++){
+            const Result *single = &results[firstResult + (i - firstResult) % pointCountCount];
+            results[i].efficiency = results[i].samplesPerSecond / (results[i].threadCount * single->samplesPerSecond);
+        }
+    }
+
+    FILE *file = stdout;
+    if(outputPath != NULL && (file = fopen(outputPath, "w")) == NULL){
+        perror("Error opening output file: ");
+        free(results);
+        return EXIT_FAILURE;
+    }
+    printResults(file, format, results, resultCount, &options, repetitions);
+    if(file != stdout){
+        fclose(file);
+    }
+    free(results);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,318 @@
+/* CHECKPOINT.C
+ *
+ * Checkpoint file and writer thread. See checkpoint.h.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include "checkpoint.h"
+
+/*
+ * Function: sameRun
+ * ------------------------
+ * @param *a - Header of a run
+ * @param *b - Header of another run
+ *
+ * @return int of 1 if the headers identify the same run, otherwise returns 0
+ */
+static int sameRun(const CheckpointHeader *a, const CheckpointHeader *b){
+    return a->seed == b->seed && a->pointCount == b->pointCount && a->radius == b->radius &&
+           a->randomType == b->randomType && a->estimatorType == b->estimatorType &&
+           a->sequence == b->sequence && a->precision == b->precision && a->fixedPoint == b->fixedPoint;
+}
+
+/*
+ * Function: readCheckpoint
+ * ------------------------
+ * Reads the header and ranges of a checkpoint file of the run.
+ *
+ * @param *checkpoint - The checkpoint, whose header holds the run
+ * @param *file       - The open checkpoint file
+ *
+ * @return int of 1 if the file is a checkpoint of the run, otherwise returns 0
+ */
+static int readCheckpoint(Checkpoint *checkpoint, FILE *file){
+    CheckpointHeader header;
+
+    if(fread(&header, sizeof(header), 1, file) != 1 || header.magic != CHECKPOINT_MAGIC ||
+       header.version != CHECKPOINT_VERSION || !sameRun(&header, &checkpoint->header) ||
+       header.rangeCount > header.pointCount){
+        return 0;
+    }
+    checkpoint->ranges = malloc(sizeof(uint64_t) * 2 * (header.rangeCount + 1));
+    if(checkpoint->ranges == NULL ||
+       fread(checkpoint->ranges, sizeof(uint64_t) * 2, header.rangeCount, file) != header.rangeCount){
+        return 0;
+    }
+    checkpoint->header = header;
+    return 1;
+}
+
+/*
+ * Function: checkpointOpen
+ * ------------------------
+ * Opens the checkpoint of a run. If the file exists its finished chunks are restored when
+ * the run starts, otherwise the run starts from nothing.
+ *
+ * @param *checkpoint - The checkpoint to open
+ * @param *path       - Path of the checkpoint file
+ * @param interval    - Seconds between two saves
+ * @param *run        - The run: every field up to and including fixedPoint is set
+ *
+ * @return int of 1 on success, 0 if the file could not be read or is of another run
+ */
+int checkpointOpen(Checkpoint *checkpoint, const char *path, double interval, const CheckpointHeader *run){
+    memset(checkpoint, 0, sizeof(*checkpoint));
+    checkpoint->header = *run;
+    checkpoint->header.magic = CHECKPOINT_MAGIC;
+    checkpoint->header.version = CHECKPOINT_VERSION;
+    checkpoint->header.chunkPoints = 0;
+    checkpoint->header.points = 0;
+    checkpoint->header.score = 0;
+    checkpoint->header.rangeCount = 0;
+    checkpoint->interval = interval;
+    pthread_mutex_init(&checkpoint->mutex, NULL);
+    pthread_cond_init(&checkpoint->wake, NULL);
+
+    checkpoint->path = strdup(path);
+    checkpoint->temporaryPath = malloc(strlen(path) + sizeof(".tmp"));
+    if(checkpoint->path == NULL || checkpoint->temporaryPath == NULL){
+        checkpointClose(checkpoint);
+        return 0;
+    }
+    sprintf(checkpoint->temporaryPath, "%s.tmp", path);
+
+    FILE *file = fopen(path, "rb");
+    if(file == NULL){
+        if(errno == ENOENT){
+            return 1;
+        }
+        checkpointClose(checkpoint);
+        return 0;
+    }
+    int read = readCheckpoint(checkpoint, file);
+    fclose(file);
+    if(!read){
+        checkpointClose(checkpoint);
+    }
+    return read;
+}
+
+/*
+ * Function: setChunks
+ * ------------------------
+ * Sets the bits of the chunks first to end - 1.
+ *
+ * @param *bits  - Bit per chunk
+ * @param first  - First chunk
+ * @param end    - One past the last chunk
+ */
+static void setChunks(uint8_t *bits, uint64_t first, uint64_t end){
+    for(uint64_t chunk = first; chunk < end; chunk++){
+        bits[chunk / 8] |= (uint8_t)(1U << (chunk % 8));
+    }
+}
+
+/*
+ * Function: checkpointSave
+ * ------------------------
+ * Writes the chunks finished so far to the checkpoint file. The finished chunks are copied
+ * under the mutex, the file is written without it. Only one save runs at a time, the
+ * writer thread's or checkpointFinish's once it has stopped, so they share the buffers.
+ *
+ * @param *checkpoint - The checkpoint
+ *
+ * @return int of 1 if the file was written, otherwise returns 0
+ */
+static int checkpointSave(Checkpoint *checkpoint){
+    uint64_t bytes = (checkpoint->chunkCount + 7) / 8;
+    uint8_t *done = checkpoint->saveDone;
+    uint64_t *ranges = checkpoint->saveRanges;
+
+    pthread_mutex_lock(&checkpoint->mutex);
+    CheckpointHeader header = checkpoint->header;
+    memcpy(done, checkpoint->done, bytes);
+    checkpoint->dirty = 0;
+    pthread_mutex_unlock(&checkpoint->mutex);
+
+    header.rangeCount = 0;
+    for(uint64_t chunk = 0; chunk < checkpoint->chunkCount; chunk++){
+        if(!((done[chunk / 8] >> (chunk % 8)) & 1)){
+            continue;
+        }
+        if(header.rangeCount > 0 && ranges[2 * header.rangeCount - 1] == chunk){
+            ranges[2 * header.rangeCount - 1] = chunk + 1;
+        } else {
+            ranges[2 * header.rangeCount] = chunk;
+            ranges[2 * header.rangeCount + 1] = chunk + 1;
+            header.rangeCount++;
+        }
+    }
+
+    int written = 0;
+    FILE *file = fopen(checkpoint->temporaryPath, "wb");
+    if(file != NULL){
+        written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                  fwrite(ranges, sizeof(uint64_t) * 2, header.rangeCount, file) == header.rangeCount &&
+                  fflush(file) == 0 && fsync(fileno(file)) == 0;
+        written = fclose(file) == 0 && written;
+    }
+    written = written && rename(checkpoint->temporaryPath, checkpoint->path) == 0;
+    if(!written){
+        perror("Error writing checkpoint");
+    }
+    return written;
+}
+
+/*
+ * Function: checkpointWriter
+ * ------------------------
+ * Writer thread. Saves the checkpoint every interval while chunks have finished since the
+ * last save, until the run is over.
+ *
+ * @param *c - void pointer to the checkpoint
+ *
+ * @return void* of NULL
+ */
+static void* checkpointWriter(void *c){
+    Checkpoint *checkpoint = (Checkpoint*) c;
+
+    pthread_mutex_lock(&checkpoint->mutex);
+    while(!checkpoint->stopping){
+        struct timespec until;
+        clock_gettime(CLOCK_REALTIME, &until);
+        double seconds = until.tv_nsec / 1e9 + checkpoint->interval;
+        until.tv_sec += (time_t) seconds;
+        until.tv_nsec = (long)((seconds - (double)(time_t) seconds) * 1e9);
+        pthread_cond_timedwait(&checkpoint->wake, &checkpoint->mutex, &until);
+
+        if(checkpoint->dirty && !checkpoint->stopping){
+            pthread_mutex_unlock(&checkpoint->mutex);
+            checkpointSave(checkpoint);
+            pthread_mutex_lock(&checkpoint->mutex);
+        }
+    }
+    pthread_mutex_unlock(&checkpoint->mutex);
+    return NULL;
+}
+
+/*
+ * Function: checkpointStart
+ * ------------------------
+ * Restores the chunks finished before the run started, allocates the buffers of the saves
+ * and starts the writer thread. Called by the engine once the chunks of the run are known.
+ *
+ * @param *checkpoint  - The checkpoint
+ * @param chunkPoints  - Number of points in each chunk of the scheduler
+ *
+ * @return int of 1 on success, 0 if the chunks do not match the checkpoint file or the
+ *         writer could not be started
+ */
+int checkpointStart(Checkpoint *checkpoint, uint64_t chunkPoints){
+    CheckpointHeader *header = &checkpoint->header;
+
+    if(header->chunkPoints != 0 && header->chunkPoints != chunkPoints){
+        return 0;
+    }
+    header->chunkPoints = chunkPoints;
+    checkpoint->chunkCount = header->pointCount / chunkPoints + (header->pointCount % chunkPoints != 0);
+    checkpoint->restored = calloc((checkpoint->chunkCount + 7) / 8, 1);
+    checkpoint->done = calloc((checkpoint->chunkCount + 7) / 8, 1);
+    checkpoint->saveDone = malloc((checkpoint->chunkCount + 7) / 8);
+    // At most one range per two chunks, and one for an odd last chunk
+    checkpoint->saveRanges = malloc(sizeof(uint64_t) * 2 * (checkpoint->chunkCount / 2 + 1));
+    if(checkpoint->restored == NULL || checkpoint->done == NULL || checkpoint->saveDone == NULL ||
+       checkpoint->saveRanges == NULL){
+        return 0;
+    }
+
+    for(uint64_t i = 0; i < header->rangeCount; i++){
+        uint64_t first = checkpoint->ranges[2 * i], end = checkpoint->ranges[2 * i + 1];
+        if(first >= end || end > checkpoint->chunkCount){
+            return 0;
+        }
+        setChunks(checkpoint->restored, first, end);
+        setChunks(checkpoint->done, first, end);
+    }
+    free(checkpoint->ranges);
+    checkpoint->ranges = NULL;
+    checkpoint->restoredPoints = header->points;
+    checkpoint->restoredScore = header->score;
+
+    if(pthread_create(&checkpoint->writer, NULL, checkpointWriter, checkpoint) != 0){
+        return 0;
+    }
+    checkpoint->started = 1;
+    return 1;
+}
+
+/*
+ * Function: checkpointReport
+ * ------------------------
+ * Records a finished chunk. Called by the workers once per chunk, the file is written by
+ * the writer thread.
+ *
+ * @param *checkpoint - The checkpoint
+ * @param chunk       - Index of the chunk
+ * @param pointCount  - Number of points in the chunk
+ * @param score       - Score of the chunk
+ */
+void checkpointReport(Checkpoint *checkpoint, uint64_t chunk, uint64_t pointCount, uint64_t score){
+    pthread_mutex_lock(&checkpoint->mutex);
+    checkpoint->done[chunk / 8] |= (uint8_t)(1U << (chunk % 8));
+    checkpoint->header.points += pointCount;
+    checkpoint->header.score += score;
+    checkpoint->dirty = 1;
+    pthread_mutex_unlock(&checkpoint->mutex);
+}
+
+/*
+ * Function: checkpointFinish
+ * ------------------------
+ * Stops the writer thread and saves the checkpoint a last time. Called by the engine once
+ * every worker has finished.
+ *
+ * @param *checkpoint - The checkpoint
+ *
+ * @return int of 1 if the last save was written, otherwise returns 0
+ */
+int checkpointFinish(Checkpoint *checkpoint){
+    if(!checkpoint->started){
+        return 0;
+    }
+    pthread_mutex_lock(&checkpoint->mutex);
+    checkpoint->stopping = 1;
+    pthread_cond_signal(&checkpoint->wake);
+    pthread_mutex_unlock(&checkpoint->mutex);
+    pthread_join(checkpoint->writer, NULL);
+    checkpoint->started = 0;
+
+    return checkpointSave(checkpoint);
+}
+
+/*
+ * Function: checkpointClose
+ * ------------------------
+ * Frees a checkpoint. The checkpoint file is kept.
+ *
+ * @param *checkpoint - The checkpoint
+ */
+void checkpointClose(Checkpoint *checkpoint){
+    if(checkpoint->started){
+        checkpointFinish(checkpoint);
+    }
+    pthread_mutex_destroy(&checkpoint->mutex);
+    pthread_cond_destroy(&checkpoint->wake);
+    free(checkpoint->path);
+    free(checkpoint->temporaryPath);
+    free(checkpoint->restored);
+    free(checkpoint->done);
+    free(checkpoint->saveDone);
+    free(checkpoint->saveRanges);
+    free(checkpoint->ranges);
+    memset(checkpoint, 0, sizeof(*checkpoint));
+}
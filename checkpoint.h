@@ -0,0 +1,123 @@
+/* CHECKPOINT.H
+ *
+ * Checkpoint and resume of a run with a fixed number of points. Workers report each chunk
+ * of the scheduler they finish; a writer thread saves the finished chunks and their total
+ * score to the checkpoint file every interval, off the hot path. Points are drawn from the
+ * block streams of random.h, so the finished chunks are the stream positions: a restarted
+ * run with the same options skips them and draws only the rest, giving exactly the counts
+ * of an uninterrupted run.
+ *
+ * The file is a CheckpointHeader followed by rangeCount pairs of uint64_t, the first chunk
+ * and one past the last chunk of each range of finished chunks, in native byte order. It
+ * is written to path.tmp and renamed over path, so a crash never leaves it half written.
+ *
+ */
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+// "MCCHKPT" and a version number, at the start of every checkpoint file
+#define CHECKPOINT_MAGIC 0x54504B4843434DULL
+#define CHECKPOINT_VERSION 3
+
+/* Structure: CheckpointHeader
+ * Start of a checkpoint file. The fields up to and including fixedPoint identify the run;
+ * a checkpoint is only resumed by a run that matches them.
+ *
+ * @variable magic         - CHECKPOINT_MAGIC
+ * @variable version       - CHECKPOINT_VERSION
+ * @variable seed          - Seed of the run
+ * @variable pointCount    - Number of points of the run
+ * @variable radius        - Radius of the circle
+ * @variable randomType    - Random number generator, a RandomType
+ * @variable estimatorType - Estimator of the area, an EstimatorType
+ * @variable sequence      - Sequence the points come from, a SequenceType
+ * @variable precision     - Precision of the sampling kernel, a Precision
+ * @variable fixedPoint    - 1 if the fixed point kernel draws the points, otherwise 0
+ * @variable chunkPoints   - Number of points in each chunk of the scheduler
+ * @variable points        - Number of points in the finished chunks
+ * @variable score         - Score of the finished chunks, see estimatorSample
+ * @variable rangeCount    - Number of ranges of finished chunks after the header
+ */
+typedef struct CheckpointHeaderStruct{
+    uint64_t magic;
+    uint64_t version;
+    uint64_t seed;
+    uint64_t pointCount;
+    double radius;
+    uint64_t randomType;
+    uint64_t estimatorType;
+    uint64_t sequence;
+    uint64_t precision;
+    uint64_t fixedPoint;
+    uint64_t chunkPoints;
+    uint64_t points;
+    uint64_t score;
+    uint64_t rangeCount;
+}CheckpointHeader;
+
+/* Structure: Checkpoint
+ * Finished chunks of a run and the writer thread that saves them.
+ *
+ * @variable *path          - Path of the checkpoint file
+ * @variable *temporaryPath - path.tmp, written before it is renamed over path
+ * @variable interval       - Seconds between two saves
+ * @variable header         - The run, and totals of the chunks finished so far
+ * @variable chunkCount     - Number of chunks of the run
+ * @variable *restored      - Bit per chunk, set for chunks finished before the run started.
+ *                            Read only while the run is going, so workers read it unlocked.
+ * @variable *done          - Bit per chunk, set for every finished chunk
+ * @variable *saveDone      - Copy of done taken by each save
+ * @variable *saveRanges    - Ranges of finished chunks written by each save
+ * @variable restoredPoints - Number of points in the restored chunks
+ * @variable restoredScore  - Score of the restored chunks
+ * @variable *ranges        - Ranges read from the file, until the run starts
+ * @variable mutex          - Protects done, the totals of header, dirty and stopping
+ * @variable wake           - Signalled to make the writer save and stop
+ * @variable writer         - The writer thread
+ * @variable started        - Set while the writer thread is running
+ * @variable dirty          - Set when chunks have finished since the last save
+ * @variable stopping       - Set when the run is over
+ */
+typedef struct CheckpointStruct{
+    char *path;
+    char *temporaryPath;
+    double interval;
+    CheckpointHeader header;
+    uint64_t chunkCount;
+    uint8_t *restored;
+    uint8_t *done;
+    uint8_t *saveDone;
+    uint64_t *saveRanges;
+    uint64_t restoredPoints;
+    uint64_t restoredScore;
+    uint64_t *ranges;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    pthread_t writer;
+    int started;
+    int dirty;
+    int stopping;
+}Checkpoint;
+
+int checkpointOpen(Checkpoint *checkpoint, const char *path, double interval, const CheckpointHeader *run);
+int checkpointStart(Checkpoint *checkpoint, uint64_t chunkPoints);
+void checkpointReport(Checkpoint *checkpoint, uint64_t chunk, uint64_t pointCount, uint64_t score);
+int checkpointFinish(Checkpoint *checkpoint);
+void checkpointClose(Checkpoint *checkpoint);
+
+/*
+ * Function: checkpointRestored
+ * ------------------------
+ * @param *checkpoint - The checkpoint of the run
+ * @param chunk       - Index of a chunk of the scheduler
+ *
+ * @return int of 1 if the chunk was finished before the run started, otherwise returns 0
+ */
+static inline int checkpointRestored(const Checkpoint *checkpoint, uint64_t chunk){
+    return (checkpoint->restored[chunk / 8] >> (chunk % 8)) & 1;
+}
+
+#endif //CHECKPOINT_H
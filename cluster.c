@@ -0,0 +1,503 @@
+/* CLUSTER.C
+ *
+ * Coordinator and worker processes over a Unix domain socket. See cluster.h.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "cluster.h"
+#include "kernel.h"
+#include "topology.h"
+
+// Attempts of a worker to connect, CLUSTER_CONNECT_WAIT_US apart, before it gives up
+#define CLUSTER_CONNECT_ATTEMPTS 100
+#define CLUSTER_CONNECT_WAIT_US 100000
+
+/* Structure: Coordinator
+ * Ranges of the run and the workers drawing them.
+ *
+ * @variable *path         - Path of the socket workers connect to
+ * @variable *job          - The run
+ * @variable rangeCount    - Number of ranges of the run
+ * @variable nextRange     - First range never handed out
+ * @variable returned      - Ranges of workers that died, handed out before nextRange. There
+ *                           are never more of them and ranges held than CLUSTER_MAX_WORKERS.
+ * @variable returnedCount - Number of returned ranges
+ * @variable rangesDone    - Number of ranges whose score has been added
+ * @variable score         - Score of the ranges done
+ * @variable sockets       - Socket of each connected worker
+ * @variable ranges        - Range each worker is drawing, -1 if it is idle
+ * @variable workerCount   - Number of connected workers
+ */
+typedef struct CoordinatorStruct{
+    const char *path;
+    const ClusterJob *job;
+    uint64_t rangeCount;
+    uint64_t nextRange;
+    uint64_t returned[CLUSTER_MAX_WORKERS];
+    int returnedCount;
+    uint64_t rangesDone;
+    uint64_t score;
+    int sockets[CLUSTER_MAX_WORKERS];
+    int64_t ranges[CLUSTER_MAX_WORKERS];
+    int workerCount;
+}Coordinator;
+
+/*
+ * Function: sendAll
+ * ------------------------
+ * Sends the whole of a buffer. A peer that has gone makes this fail rather than raise SIGPIPE.
+ *
+ * @param connection - The connected socket
+ * @param *data      - The buffer
+ * @param size       - Number of bytes to send
+ *
+ * @return int of 1 if every byte was sent, otherwise returns 0
+ */
+static int sendAll(int connection, const void *data, size_t size){
+    const char *bytes = data;
+    while(size > 0){
+        ssize_t sent = send(connection, bytes, size, MSG_NOSIGNAL);
+        if(sent < 0 && errno == EINTR){
+            continue;
+        }
+        if(sent <= 0){
+            return 0;
+        }
+        bytes += sent;
+        size -= (size_t) sent;
+    }
+    return 1;
+}
+
+/*
+ * Function: receiveAll
+ * ------------------------
+ * Receives exactly size bytes.
+ *
+ * @param connection - The connected socket
+ * @param *data      - The buffer
+ * @param size       - Number of bytes to receive
+ *
+ * @return int of 1 if every byte was received, 0 if the peer closed the socket or it failed
+ */
+static int receiveAll(int connection, void *data, size_t size){
+    char *bytes = data;
+    while(size > 0){
+        ssize_t received = recv(connection, bytes, size, 0);
+        if(received < 0 && errno == EINTR){
+            continue;
+        }
+        if(received <= 0){
+            return 0;
+        }
+        bytes += received;
+        size -= (size_t) received;
+    }
+    return 1;
+}
+
+/*
+ * Function: socketAddress
+ * ------------------------
+ * @param *path    - Path of the socket
+ * @param *address - Set to the address of the socket
+ *
+ * @return int of 1 if the path fits in an address, otherwise returns 0
+ */
+static int socketAddress(const char *path, struct sockaddr_un *address){
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    if(strlen(path) >= sizeof(address->sun_path)){
+        errno = ENAMETOOLONG;
+        return 0;
+    }
+    strcpy(address->sun_path, path);
+    return 1;
+}
+
+/*
+ * Function: rangeMessage
+ * ------------------------
+ * @param *job   - The run
+ * @param range  - Index of a range of the run
+ * @param type   - Type of the message
+ *
+ * @return ClusterMessage of the points of the range
+ */
+static ClusterMessage rangeMessage(const ClusterJob *job, uint64_t range, ClusterMessageType type){
+    uint64_t first = range * CLUSTER_RANGE_POINTS;
+    ClusterMessage message = {
+        .type = type,
+        .firstPoint = job->firstPoint + first,
+        .pointCount = job->pointCount - first < CLUSTER_RANGE_POINTS ? job->pointCount - first : CLUSTER_RANGE_POINTS
+    };
+    return message;
+}
+
+/*
+ * Function: dropWorker
+ * ------------------------
+ * Disconnects a worker that died or broke the protocol. The range it was drawing is
+ * returned, to be handed to another worker.
+ *
+ * @param *coordinator - The coordinator
+ * @param worker       - Index of the worker
+ */
+static void dropWorker(Coordinator *coordinator, int worker){
+    int64_t range = coordinator->ranges[worker];
+    if(range >= 0){
+        ClusterMessage lost = rangeMessage(coordinator->job, (uint64_t) range, CLUSTER_RANGE);
+        fprintf(stderr, "Worker lost, points %" PRIu64 " to %" PRIu64 " handed to another worker\n",
+                lost.firstPoint, lost.firstPoint + lost.pointCount - 1);
+        coordinator->returned[coordinator->returnedCount++] = (uint64_t) range;
+    }
+    close(coordinator->sockets[worker]);
+
+    coordinator->workerCount--;
+    coordinator->sockets[worker] = coordinator->sockets[coordinator->workerCount];
+    coordinator->ranges[worker] = coordinator->ranges[coordinator->workerCount];
+    if(coordinator->workerCount == 0){
+        fprintf(stderr, "No workers left, waiting for workers to connect to %s\n", coordinator->path);
+    }
+}
+
+/*
+ * Function: assignRanges
+ * ------------------------
+ * Hands a range to every idle worker while ranges are left, returned ranges first.
+ *
+ * @param *coordinator - The coordinator
+ */
+static void assignRanges(Coordinator *coordinator){
+    for(int worker = coordinator->workerCount - 1; worker >= 0; worker--){
+        if(coordinator->ranges[worker] >= 0){
+            continue;
+        }
+        uint64_t range;
+        if(coordinator->returnedCount > 0){
+            range = coordinator->returned[--coordinator->returnedCount];
+        } else if(coordinator->nextRange < coordinator->rangeCount){
+            range = coordinator->nextRange++;
+        } else {
+            return;
+        }
+        coordinator->ranges[worker] = (int64_t) range;
+        ClusterMessage message = rangeMessage(coordinator->job, range, CLUSTER_RANGE);
+        if(!sendAll(coordinator->sockets[worker], &message, sizeof(message))){
+            dropWorker(coordinator, worker);
+        }
+    }
+}
+
+/*
+ * Function: acceptWorker
+ * ------------------------
+ * Accepts a worker that has connected and sends it the job.
+ *
+ * @param *coordinator - The coordinator
+ * @param listener     - The listening socket
+ */
+static void acceptWorker(Coordinator *coordinator, int listener){
+    int connection = accept(listener, NULL, NULL);
+    if(connection < 0){
+        return;
+    }
+    if(coordinator->workerCount == CLUSTER_MAX_WORKERS ||
+       !sendAll(connection, coordinator->job, sizeof(*coordinator->job))){
+        close(connection);
+        return;
+    }
+    coordinator->sockets[coordinator->workerCount] = connection;
+    coordinator->ranges[coordinator->workerCount] = -1;
+    coordinator->workerCount++;
+}
+
+/*
+ * Function: receiveScore
+ * ------------------------
+ * Adds the score a worker sent for its range. A worker whose socket closed, or that sent
+ * anything but the score of its range, is dropped.
+ *
+ * @param *coordinator - The coordinator
+ * @param worker       - Index of the worker, whose socket is readable
+ */
+static void receiveScore(Coordinator *coordinator, int worker){
+    ClusterMessage message;
+    int64_t range = coordinator->ranges[worker];
+
+    if(range < 0 || !receiveAll(coordinator->sockets[worker], &message, sizeof(message))){
+        dropWorker(coordinator, worker);
+        return;
+    }
+    ClusterMessage expected = rangeMessage(coordinator->job, (uint64_t) range, CLUSTER_SCORE);
+    if(message.type != CLUSTER_SCORE || message.firstPoint != expected.firstPoint ||
+       message.pointCount != expected.pointCount){
+        dropWorker(coordinator, worker);
+        return;
+    }
+    coordinator->score += message.score;
+    coordinator->rangesDone++;
+    coordinator->ranges[worker] = -1;
+}
+
+/*
+ * Function: spawnWorkers
+ * ------------------------
+ * Forks worker processes that connect back to the coordinator. With CLUSTER_SPAWN_NUMA
+ * worker n is restricted to the CPUs of NUMA node n and runs one thread per CPU.
+ *
+ * @param *path      - Path of the socket of the coordinator
+ * @param listener   - The listening socket, closed in the workers
+ * @param spawnCount - Number of workers, or CLUSTER_SPAWN_NUMA
+ * @param engineType - Engine of the workers
+ * @param *options   - Settings of the engines of the workers
+ * @param *pids      - Set to the process of each worker
+ *
+ * @return int of the number of workers started
+ */
+static int spawnWorkers(const char *path, int listener, int spawnCount, EngineType engineType,
+                        const EngineOptions *options, pid_t *pids){
+    int perNode = spawnCount == CLUSTER_SPAWN_NUMA;
+    int count = perNode ? numaNodeCount() : spawnCount;
+    int started = 0;
+
+    fflush(stdout);
+    fflush(stderr);
+    for(int i = 0; i < count && i < CLUSTER_MAX_WORKERS; i++){
+        pid_t pid = fork();
+        if(pid < 0){
+            perror("Error starting worker");
+            break;
+        }
+        if(pid == 0){
+            EngineOptions workerOptions = *options;
+            close(listener);
+            if(perNode){
+                int cpus = pinProcessToNode(i);
+                if(cpus > 0){
+                    workerOptions.threadCount = cpus;
+                    workerOptions.affinity = AFFINITY_NONE; // Its threads inherit the node
+                }
+            }
+            _exit(clusterWork(path, engineType, &workerOptions) ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+        pids[started++] = pid;
+    }
+    return started;
+}
+
+/*
+ * Function: clusterCoordinate
+ * ------------------------
+ * Runs a job on worker processes. Listens on the socket, optionally forks workers, hands
+ * every range of the job out to the workers that connect and adds up their scores. Ranges
+ * of workers that die are handed out again. Once every range is done the workers are told
+ * to stop and the forked ones are waited for.
+ *
+ * @param *path      - Path of the socket to create, replacing any file already there
+ * @param *job       - The run, magic and version are set to CLUSTER_MAGIC and CLUSTER_VERSION
+ * @param spawnCount - Number of workers to fork, CLUSTER_SPAWN_NUMA for one per NUMA node, 0
+ *                     to only wait for workers started separately
+ * @param engineType - Engine of the forked workers
+ * @param *options   - Settings of the engines of the forked workers
+ * @param *estimate  - Set to the result of the run
+ *
+ * @return int of 1 on success, 0 if the socket could not be created or polled, or the job has
+ *         more points than estimatorMaxPoints of its estimator
+ */
+int clusterCoordinate(const char *path, const ClusterJob *job, int spawnCount, EngineType engineType,
+                      const EngineOptions *options, Estimate *estimate){
+    struct sockaddr_un address;
+    ClusterJob sent = *job;
+    sent.magic = CLUSTER_MAGIC;
+    sent.version = CLUSTER_VERSION;
+
+    if(sent.pointCount > estimatorMaxPoints((EstimatorType) sent.estimatorType)){
+        return 0;
+    }
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(listener < 0){
+        return 0;
+    }
+    unlink(path);
+    if(!socketAddress(path, &address) || bind(listener, (struct sockaddr*) &address, sizeof(address)) != 0 ||
+       listen(listener, CLUSTER_MAX_WORKERS) != 0){
+        close(listener);
+        return 0;
+    }
+
+    pid_t pids[CLUSTER_MAX_WORKERS];
+    int spawned = spawnCount != 0 ? spawnWorkers(path, listener, spawnCount, engineType, options, pids) : 0;
+
+    if(spawned == 0){
+        fprintf(stderr, "Waiting for workers to connect to %s\n", path);
+    }
+
+    Coordinator coordinator = {
+        .path = path,
+        .job = &sent,
+        .rangeCount = (sent.pointCount + CLUSTER_RANGE_POINTS - 1) / CLUSTER_RANGE_POINTS
+    };
+    struct pollfd fds[CLUSTER_MAX_WORKERS + 1];
+    int pollError = 0;
+    while(coordinator.rangesDone < coordinator.rangeCount){
+        fds[0].fd = listener;
+        fds[0].events = POLLIN;
+        for(int worker = 0; worker < coordinator.workerCount; worker++){
+            fds[worker + 1].fd = coordinator.sockets[worker];
+            fds[worker + 1].events = POLLIN;
+        }
+        int workerCount = coordinator.workerCount;
+        if(poll(fds, workerCount + 1, -1) < 0){
+            if(errno == EINTR){
+                continue; // Interrupted by a signal
+            }
+            pollError = errno;
+            break;
+        }
+
+        // Backwards, as a dropped worker is replaced by the last one
+        for(int worker = workerCount - 1; worker >= 0; worker--){
+            if(fds[worker + 1].revents != 0){
+                receiveScore(&coordinator, worker);
+            }
+        }
+        if(fds[0].revents & POLLIN){
+            acceptWorker(&coordinator, listener);
+        }
+        assignRanges(&coordinator);
+    }
+
+    // Without the stop message the workers see the coordinator lost and exit
+    ClusterMessage stop = {.type = CLUSTER_STOP};
+    for(int worker = 0; worker < coordinator.workerCount; worker++){
+        if(pollError == 0){
+            sendAll(coordinator.sockets[worker], &stop, sizeof(stop));
+        }
+        close(coordinator.sockets[worker]);
+    }
+    close(listener);
+    unlink(path);
+    for(int i = 0; i < spawned; i++){
+        waitpid(pids[i], NULL, 0);
+    }
+    if(pollError != 0){
+        errno = pollError;
+        return 0;
+    }
+
+    estimate->seed = sent.seed;
+    estimate->firstPoint = sent.firstPoint;
+    estimate->pointCount = sent.pointCount;
+    estimate->score = coordinator.score;
+    return 1;
+}
+
+/*
+ * Function: connectCoordinator
+ * ------------------------
+ * Connects to a coordinator, waiting for it to start listening if it has not yet.
+ *
+ * @param *path - Path of the socket of the coordinator
+ *
+ * @return int of the connected socket, or -1 if it could not connect
+ */
+static int connectCoordinator(const char *path){
+    struct sockaddr_un address;
+    if(!socketAddress(path, &address)){
+        return -1;
+    }
+
+    for(int attempt = 0; attempt < CLUSTER_CONNECT_ATTEMPTS; attempt++){
+        int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(connection < 0){
+            return -1;
+        }
+        if(connect(connection, (struct sockaddr*) &address, sizeof(address)) == 0){
+            return connection;
+        }
+        int error = errno;
+        close(connection);
+        if(error != ENOENT && error != ECONNREFUSED){
+            errno = error;
+            return -1;
+        }
+        usleep(CLUSTER_CONNECT_WAIT_US);
+    }
+    return -1;
+}
+
+/*
+ * Function: clusterWork
+ * ------------------------
+ * Runs a worker process: connects to the coordinator, creates an engine for its job and
+ * draws the ranges it is handed until it is told to stop.
+ *
+ * @param *path      - Path of the socket of the coordinator
+ * @param engineType - Engine to draw the ranges with
+ * @param *options   - Settings of the engine. The seed, generator, estimator and sequence
+ *                     come from the job.
+ *
+ * @return int of 1 if the worker was told to stop, 0 if it could not connect, could not
+ *         create its engine or lost the coordinator
+ */
+int clusterWork(const char *path, EngineType engineType, const EngineOptions *options){
+    ClusterJob job;
+    ClusterMessage message;
+
+    int connection = connectCoordinator(path);
+    if(connection < 0){
+        perror("Error connecting to coordinator");
+        return 0;
+    }
+    if(!receiveAll(connection, &job, sizeof(job)) || job.magic != CLUSTER_MAGIC || job.version != CLUSTER_VERSION ||
+       !kernelSelect(job.fixedPoint ? KERNEL_FIXED : KERNEL_AUTO, (Precision) job.precision)){
+        fprintf(stderr, "Error joining coordinator %s: no job of this version was received\n", path);
+        close(connection);
+        return 0;
+    }
+
+    EngineOptions workerOptions = *options;
+    workerOptions.seed = job.seed;
+    workerOptions.randomType = (RandomType) job.randomType;
+    workerOptions.estimatorType = (EstimatorType) job.estimatorType;
+    workerOptions.sequence = (SequenceType) job.sequence;
+    workerOptions.instrument = 0;
+    workerOptions.checkpoint = NULL;
+    Engine engine;
+    if(!engineCreate(&engine, engineType, &workerOptions)){
+        perror("Error creating Engine: ");
+        close(connection);
+        return 0;
+    }
+
+    int stopped = 0;
+    while(receiveAll(connection, &message, sizeof(message))){
+        if(message.type != CLUSTER_RANGE){
+            stopped = message.type == CLUSTER_STOP;
+            break;
+        }
+        message.type = CLUSTER_SCORE;
+        message.score = engineRunRange(&engine, message.firstPoint, message.pointCount, job.radius);
+        if(!sendAll(connection, &message, sizeof(message))){
+            break;
+        }
+    }
+    if(!stopped){
+        fprintf(stderr, "Worker lost coordinator %s\n", path);
+    }
+
+    engineDestroy(&engine);
+    close(connection);
+    return stopped;
+}
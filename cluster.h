@@ -0,0 +1,95 @@
+/* CLUSTER.H
+ *
+ * Multi-process scale out. A coordinator splits the points of a run into ranges of
+ * CLUSTER_RANGE_POINTS and hands them out over a Unix domain socket to worker processes,
+ * one range at a time. Each worker draws its ranges with its own engine and threads and
+ * sends back their scores, which the coordinator adds up. Ranges are drawn from the block
+ * streams of random.h, so the total is exactly that of one process drawing every point,
+ * whichever worker draws each range.
+ *
+ * Workers are started separately (--worker) on the same machine, or forked by the
+ * coordinator, a given number of them or one per NUMA node. A worker that dies, whose
+ * socket closes, has the range it held handed to another worker. A worker that stops
+ * responding without dying is not detected.
+ *
+ * Messages are fixed size structures in native byte order, as both ends run on the same
+ * machine: a ClusterJob from the coordinator when a worker connects, then ClusterMessages.
+ *
+ */
+#ifndef CLUSTER_H
+#define CLUSTER_H
+
+#include <stdint.h>
+#include "engine.h"
+
+// "MCCLUST" and a version number, at the start of every job
+#define CLUSTER_MAGIC 0x5453554C43434DULL
+#define CLUSTER_VERSION 3
+
+// Points of each range handed to a worker, a multiple of RANDOM_BLOCK_POINTS
+#define CLUSTER_RANGE_POINTS (1ULL << 24)
+// Most workers connected to a coordinator at once
+#define CLUSTER_MAX_WORKERS 256
+// spawnCount of clusterCoordinate forking one worker per NUMA node
+#define CLUSTER_SPAWN_NUMA (-1)
+
+/* Structure: ClusterJob
+ * The run a coordinator hands out, sent to each worker when it connects.
+ *
+ * @variable magic         - CLUSTER_MAGIC
+ * @variable version       - CLUSTER_VERSION
+ * @variable seed          - Seed of the run
+ * @variable firstPoint    - Index of the first point of the run, a multiple of RANDOM_BLOCK_POINTS
+ * @variable pointCount    - Number of points of the run
+ * @variable radius        - Radius of the circle
+ * @variable randomType    - Random number generator, a RandomType
+ * @variable estimatorType - Estimator of the area, an EstimatorType
+ * @variable sequence      - Sequence the points come from, a SequenceType
+ * @variable precision     - Precision of the sampling kernel, a Precision
+ * @variable fixedPoint    - 1 if the fixed point kernel draws the points, otherwise 0
+ */
+typedef struct ClusterJobStruct{
+    uint64_t magic;
+    uint64_t version;
+    uint64_t seed;
+    uint64_t firstPoint;
+    uint64_t pointCount;
+    double radius;
+    uint64_t randomType;
+    uint64_t estimatorType;
+    uint64_t sequence;
+    uint64_t precision;
+    uint64_t fixedPoint;
+}ClusterJob;
+
+/* Enum: ClusterMessageType
+ * CLUSTER_RANGE - Coordinator to worker: draw the points of a range
+ * CLUSTER_SCORE - Worker to coordinator: the score of the range it was given
+ * CLUSTER_STOP  - Coordinator to worker: the run is over, exit
+ */
+typedef enum ClusterMessageTypeEnum{
+    CLUSTER_RANGE,
+    CLUSTER_SCORE,
+    CLUSTER_STOP
+}ClusterMessageType;
+
+/* Structure: ClusterMessage
+ * A range handed to a worker, or its score.
+ *
+ * @variable type       - A ClusterMessageType
+ * @variable firstPoint - Index of the first point of the range
+ * @variable pointCount - Number of points of the range
+ * @variable score      - Score of the range, with CLUSTER_SCORE
+ */
+typedef struct ClusterMessageStruct{
+    uint64_t type;
+    uint64_t firstPoint;
+    uint64_t pointCount;
+    uint64_t score;
+}ClusterMessage;
+
+int clusterCoordinate(const char *path, const ClusterJob *job, int spawnCount, EngineType engineType,
+                      const EngineOptions *options, Estimate *estimate);
+int clusterWork(const char *path, EngineType engineType, const EngineOptions *options);
+
+#endif //CLUSTER_H
@@ -0,0 +1,268 @@
+/* ENGINE.C
+ *
+ * Dispatch to the estimation engines. See engine.h.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "engine.h"
+
+// Functions of each engine
+static const EngineOps *engines[] = {
+    [ENGINE_SERIAL] = &serialEngine,
+    [ENGINE_SHARDED] = &shardedEngine,
+    [ENGINE_SHARED] = &sharedEngine
+};
+
+static const char *engineNames[] = {
+    [ENGINE_SERIAL] = "serial",
+    [ENGINE_SHARDED] = "sharded",
+    [ENGINE_SHARED] = "shared"
+};
+
+static const char *strategyNames[] = {
+    [STRATEGY_MUTEX] = "mutex",
+    [STRATEGY_ATOMIC] = "atomic",
+    [STRATEGY_BATCHED] = "batched",
+    [STRATEGY_SHARDED] = "sharded"
+};
+
+/*
+ * Function: engineCreate
+ * ------------------------
+ * Creates an engine: starts its worker threads and seeds their random number streams.
+ *
+ * @param *engine  - The engine to create
+ * @param type     - Which engine to create
+ * @param *options - Settings of the engine
+ *
+ * @return int of 1 on success, 0 if the engine could not be created
+ */
+int engineCreate(Engine *engine, EngineType type, const EngineOptions *options){
+    engine->type = type;
+    engine->estimatorType = options->estimatorType;
+    engine->ops = engines[type];
+    engine->state = engine->ops->create(options);
+    return engine->state != NULL;
+}
+
+/*
+ * Function: engineRun
+ * ------------------------
+ * Estimates the area of the circle from a fixed number of points.
+ *
+ * @param *engine    - The engine to run
+ * @param pointCount - Number of random coordinates to iterate through. The greater the
+ *                     pointCount, the more accurate the area calculation will be.
+ * @param radius     - Radius of the circle to calculate the area of.
+ *
+ * @return double of the calculated area of the circle
+ */
+double engineRun(Engine *engine, uint64_t pointCount, double radius){
+    return engine->ops->run(engine->state, pointCount, radius);
+}
+
+/*
+ * Function: engineRunRange
+ * ------------------------
+ * Draws the points firstPoint to firstPoint + pointCount - 1 of the block streams, or of
+ * the sequence, and adds up their score. The estimations of engineRun are not moved, and
+ * the points are the same as those of any estimation that drew them.
+ *
+ * @param *engine    - The engine to run
+ * @param firstPoint - Index of the first point, a multiple of RANDOM_BLOCK_POINTS
+ * @param pointCount - Number of points to draw
+ * @param radius     - Radius of the circle
+ *
+ * @return uint64_t of the score of the points, see estimatorSample
+ */
+uint64_t engineRunRange(Engine *engine, uint64_t firstPoint, uint64_t pointCount, double radius){
+    return engine->ops->runRange(engine->state, firstPoint, pointCount, radius);
+}
+
+/*
+ * Function: engineExtend
+ * ------------------------
+ * Extends a previous estimation to more points, giving exactly the score of an estimation
+ * of all of them. Only the points after the last whole block of the prior are drawn, and
+ * its partial last block, which a longer run draws with more points in one call, is drawn
+ * again and its score replaced. That is at most RANDOM_BLOCK_POINTS - 1 points redrawn.
+ *
+ * @param *engine    - The engine, created with the seed, generator, estimator and sequence
+ *                     of the prior and without a checkpoint
+ * @param *prior     - The previous estimation
+ * @param pointCount - Total number of points of the extended estimation
+ * @param radius     - Radius of the circle, that of the prior
+ * @param *estimate  - Set to the extended estimation
+ *
+ * @return int of 1 on success, 0 if pointCount is less than the points of the prior or more
+ *         than estimatorMaxPoints
+ */
+int engineExtend(Engine *engine, const Estimate *prior, uint64_t pointCount, double radius, Estimate *estimate){
+    if(pointCount < prior->pointCount || pointCount > estimatorMaxPoints(engine->estimatorType)){
+        return 0;
+    }
+    uint64_t blockPoints = prior->pointCount / RANDOM_BLOCK_POINTS * RANDOM_BLOCK_POINTS;
+    uint64_t firstPoint = prior->firstPoint + blockPoints;
+    uint64_t score = prior->score;
+
+    if(pointCount > blockPoints){
+        score += engineRunRange(engine, firstPoint, pointCount - blockPoints, radius);
+    }
+    if(prior->pointCount > blockPoints){
+        score -= engineRunRange(engine, firstPoint, prior->pointCount - blockPoints, radius);
+    }
+
+    estimate->seed = prior->seed;
+    estimate->firstPoint = prior->firstPoint;
+    estimate->pointCount = pointCount;
+    estimate->score = score;
+    return 1;
+}
+
+/*
+ * Function: engineRunAdaptive
+ * ------------------------
+ * Keeps drawing points until the 95% confidence interval of the area is narrower than the
+ * tolerance, or until the time limit has passed. See progress.h.
+ *
+ * @param *engine     - The engine to run
+ * @param tolerance   - Half width of the confidence interval at which to stop, 0 for none
+ * @param timeLimit   - Seconds after which to stop, 0 for no limit
+ * @param pointLimit  - Most points to draw if neither is reached first, 0 for no limit.
+ *                      Capped at estimatorMaxPoints of the estimator
+ * @param radius      - Radius of the circle to calculate the area of.
+ * @param *pointsUsed - Set to the number of points drawn
+ * @param *error      - Set to the half width of the confidence interval reached
+ *
+ * @return double of the calculated area of the circle
+ */
+double engineRunAdaptive(Engine *engine, double tolerance, double timeLimit, uint64_t pointLimit,
+                         double radius, uint64_t *pointsUsed, double *error){
+    return engine->ops->runAdaptive(engine->state, tolerance, timeLimit, pointLimit, radius, pointsUsed, error);
+}
+
+/*
+ * Function: engineDestroy
+ * ------------------------
+ * Stops the worker threads of an engine and frees it.
+ *
+ * @param *engine - The engine to destroy
+ */
+void engineDestroy(Engine *engine){
+    engine->ops->destroy(engine->state);
+    engine->state = NULL;
+}
+
+/*
+ * Function: engineStats
+ * ------------------------
+ * @param *engine - The engine
+ *
+ * @return const EngineStats* of the instrumentation recorded over every run of the engine,
+ *         or NULL if the engine was created without instrumentation
+ */
+const EngineStats* engineStats(Engine *engine){
+    return engine->ops->stats(engine->state);
+}
+
+/*
+ * Function: calculateCircleArea
+ * ------------------------
+ * Calculates the area of the circle once, with an engine that only lives for this call.
+ * Use an Engine directly to calculate several areas without recreating the threads.
+ * With a time limit the best estimate reached by then is returned, drawing at most
+ * pointCount points.
+ *
+ * @param type       - Which engine to use
+ * @param *options   - Settings of the engine
+ * @param pointCount - Number of random coordinates to iterate through. The greater the
+ *                     pointCount, the more accurate the area calculation will be.
+ * @param radius     - Radius of the circle to calculate the area of.
+ * @param timeLimit  - Seconds after which to return the estimate reached so far, 0 for no limit
+ *
+ * @return double of the calculated area of the circle
+ */
+double calculateCircleArea(EngineType type, const EngineOptions *options, uint64_t pointCount, double radius,
+                           double timeLimit){
+    Engine engine;
+
+    if(!engineCreate(&engine, type, options)){
+        perror("Error creating Engine: ");
+        exit(EXIT_FAILURE);
+    }
+    double area;
+    if(timeLimit > 0){
+        uint64_t pointsUsed;
+        double error;
+        area = engineRunAdaptive(&engine, 0, timeLimit, pointCount, radius, &pointsUsed, &error);
+    } else {
+        area = engineRun(&engine, pointCount, radius);
+    }
+    engineDestroy(&engine);
+
+    return area;
+}
+
+/*
+ * Function: engineTypeFromName
+ * ------------------------
+ * Converts an engine name given on the command line into an EngineType.
+ *
+ * @param *name - "serial", "sharded" or "shared"
+ * @param *type - Set to the matching engine
+ *
+ * @return int of 1 if the name is known, otherwise returns 0
+ */
+int engineTypeFromName(const char *name, EngineType *type){
+    for(int i = 0; i < (int)(sizeof(engineNames) / sizeof(engineNames[0])); i++){
+        if(strcmp(name, engineNames[i]) == 0){
+            *type = (EngineType) i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Function: engineTypeName
+ * ------------------------
+ * @param type - The engine
+ *
+ * @return const char* of the name of the engine
+ */
+const char* engineTypeName(EngineType type){
+    return engineNames[type];
+}
+
+/*
+ * Function: strategyFromName
+ * ------------------------
+ * Converts a strategy name given on the command line into a Strategy.
+ *
+ * @param *name     - "mutex", "atomic", "batched" or "sharded"
+ * @param *strategy - Set to the matching strategy
+ *
+ * @return int of 1 if the name is known, otherwise returns 0
+ */
+int strategyFromName(const char *name, Strategy *strategy){
+    for(int i = 0; i < (int)(sizeof(strategyNames) / sizeof(strategyNames[0])); i++){
+        if(strcmp(name, strategyNames[i]) == 0){
+            *strategy = (Strategy) i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Function: strategyName
+ * ------------------------
+ * @param strategy - The strategy
+ *
+ * @return const char* of the name of the strategy
+ */
+const char* strategyName(Strategy strategy){
+    return strategyNames[strategy];
+}
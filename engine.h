@@ -0,0 +1,141 @@
+/* ENGINE.H
+ *
+ * The estimation engines behind the single executable. Each stage of the coursework is an
+ * engine built on the same sampling kernels and random number streams, so their throughput
+ * can be compared on the same build:
+ *
+ *   serial  - stage1, a single thread
+ *   sharded - stage2, every thread counts into its own workspace, summed once at the end
+ *   shared  - stage3, every thread adds to one shared total (see Strategy)
+ *
+ */
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <stdint.h>
+#include "random.h"
+#include "topology.h"
+#include "stats.h"
+#include "sequence.h"
+#include "estimator.h"
+#include "checkpoint.h"
+
+/* Enum: EngineType
+ * The estimation engines.
+ */
+typedef enum EngineTypeEnum{
+    ENGINE_SERIAL,
+    ENGINE_SHARDED,
+    ENGINE_SHARED
+}EngineType;
+
+/* Enum: Strategy
+ * How the threads of the shared engine add their circle points to the shared total.
+ *
+ * STRATEGY_MUTEX   - Lock the mutex for every batch of RANDOM_LANES points
+ * STRATEGY_ATOMIC  - Atomic fetch and add on one shared counter for every batch
+ * STRATEGY_BATCHED - Count a block of points locally, then flush with one atomic add
+ * STRATEGY_SHARDED - Atomic add for every batch on one of several cache line padded counters
+ */
+typedef enum StrategyEnum{
+    STRATEGY_MUTEX,
+    STRATEGY_ATOMIC,
+    STRATEGY_BATCHED,
+    STRATEGY_SHARDED
+}Strategy;
+
+/* Structure: EngineOptions
+ * Settings of an engine, fixed when it is created.
+ *
+ * @variable threadCount - Number of worker threads, ignored by the serial engine
+ * @variable randomType  - Random number generator used by the worker threads
+ * @variable affinity    - How the worker threads are pinned to CPUs
+ * @variable strategy    - How the shared engine updates its shared total
+ * @variable instrument  - INSTRUMENT_ flags of the per thread instrumentation of stats.h to
+ *                         record, 0 for none
+ * @variable sequence    - Low-discrepancy sequence the points are taken from, SEQUENCE_RANDOM
+ *                         for the random number streams
+ * @variable estimatorType - Estimator of the area from random points, see estimator.h
+ * @variable seed        - Seed of the random number streams and the sequence. Engines
+ *                         created with the same options give the same results, whatever
+ *                         the number of threads.
+ * @variable *checkpoint - Checkpoint the first engineRun of the engine resumes from and saves
+ *                         to, NULL for none. Not used by engineRunAdaptive.
+ */
+typedef struct EngineOptionsStruct{
+    int threadCount;
+    RandomType randomType;
+    Affinity affinity;
+    Strategy strategy;
+    int instrument;
+    SequenceType sequence;
+    EstimatorType estimatorType;
+    uint64_t seed;
+    Checkpoint *checkpoint;
+}EngineOptions;
+
+/* Structure: Estimate
+ * Exact result of an estimation from the block streams of random.h, or from a sequence:
+ * the points firstPoint to firstPoint + pointCount - 1 drawn with a seed and their score.
+ * Enough to extend the estimation with more points, see engineExtend.
+ *
+ * @variable seed       - Seed of the engine that drew the points
+ * @variable firstPoint - Index of the first point, a multiple of RANDOM_BLOCK_POINTS
+ * @variable pointCount - Number of points
+ * @variable score      - Score of the points, see estimatorSample
+ */
+typedef struct EstimateStruct{
+    uint64_t seed;
+    uint64_t firstPoint;
+    uint64_t pointCount;
+    uint64_t score;
+}Estimate;
+
+/* Structure: EngineOps
+ * The functions implementing one engine, see engineCreate and the functions after it.
+ */
+typedef struct EngineOpsStruct{
+    void* (*create)(const EngineOptions *options);
+    double (*run)(void *state, uint64_t pointCount, double radius);
+    uint64_t (*runRange)(void *state, uint64_t firstPoint, uint64_t pointCount, double radius);
+    double (*runAdaptive)(void *state, double tolerance, double timeLimit, uint64_t pointLimit,
+                          double radius, uint64_t *pointsUsed, double *error);
+    void (*destroy)(void *state);
+    const EngineStats* (*stats)(void *state);
+}EngineOps;
+
+/* Structure: Engine
+ * A created engine, reusable for any number of estimations.
+ *
+ * @variable type          - Which engine this is
+ * @variable estimatorType - Estimator of the area the engine was created with
+ * @variable *ops          - The functions of the engine
+ * @variable *state        - The engine's own estimator (threads, workspaces, streams)
+ */
+typedef struct EngineStruct{
+    EngineType type;
+    EstimatorType estimatorType;
+    const EngineOps *ops;
+    void *state;
+}Engine;
+
+extern const EngineOps serialEngine;
+extern const EngineOps shardedEngine;
+extern const EngineOps sharedEngine;
+
+int engineCreate(Engine *engine, EngineType type, const EngineOptions *options);
+double engineRun(Engine *engine, uint64_t pointCount, double radius);
+uint64_t engineRunRange(Engine *engine, uint64_t firstPoint, uint64_t pointCount, double radius);
+int engineExtend(Engine *engine, const Estimate *prior, uint64_t pointCount, double radius, Estimate *estimate);
+double engineRunAdaptive(Engine *engine, double tolerance, double timeLimit, uint64_t pointLimit,
+                         double radius, uint64_t *pointsUsed, double *error);
+void engineDestroy(Engine *engine);
+const EngineStats* engineStats(Engine *engine);
+double calculateCircleArea(EngineType type, const EngineOptions *options, uint64_t pointCount, double radius,
+                           double timeLimit);
+int engineTypeFromName(const char *name, EngineType *type);
+const char* engineTypeName(EngineType type);
+int strategyFromName(const char *name, Strategy *strategy);
+const char* strategyName(Strategy strategy);
+
+#endif //ENGINE_H
@@ -0,0 +1,286 @@
+/* ESTIMATOR.C
+ *
+ * Hit or miss, stratified, antithetic and sample mean estimators. See estimator.h.
+ *
+ * As the kernels do, each estimator works in the quadrant [0, r)^2 of the square.
+ * xoshiro256** streams are read lane by lane, point n of a run from lane n mod
+ * RANDOM_LANES, so consecutive points do not wait on each other, and a range drawn in
+ * several calls uses the same lanes as in one.
+ *
+ */
+#include <string.h>
+#include <math.h>
+#include "estimator.h"
+#include "kernel.h"
+
+static const char *estimatorNames[] = {
+    [ESTIMATOR_HIT] = "hit",
+    [ESTIMATOR_STRATIFIED] = "stratified",
+    [ESTIMATOR_ANTITHETIC] = "antithetic",
+    [ESTIMATOR_MEAN] = "mean"
+};
+
+/*
+ * Function: nextBits
+ * ------------------------
+ * @param *stream - The stream to read from
+ * @param lane    - Lane of a xoshiro256** stream to read, ignored by Philox streams
+ *
+ * @return uint64_t of the next random number of the lane
+ */
+static inline uint64_t nextBits(RandomStream *stream, int lane){
+    return stream->type == RANDOM_PHILOX ? philoxNext(stream) : xoshiroLaneNext(stream->state, lane);
+}
+
+/*
+ * Function: unitInterval
+ * ------------------------
+ * @param bits - 64 random bits
+ *
+ * @return double in the range [0, 1) made from the top 53 bits
+ */
+static inline double unitInterval(uint64_t bits){
+    return (double)(bits >> 11) * 0x1.0p-53;
+}
+
+/*
+ * Function: sampleStratified
+ * ------------------------
+ * @param *stream      - The stream to draw points from
+ * @param radius       - Radius of the circle
+ * @param firstIndex   - Index of the first point in the run, which picks its cell
+ * @param pointCount   - Number of points to draw
+ * @param *batchScores - Set to the score of each batch of RANDOM_LANES points, NULL to
+ *                       only return the total
+ *
+ * @return uint64_t of the number of points inside the circle
+ */
+static uint64_t sampleStratified(RandomStream *stream, double radius, uint64_t firstIndex, uint64_t pointCount,
+                                 uint32_t *batchScores){
+    const double cellSize = radius / ESTIMATOR_GRID;
+    const double radiusSquared = radius * radius;
+    uint64_t circlePoints = 0;
+
+    for(uint64_t i = 0; i < pointCount; i++){
+        int lane = (int)((firstIndex + i) % RANDOM_LANES);
+        unsigned cell = (unsigned)((firstIndex + i) % ESTIMATOR_CELLS);
+        double x = (cell % ESTIMATOR_GRID + unitInterval(nextBits(stream, lane))) * cellSize;
+        double y = (cell / ESTIMATOR_GRID + unitInterval(nextBits(stream, lane))) * cellSize;
+        int inside = isInCircle(radiusSquared, x, y);
+        circlePoints += inside;
+        if(batchScores != NULL){
+            batchScores[i / RANDOM_LANES] += inside;
+        }
+    }
+    return circlePoints;
+}
+
+/*
+ * Function: sampleAntithetic
+ * ------------------------
+ * Points are drawn in pairs, the second point of a pair mirrors the first through the
+ * centre of the quadrant. An odd final point has no mirror.
+ *
+ * @param *stream      - The stream to draw points from
+ * @param radius       - Radius of the circle
+ * @param firstIndex   - Index of the first point in the run, which picks the lanes
+ * @param pointCount   - Number of points to draw
+ * @param *batchScores - Set to the score of each batch of RANDOM_LANES points, NULL to
+ *                       only return the total
+ *
+ * @return uint64_t of the number of points inside the circle
+ */
+static uint64_t sampleAntithetic(RandomStream *stream, double radius, uint64_t firstIndex, uint64_t pointCount,
+                                 uint32_t *batchScores){
+    const double radiusSquared = radius * radius;
+    uint64_t circlePoints = 0;
+
+    for(uint64_t i = 0; i < pointCount; i += 2){
+        int lane = (int)(((firstIndex + i) / 2) % RANDOM_LANES);
+        double u = unitInterval(nextBits(stream, lane));
+        double v = unitInterval(nextBits(stream, lane));
+        int inside = isInCircle(radiusSquared, u * radius, v * radius);
+        if(i + 1 < pointCount){
+            inside += isInCircle(radiusSquared, (1.0 - u) * radius, (1.0 - v) * radius);
+        }
+        circlePoints += inside;
+        if(batchScores != NULL){
+            batchScores[i / RANDOM_LANES] += inside; // Both points of a pair are in one batch
+        }
+    }
+    return circlePoints;
+}
+
+/*
+ * Function: sampleMean
+ * ------------------------
+ * Adds up the height of the quarter circle, as a fraction of the side r of the quadrant,
+ * at one random x per point, which does not depend on r. Heights are rounded to multiples
+ * of 1/ESTIMATOR_MEAN_UNIT, which moves the estimate by far less than its sampling error.
+ *
+ * @param *stream      - The stream to draw points from
+ * @param firstIndex   - Index of the first point in the run, which picks the lanes
+ * @param pointCount   - Number of points to draw
+ * @param *batchScores - Set to the score of each batch of RANDOM_LANES points, NULL to
+ *                       only return the total
+ *
+ * @return uint64_t of the sum of the heights, in units of 1/ESTIMATOR_MEAN_UNIT
+ */
+static uint64_t sampleMean(RandomStream *stream, uint64_t firstIndex, uint64_t pointCount, uint32_t *batchScores){
+    uint64_t score = 0;
+
+    for(uint64_t i = 0; i < pointCount; i++){
+        double x = unitInterval(nextBits(stream, (int)((firstIndex + i) % RANDOM_LANES)));
+        double height = sqrt(1.0 - x * x);
+        uint32_t pointScore = (uint32_t)(height * (double)ESTIMATOR_MEAN_UNIT + 0.5);
+        score += pointScore;
+        if(batchScores != NULL){
+            batchScores[i / RANDOM_LANES] += pointScore;
+        }
+    }
+    return score;
+}
+
+/*
+ * Function: estimatorSample
+ * ------------------------
+ * Draws points from a stream with an estimator.
+ *
+ * @param type         - The estimator
+ * @param *stream      - The stream to draw points from
+ * @param radius       - Radius of the circle
+ * @param firstIndex   - Index of the first point in the run, a multiple of RANDOM_LANES
+ * @param pointCount   - Number of points to draw
+ * @param *batchScores - Set to the score of each batch of RANDOM_LANES points of the call,
+ *                       NULL to only return the total
+ *
+ * @return uint64_t of the score of the points, in units of estimatorUnit per point inside
+ *         the circle
+ */
+uint64_t estimatorSample(EstimatorType type, RandomStream *stream, double radius, uint64_t firstIndex,
+                         uint64_t pointCount, uint32_t *batchScores){
+    if(batchScores != NULL && type != ESTIMATOR_HIT){
+        // The kernels store each batch, the other estimators add to it point by point
+        memset(batchScores, 0, sizeof(uint32_t) * ((pointCount + RANDOM_LANES - 1) / RANDOM_LANES));
+    }
+    switch(type){
+        case ESTIMATOR_STRATIFIED:
+            return sampleStratified(stream, radius, firstIndex, pointCount, batchScores);
+        case ESTIMATOR_ANTITHETIC:
+            return sampleAntithetic(stream, radius, firstIndex, pointCount, batchScores);
+        case ESTIMATOR_MEAN:
+            return sampleMean(stream, firstIndex, pointCount, batchScores);
+        default:
+            if(batchScores != NULL){
+                return countCirclePointsBatches(stream, radius, pointCount, batchScores);
+            }
+            return countCirclePoints(stream, radius, pointCount);
+    }
+}
+
+/*
+ * Function: estimatorSampleRange
+ * ------------------------
+ * Draws the points firstIndex to firstIndex + pointCount - 1 of a run with an estimator.
+ * The stream is seeded with randomSeedBlock at the start of every block of the range, so
+ * each point comes from the same position of the same block stream whichever thread draws
+ * it. A range that does not start on a block must continue, with the same stream, a range
+ * that ended at firstIndex.
+ *
+ * @param type         - The estimator
+ * @param *stream      - The stream to draw points from, of the generator of the run
+ * @param seed         - The seed of the run
+ * @param radius       - Radius of the circle
+ * @param firstIndex   - Index of the first point in the run, a multiple of RANDOM_LANES
+ * @param pointCount   - Number of points to draw
+ * @param *batchScores - Set to the score of each batch of RANDOM_LANES points of the range,
+ *                       NULL to only return the total
+ *
+ * @return uint64_t of the score of the points, see estimatorSample
+ */
+uint64_t estimatorSampleRange(EstimatorType type, RandomStream *stream, uint64_t seed, double radius,
+                              uint64_t firstIndex, uint64_t pointCount, uint32_t *batchScores){
+    uint64_t score = 0;
+
+    while(pointCount > 0){
+        uint64_t offset = firstIndex % RANDOM_BLOCK_POINTS;
+        uint64_t blockPoints = RANDOM_BLOCK_POINTS - offset < pointCount ? RANDOM_BLOCK_POINTS - offset : pointCount;
+        if(offset == 0){
+            randomSeedBlock(stream, stream->type, seed, firstIndex / RANDOM_BLOCK_POINTS);
+        }
+        score += estimatorSample(type, stream, radius, firstIndex, blockPoints, batchScores);
+        if(batchScores != NULL){
+            batchScores += blockPoints / RANDOM_LANES; // Blocks hold whole batches
+        }
+        firstIndex += blockPoints;
+        pointCount -= blockPoints;
+    }
+    return score;
+}
+
+/*
+ * Function: estimatorUnit
+ * ------------------------
+ * @param type - The estimator
+ *
+ * @return uint64_t of the score of one point fully inside the circle
+ */
+uint64_t estimatorUnit(EstimatorType type){
+    return type == ESTIMATOR_MEAN ? ESTIMATOR_MEAN_UNIT : 1;
+}
+
+/*
+ * Function: estimatorMaxPoints
+ * ------------------------
+ * @param type - The estimator
+ *
+ * @return uint64_t of the most points of one estimation, whose score can not overflow
+ */
+uint64_t estimatorMaxPoints(EstimatorType type){
+    return UINT64_MAX / estimatorUnit(type);
+}
+
+/*
+ * Function: estimatorArea
+ * ------------------------
+ * @param type       - The estimator
+ * @param score      - Total score of the points
+ * @param pointCount - Number of points
+ * @param radius     - Radius of the circle
+ *
+ * @return double of the area of the circle
+ */
+double estimatorArea(EstimatorType type, uint64_t score, uint64_t pointCount, double radius){
+    return ((double)score/((double)pointCount*(double)estimatorUnit(type)))*4*radius*radius;
+}
+
+/*
+ * Function: estimatorTypeFromName
+ * ------------------------
+ * Converts an estimator name given on the command line into an EstimatorType.
+ *
+ * @param *name - "hit", "stratified", "antithetic" or "mean"
+ * @param *type - Set to the matching estimator
+ *
+ * @return int of 1 if the name is known, otherwise returns 0
+ */
+int estimatorTypeFromName(const char *name, EstimatorType *type){
+    for(int i = 0; i < (int)(sizeof(estimatorNames) / sizeof(estimatorNames[0])); i++){
+        if(strcmp(name, estimatorNames[i]) == 0){
+            *type = (EstimatorType) i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Function: estimatorTypeName
+ * ------------------------
+ * @param type - The estimator
+ *
+ * @return const char* of the name of the estimator
+ */
+const char* estimatorTypeName(EstimatorType type){
+    return estimatorNames[type];
+}
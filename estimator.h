@@ -0,0 +1,58 @@
+/* ESTIMATOR.H
+ *
+ * Monte Carlo estimators of the area. Each draws points from a worker's random number
+ * stream and returns a score per chunk, which the engines add up as they add up circle
+ * points. The area is the mean score per point, in units of estimatorUnit, times 4r^2.
+ *
+ *   hit        - Hit or miss: the fraction of points of the square inside the circle.
+ *                Uses the sampling kernels of kernel.h.
+ *   stratified - Hit or miss with point n drawn inside cell n mod ESTIMATOR_CELLS of a
+ *                ESTIMATOR_GRID x ESTIMATOR_GRID grid over the quadrant, so every cell gets
+ *                its share of points and only the cells the edge crosses add variance.
+ *   antithetic - Hit or miss on pairs of points (u, v) and (r - u, r - v) of the quadrant,
+ *                whose hits are negatively correlated. Two points per two random numbers.
+ *   mean       - Sample mean: the mean height sqrt(r^2 - u^2) of the quarter circle at a
+ *                random u, one random number per point instead of two.
+ *
+ * At equal point counts the confidence interval of stratified, antithetic and mean is
+ * about 0.2, 0.85 and 0.55 times that of hit, so the same precision needs about 4%, 73%
+ * and 30% of the points. The scores of mean are fixed point, which limits a run to 2^44
+ * points.
+ *
+ */
+#ifndef ESTIMATOR_H
+#define ESTIMATOR_H
+
+#include <stdint.h>
+#include "random.h"
+
+/* Enum: EstimatorType
+ * The estimators of the area.
+ */
+typedef enum EstimatorTypeEnum{
+    ESTIMATOR_HIT,
+    ESTIMATOR_STRATIFIED,
+    ESTIMATOR_ANTITHETIC,
+    ESTIMATOR_MEAN
+}EstimatorType;
+
+// Cells along each side of the grid of the stratified estimator, and cells in the grid.
+// Chunks of the scheduler are a multiple of ESTIMATOR_CELLS points, so each is balanced.
+#define ESTIMATOR_GRID 32
+#define ESTIMATOR_CELLS (ESTIMATOR_GRID * ESTIMATOR_GRID)
+
+// Score of a point of height 1 with the sample mean estimator. Scores are added up in a
+// uint64_t, so a run of the sample mean estimator draws at most 2^44 points.
+#define ESTIMATOR_MEAN_UNIT (1ULL << 20)
+
+uint64_t estimatorSample(EstimatorType type, RandomStream *stream, double radius, uint64_t firstIndex,
+                         uint64_t pointCount, uint32_t *batchScores);
+uint64_t estimatorSampleRange(EstimatorType type, RandomStream *stream, uint64_t seed, double radius,
+                              uint64_t firstIndex, uint64_t pointCount, uint32_t *batchScores);
+uint64_t estimatorUnit(EstimatorType type);
+uint64_t estimatorMaxPoints(EstimatorType type);
+double estimatorArea(EstimatorType type, uint64_t score, uint64_t pointCount, double radius);
+int estimatorTypeFromName(const char *name, EstimatorType *type);
+const char* estimatorTypeName(EstimatorType type);
+
+#endif //ESTIMATOR_H
@@ -0,0 +1,1136 @@
+/* KERNEL.C
+ *
+ * Scalar and vector (SSE2, AVX2, AVX-512) versions of the sampling kernel, and the
+ * dispatch table that binds the best version the CPU supports.
+ *
+ * xoshiro256** streams are consumed in batches of RANDOM_LANES points: point j of a
+ * batch takes its x and then its y coordinate from lane j of the stream. A final partial
+ * batch still advances every lane, the extra points are just not counted. Every kernel
+ * follows this rule, so they all return the same count for the same stream.
+ *
+ * The float kernels take one random number per point instead: point j of a batch takes
+ * x from the low and y from the high 32 bits of the next number of lane j. The float
+ * kernels also all return the same count for the same stream. See Precision in kernel.h.
+ *
+ * The fixed point kernel instead takes one random number per point, split into two 32 bit
+ * coordinates, so it draws half as many random numbers and never converts to double. Its
+ * counts differ from the other kernels' but estimate the same area.
+ *
+ * Each kernel body is inlined into three functions by KERNEL_VARIANTS: one for any radius,
+ * which scales the coordinates by r and compares with r^2, both loaded once per call, one
+ * for the unit circle, where the constant 1 folds the scaling away, and one that also
+ * stores the count of each batch of RANDOM_LANES points, for callers that publish every
+ * batch. The batch counts are only computed in the third, where batchCircles is not NULL.
+ *
+ */
+#include <string.h>
+#include "kernel.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KERNEL_X86
+#include <immintrin.h>
+#endif
+
+// Bit pattern of the double 1.0, or'd with 52 random mantissa bits to give [1, 2)
+#define DOUBLE_ONE_BITS 0x3FF0000000000000ULL
+
+// Bit pattern of the float 1.0, or'd with 23 random mantissa bits to give [1, 2)
+#define FLOAT_ONE_BITS 0x3F800000U
+
+// Defines name, a kernel for any radius, name##Unit, a kernel for the unit circle, and
+// name##Batches, a kernel for any radius that also counts each batch, from the always
+// inlined body name##Body. target is the function's target attribute.
+#define KERNEL_VARIANTS(target, name) \
+    target static uint64_t name(RandomStream *stream, double radius, uint64_t pointCount){ \
+        return name##Body(stream, radius, pointCount, NULL); \
+    } \
+    target static uint64_t name##Unit(RandomStream *stream, double radius, uint64_t pointCount){ \
+        (void) radius; \
+        return name##Body(stream, 1.0, pointCount, NULL); \
+    } \
+    target static uint64_t name##Batches(RandomStream *stream, double radius, uint64_t pointCount, \
+                                         uint32_t *batchCircles){ \
+        return name##Body(stream, radius, pointCount, batchCircles); \
+    }
+
+/*
+ * Function: countCirclePointsScalarBody
+ * ------------------------
+ * Portable kernel, one point at a time.
+ *
+ * @param *stream       - The stream to draw points from
+ * @param radius        - Radius of the circle
+ * @param pointCount    - Number of points to draw
+ * @param *batchCircles - Set to the number of points inside the circle of each batch of
+ *                        RANDOM_LANES points, NULL to only return the total
+ *
+ * @return uint64_t of the number of points inside the circle
+ */
+static inline __attribute__((always_inline)) uint64_t countCirclePointsScalarBody(RandomStream *stream, double radius,
+                                                                                  uint64_t pointCount,
+                                                                                  uint32_t *batchCircles){
+    const double radiusSquared = radius * radius;
+    uint64_t circlePoints = 0;
+
+    for(uint64_t i = 0; i < pointCount; i += RANDOM_LANES){
+        uint64_t batchPoints = pointCount - i < RANDOM_LANES ? pointCount - i : RANDOM_LANES;
+        uint32_t batchCirclePoints = 0;
+
+        if(stream->type == RANDOM_PHILOX){
+            for(uint64_t j = 0; j < batchPoints; j++){
+                double x = randomCoordinate(stream) * radius;
+                double y = randomCoordinate(stream) * radius;
+                batchCirclePoints += isInCircle(radiusSquared, x, y);
+            }
+        } else {
+            for(int lane = 0; lane < RANDOM_LANES; lane++){
+                double x = randomBitsToCoordinate(xoshiroLaneNext(stream->state, lane)) * radius;
+                double y = randomBitsToCoordinate(xoshiroLaneNext(stream->state, lane)) * radius;
+                batchCirclePoints += (uint64_t)lane < batchPoints && isInCircle(radiusSquared, x, y);
+            }
+        }
+        if(batchCircles != NULL){
+            batchCircles[i / RANDOM_LANES] = batchCirclePoints;
+        }
+        circlePoints += batchCirclePoints;
+    }
+    return circlePoints;
+}
+
+KERNEL_VARIANTS(, countCirclePointsScalar)
+
+/*
+ * Function: countCirclePointsScalarFloatBody
+ * ------------------------
+ * Portable float kernel, one point at a time.
+ *
+ * @param *stream       - The xoshiro256** stream to draw points from
+ * @param radius        - Radius of the circle
+ * @param pointCount    - Number of points to draw
+ * @param *batchCircles - Set to the number of points inside the circle of each batch of
+ *                        RANDOM_LANES points, NULL to only return the total
+ *
+ * @return uint64_t of the number of points inside the circle
+ */
+static inline __attribute__((always_inline)) uint64_t countCirclePointsScalarFloatBody(RandomStream *stream,
+                                                                                       double radius,
+                                                                                       uint64_t pointCount,
+                                                                                       uint32_t *batchCircles){
+    uint64_t circlePoints = 0;
+    const float radiusFloat = (float) radius;
+    const float radiusSquared = (float)(radius * radius);
+
+    for(uint64_t i = 0; i < pointCount; i += RANDOM_LANES){
+        uint64_t batchPoints = pointCount - i < RANDOM_LANES ? pointCount - i : RANDOM_LANES;
+        uint32_t batchCirclePoints = 0;
+
+        for(int lane = 0; lane < RANDOM_LANES; lane++){
+            uint64_t bits = xoshiroLaneNext(stream->state, lane);
+            batchCirclePoints += (uint64_t)lane < batchPoints && isInCircleFloat(radiusFloat, radiusSquared, bits);
+        }
+        if(batchCircles != NULL){
+            batchCircles[i / RANDOM_LANES] = batchCirclePoints;
+        }
+        circlePoints += batchCirclePoints;
+    }
+    return circlePoints;
+}
+
+KERNEL_VARIANTS(, countCirclePointsScalarFloat)
+
+/*
+ * Function: countCirclePointsFixedBody
+ * ------------------------
+ * Branch free integer kernel, one random number per point. xoshiro256** streams are read
+ * one number per lane per batch of RANDOM_LANES points. The 32 bit coordinates are the
+ * lower corners of cells 2^-32 wide, which overcounts by about 2^-31 of the points, far
+ * below the sampling error of any feasible run.
+ *
+ * @param *stream       - The stream to draw points from
+ * @param radius        - Radius of the circle, unused: the fraction of points inside does not
+ *                        depend on it
+ * @param pointCount    - Number of points to draw
+ * @param *batchCircles - Set to the number of points inside the circle of each batch of
+ *                        RANDOM_LANES points, NULL to only return the total
+ *
+ * @return uint64_t of the number of points inside the circle
+ */
+static inline __attribute__((always_inline)) uint64_t countCirclePointsFixedBody(RandomStream *stream, double radius,
+                                                                                 uint64_t pointCount,
+                                                                                 uint32_t *batchCircles){
+    uint64_t circlePoints = 0;
+    (void) radius;
+
+    for(uint64_t i = 0; i < pointCount; i += RANDOM_LANES){
+        uint64_t batchPoints = pointCount - i < RANDOM_LANES ? pointCount - i : RANDOM_LANES;
+        uint32_t batchCirclePoints = 0;
+
+        if(stream->type == RANDOM_PHILOX){
+            for(uint64_t j = 0; j < batchPoints; j++){
+                batchCirclePoints += isInCircleFixed(philoxNext(stream));
+            }
+        } else {
+            for(int lane = 0; lane < RANDOM_LANES; lane++){
+                uint32_t inside = isInCircleFixed(xoshiroLaneNext(stream->state, lane));
+                batchCirclePoints += inside & ((uint64_t)lane < batchPoints);
+            }
+        }
+        if(batchCircles != NULL){
+            batchCircles[i / RANDOM_LANES] = batchCirclePoints;
+        }
+        circlePoints += batchCirclePoints;
+    }
+    return circlePoints;
+}
+
+KERNEL_VARIANTS(, countCirclePointsFixed)
+
+#ifdef KERNEL_X86
+
+/*
+ * Function: sse2Next
+ * ------------------------
+ * Advances two xoshiro256** lanes by one step.
+ *
+ * @param s - The four state words, each holding two lanes
+ *
+ * @return __m128i of the next random number of each lane
+ */
+__attribute__((target("sse2")))
+static inline __m128i sse2Next(__m128i s[4]){
+    __m128i times5 = _mm_add_epi64(_mm_slli_epi64(s[1], 2), s[1]);
+    __m128i rotated = _mm_or_si128(_mm_slli_epi64(times5, 7), _mm_srli_epi64(times5, 57));
+    __m128i result = _mm_add_epi64(_mm_slli_epi64(rotated, 3), rotated);
+    __m128i t = _mm_slli_epi64(s[1], 17);
+
+    s[2] = _mm_xor_si128(s[2], s[0]);
+    s[3] = _mm_xor_si128(s[3], s[1]);
+    s[1] = _mm_xor_si128(s[1], s[2]);
+    s[0] = _mm_xor_si128(s[0], s[3]);
+    s[2] = _mm_xor_si128(s[2], t);
+    s[3] = _mm_or_si128(_mm_slli_epi64(s[3], 45), _mm_srli_epi64(s[3], 19));
+
+    return result;
+}
+
+/*
+ * Function: sse2Sum
+ * ------------------------
+ * @param v - Two 64 bit counts
+ *
+ * @return uint32_t of the sum of the counts
+ */
+__attribute__((target("sse2")))
+static inline uint32_t sse2Sum(__m128i v){
+    uint64_t counts[2];
+    _mm_storeu_si128((__m128i*) counts, v);
+    return (uint32_t)(counts[0] + counts[1]);
+}
+
+/*
+ * Function: sse2InCircle
+ * ------------------------
+ * Draws two points from two lanes and tests them against the circle.
+ *
+ * @param s             - The four state words, each holding two lanes
+ * @param radius        - Radius of the circle, in every element
+ * @param radiusSquared - Radius of the circle squared, in every element
+ *
+ * @return __m128i with all bits set in the elements whose point is inside the circle
+ */
+__attribute__((target("sse2")))
+static inline __m128i sse2InCircle(__m128i s[4], __m128d radius, __m128d radiusSquared){
+    const __m128i one = _mm_set1_epi64x(DOUBLE_ONE_BITS);
+    __m128d x = _mm_castsi128_pd(_mm_or_si128(_mm_srli_epi64(sse2Next(s), 12), one));
+    __m128d y = _mm_castsi128_pd(_mm_or_si128(_mm_srli_epi64(sse2Next(s), 12), one));
+
+    x = _mm_mul_pd(_mm_sub_pd(x, _mm_set1_pd(1.0)), radius);
+    y = _mm_mul_pd(_mm_sub_pd(y, _mm_set1_pd(1.0)), radius);
+
+    __m128d distance = _mm_add_pd(_mm_mul_pd(x, x), _mm_mul_pd(y, y));
+    return _mm_castpd_si128(_mm_cmplt_pd(distance, radiusSquared));
+}
+
+/*
+ * Function: countCirclePointsSse2Body
+ * ------------------------
+ * SSE2 kernel. The eight lanes of the stream are held in four sets of registers.
+ *
+ * @param *stream       - The xoshiro256** stream to draw points from
+ * @param radius        - Radius of the circle
+ * @param pointCount    - Number of points to draw
+ * @param *batchCircles - Set to the number of points inside the circle of each batch of
+ *                        RANDOM_LANES points, NULL to only return the total
+ *
+ * @return uint64_t of the number of points inside the circle
+ */
+__attribute__((target("sse2")))
+static inline __attribute__((always_inline)) uint64_t countCirclePointsSse2Body(RandomStream *stream, double radius,
+                                                                                uint64_t pointCount,
+                                                                                uint32_t *batchCircles){
+    __m128i s[RANDOM_LANES / 2][4];
+    __m128i hits[RANDOM_LANES / 2];
+    for(int set = 0; set < RANDOM_LANES / 2; set++){
+        for(int i = 0; i < 4; i++){
+            s[set][i] = _mm_loadu_si128((const __m128i*) &stream->state[i][set * 2]);
+        }
+        hits[set] = _mm_setzero_si128();
+    }
+
+    const __m128d radiusVector = _mm_set1_pd(radius);
+    const __m128d radiusSquared = _mm_set1_pd(radius * radius);
+    uint64_t batches = pointCount / RANDOM_LANES;
+    uint64_t remainingPoints = pointCount % RANDOM_LANES;
+
+    for(uint64_t i = 0; i < batches; i++){
+        __m128i batchHits = _mm_setzero_si128();
+        for(int set = 0; set < RANDOM_LANES / 2; set++){
+            __m128i inside = sse2InCircle(s[set], radiusVector, radiusSquared);
+            hits[set] = _mm_sub_epi64(hits[set], inside);
+            batchHits = _mm_sub_epi64(batchHits, inside);
+        }
+        if(batchCircles != NULL){
+            batchCircles[i] = sse2Sum(batchHits);
+        }
+    }
+
+    if(remainingPoints){
+        // SSE2 has no 64 bit compare, so the mask of lanes to count is built in memory
+        int64_t laneMask[RANDOM_LANES];
+        __m128i batchHits = _mm_setzero_si128();
+        for(int lane = 0; lane < RANDOM_LANES; lane++){
+            laneMask[lane] = (uint64_t)lane < remainingPoints ? -1 : 0;
+        }
+        for(int set = 0; set < RANDOM_LANES / 2; set++){
+            __m128i mask = _mm_loadu_si128((const __m128i*) &laneMask[set * 2]);
+            __m128i inside = _mm_and_si128(mask, sse2InCircle(s[set], radiusVector, radiusSquared));
+            hits[set] = _mm_sub_epi64(hits[set], inside);
+            batchHits = _mm_sub_epi64(batchHits, inside);
+        }
+        if(batchCircles != NULL){
+            batchCircles[batches] = sse2Sum(batchHits);
+        }
+    }
+
+    uint64_t total = 0;
+    for(int set = 0; set < RANDOM_LANES / 2; set++){
+        uint64_t setHits[2];
+        for(int i = 0; i < 4; i++){
+            _mm_storeu_si128((__m128i*) &stream->state[i][set * 2], s[set][i]);
+        }
+        _mm_storeu_si128((__m128i*) setHits, hits[set]);
+        total += setHits[0] + setHits[1];
+    }
+    return total;
+}
+
+KERNEL_VARIANTS(__attribute__((target("sse2"))), countCirclePointsSse2)
+
+/*
+ * Function: sse2InCircleFloat
+ * ------------------------
+ * Draws two points from two lanes, each held as four floats x, y, x, y, and tests them
+ * against the circle. Swapping neighbouring squares adds y^2 to x^2 in every element.
+ *
+ * @param s             - The four state words, each holding two lanes
+ * @param radius        - Radius of the circle, in every element
+ * @param radiusSquared - Radius of the circle squared, in every element
+ *
+ * @return __m128i with 1 in the 64 bit elements whose point is inside the circle
+ */
+__attribute__((target("sse2")))
+static inline __m128i sse2InCircleFloat(__m128i s[4], __m128 radius, __m128 radiusSquared){
+    __m128i mantissa = _mm_or_si128(_mm_srli_epi32(sse2Next(s), 9), _mm_set1_epi32(FLOAT_ONE_BITS));
+    __m128 value = _mm_castsi128_ps(mantissa);
+    __m128 xy = _mm_mul_ps(_mm_sub_ps(value, _mm_set1_ps(1.0f)), radius);
+
+    __m128 squared = _mm_mul_ps(xy, xy);
+    __m128 distance = _mm_add_ps(squared, _mm_shuffle_ps(squared, squared, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_and_si128(_mm_castps_si128(_mm_cmplt_ps(distance, radiusSquared)), _mm_set1_epi64x(1));
+}
+
+/*
+ * Function: countCirclePointsSse2FloatBody
+ * ------------------------
+ * SSE2 float kernel. The eight lanes of the stream are held in four sets of registers.
+ *
+ * @param *stream       - The xoshiro256** stream to draw points from
+ * @param radius        - Radius of the circle
+ * @param pointCount    - Number of points to draw
+ * @param *batchCircles - Set to the number of points inside the circle of each batch of
+ *                        RANDOM_LANES points, NULL to only return the total
+ *
+ * @return uint64_t of the number of points inside the circle
+ */
+__attribute__((target("sse2")))
+static inline __attribute__((always_inline)) uint64_t countCirclePointsSse2FloatBody(RandomStream *stream,
+                                                                                     double radius,
+                                                                                     uint64_t pointCount,
+                                                                                     uint32_t *batchCircles){
+    __m128i s[RANDOM_LANES / 2][4];
+    __m128i hits[RANDOM_LANES / 2];
+    for(int set = 0; set < RANDOM_LANES / 2; set++){
+        for(int i = 0; i < 4; i++){
+            s[set][i] = _mm_loadu_si128((const __m128i*) &stream->state[i][set * 2]);
+        }
+        hits[set] = _mm_setzero_si128();
+    }
+
+    const __m128 radiusVector = _mm_set1_ps((float) radius);
+    const __m128 radiusSquared = _mm_set1_ps((float)(radius * radius));
+    uint64_t batches = pointCount / RANDOM_LANES;
+    uint64_t remainingPoints = pointCount % RANDOM_LANES;
+
+    for(uint64_t i = 0; i < batches; i++){
+        __m128i batchHits = _mm_setzero_si128();
+        for(int set = 0; set < RANDOM_LANES / 2; set++){
+            __m128i inside = sse2InCircleFloat(s[set], radiusVector, radiusSquared);
+            hits[set] = _mm_add_epi64(hits[set], inside);
+            batchHits = _mm_add_epi64(batchHits, inside);
+        }
+        if(batchCircles != NULL){
+            batchCircles[i] = sse2Sum(batchHits);
+        }
+    }
+
+    if(remainingPoints){
+        int64_t laneMask[RANDOM_LANES];
+        __m128i batchHits = _mm_setzero_si128();
+        for(int lane = 0; lane < RANDOM_LANES; lane++){
+            laneMask[lane] = (uint64_t)lane < remainingPoints ? -1 : 0;
+        }
+        for(int set = 0; set < RANDOM_LANES / 2; set++){
+            __m128i mask = _mm_loadu_si128((const __m128i*) &laneMask[set * 2]);
+            __m128i inside = _mm_and_si128(mask, sse2InCircleFloat(s[set], radiusVector, radiusSquared));
+            hits[set] = _mm_add_epi64(hits[set], inside);
+            batchHits = _mm_add_epi64(batchHits, inside);
+        }
+        if(batchCircles != NULL){
+            batchCircles[batches] = sse2Sum(batchHits);
+        }
+    }
+
+    uint64_t total = 0;
+    for(int set = 0; set < RANDOM_LANES / 2; set++){
+        uint64_t setHits[2];
+        for(int i = 0; i < 4; i++){
+            _mm_storeu_si128((__m128i*) &stream->state[i][set * 2], s[set][i]);
+        }
+        _mm_storeu_si128((__m128i*) setHits, hits[set]);
+        total += setHits[0] + setHits[1];
+    }
+    return total;
+}
+
+KERNEL_VARIANTS(__attribute__((target("sse2"))), countCirclePointsSse2Float)
+
+/*
+ * Function: avx2Next
+ * ------------------------
+ * Advances four xoshiro256** lanes by one step. AVX2 has no 64 bit multiply or rotate,
+ * so *5 and *9 are done with shift and add, and rotates with two shifts.
+ *
+ * @param s - The four state words, each holding four lanes
+ *
+ * @return __m256i of the next random number of each lane
+ */
+__attribute__((target("avx2")))
+static inline __m256i avx2Next(__m256i s[4]){
+    __m256i times5 = _mm256_add_epi64(_mm256_slli_epi64(s[1], 2), s[1]);
+    __m256i rotated = _mm256_or_si256(_mm256_slli_epi64(times5, 7), _mm256_srli_epi64(times5, 57));
+    __m256i result = _mm256_add_epi64(_mm256_slli_epi64(rotated, 3), rotated);
+    __m256i t = _mm256_slli_epi64(s[1], 17);
+
+    s[2] = _mm256_xor_si256(s[2], s[0]);
+    s[3] = _mm256_xor_si256(s[3], s[1]);
+    s[1] = _mm256_xor_si256(s[1], s[2]);
+    s[0] = _mm256_xor_si256(s[0], s[3]);
+    s[2] = _mm256_xor_si256(s[2], t);
+    s[3] = _mm256_or_si256(_mm256_slli_epi64(s[3], 45), _mm256_srli_epi64(s[3], 19));
+
+    return result;
+}
+
+/*
+ * Function: avx2Coordinate
+ * ------------------------
+ * Vector version of randomBitsToCoordinate, scaled by the radius.
+ *
+ * @param bits   - Four 64 bit random numbers
+ * @param radius - Radius of the circle, in every element
+ *
+ * @return __m256d of four doubles in the range [0, r)
+ */
+__attribute__((target("avx2")))
+static inline __m256d avx2Coordinate(__m256i bits, __m256d radius){
+    __m256i mantissa = _mm256_or_si256(_mm256_srli_epi64(bits, 12), _mm256_set1_epi64x(DOUBLE_ONE_BITS));
+    __m256d value = _mm256_castsi256_pd(mantissa);
+    return _mm256_mul_pd(_mm256_sub_pd(value, _mm256_set1_pd(1.0)), radius);
+}
+
+/*
+ * Function: avx2Sum
+ * ------------------------
+ * @param v - Four 64 bit counts
+ *
+ * @return uint32_t of the sum of the counts
+ */
+__attribute__((target("avx2")))
+static inline uint32_t avx2Sum(__m256i v){
+    uint64_t counts[4];
+    _mm256_storeu_si256((__m256i*) counts, v);
+    return (uint32_t)(counts[0] + counts[1] + counts[2] + counts[3]);
+}
+
+/*
+ * Function: avx2InCircle
+ * ------------------------
+ * Draws four points from four lanes and tests them against the circle.
+ *
+ * @param s             - The four state words, each holding four lanes
+ * @param radius        - Radius of the circle, in every element
+ * @param radiusSquared - Radius of the circle squared, in every element
+ *
+ * @return __m256i with all bits set in the elements whose point is inside the circle
+ */
+__attribute__((target("avx2")))
+static inline __m256i avx2InCircle(__m256i s[4], __m256d radius, __m256d radiusSquared){
+    __m256d x = avx2Coordinate(avx2Next(s), radius);
+    __m256d y = avx2Coordinate(avx2Next(s), radius);
+    __m256d distance = _mm256_add_pd(_mm256_mul_pd(x, x), _mm256_mul_pd(y, y));
+    return _mm256_castpd_si256(_mm256_cmp_pd(distance, radiusSquared, _CMP_LT_OQ));
+}
+
+/*
+ * Function: countCirclePointsAvx2Body
+ * ------------------------
+ * AVX2 kernel. Lanes 0-3 and 4-7 of the stream are held in two sets of registers,
+ * hits are counted per element by subtracting the all-ones comparison masks.
+ *
+ * @param *stream       - The xoshiro256** stream to draw points from
+ * @param radius        - Radius of the circle
+ * @param pointCount    - Number of points to draw
+ * @param *batchCircles - Set to the number of points inside the circle of each batch of
+ *                        RANDOM_LANES points, NULL to only return the total
+ *
+ * @return uint64_t of the number of points inside the circle
+ */
+__attribute__((target("avx2")))
+static inline __attribute__((always_inline)) uint64_t countCirclePointsAvx2Body(RandomStream *stream, double radius,
+                                                                                uint64_t pointCount,
+                                                                                uint32_t *batchCircles){
+    __m256i low[4], high[4];
+    for(int i = 0; i < 4; i++){
+        low[i] = _mm256_loadu_si256((const __m256i*) &stream->state[i][0]);
+        high[i] = _mm256_loadu_si256((const __m256i*) &stream->state[i][4]);
+    }
+
+    const __m256d radiusVector = _mm256_set1_pd(radius);
+    const __m256d radiusSquared = _mm256_set1_pd(radius * radius);
+    __m256i lowHits = _mm256_setzero_si256();
+    __m256i highHits = _mm256_setzero_si256();
+    uint64_t batches = pointCount / RANDOM_LANES;
+    uint64_t remainingPoints = pointCount % RANDOM_LANES;
+
+    for(uint64_t i = 0; i < batches; i++){
+        __m256i lowInside = avx2InCircle(low, radiusVector, radiusSquared);
+        __m256i highInside = avx2InCircle(high, radiusVector, radiusSquared);
+        lowHits = _mm256_sub_epi64(lowHits, lowInside);
+        highHits = _mm256_sub_epi64(highHits, highInside);
+        if(batchCircles != NULL){
+            batchCircles[i] = avx2Sum(_mm256_sub_epi64(_mm256_setzero_si256(), _mm256_add_epi64(lowInside, highInside)));
+        }
+    }
+
+    if(remainingPoints){
+        // Only count the lanes below remainingPoints
+        __m256i remaining = _mm256_set1_epi64x((long long) remainingPoints);
+        __m256i lowMask = _mm256_cmpgt_epi64(remaining, _mm256_set_epi64x(3, 2, 1, 0));
+        __m256i highMask = _mm256_cmpgt_epi64(remaining, _mm256_set_epi64x(7, 6, 5, 4));
+        __m256i lowInside = _mm256_and_si256(lowMask, avx2InCircle(low, radiusVector, radiusSquared));
+        __m256i highInside = _mm256_and_si256(highMask, avx2InCircle(high, radiusVector, radiusSquared));
+        lowHits = _mm256_sub_epi64(lowHits, lowInside);
+        highHits = _mm256_sub_epi64(highHits, highInside);
+        if(batchCircles != NULL){
+            batchCircles[batches] = avx2Sum(_mm256_sub_epi64(_mm256_setzero_si256(), _mm256_add_epi64(lowInside, highInside)));
+        }
+    }
+
+    for(int i = 0; i < 4; i++){
+        _mm256_storeu_si256((__m256i*) &stream->state[i][0], low[i]);
+        _mm256_storeu_si256((__m256i*) &stream->state[i][4], high[i]);
+    }
+
+    uint64_t hits[4];
+    _mm256_storeu_si256((__m256i*) hits, _mm256_add_epi64(lowHits, highHits));
+    return hits[0] + hits[1] + hits[2] + hits[3];
+}
+
+KERNEL_VARIANTS(__attribute__((target("avx2"))), countCirclePointsAvx2)
+
+/*
+ * Function: avx2InCircleFloat
+ * ------------------------
+ * Draws four points from four lanes, as eight floats x, y, x, y, ..., and tests them
+ * against the circle.
+ *
+ * @param s             - The four state words, each holding four lanes
+ * @param radius        - Radius of the circle, in every element
+ * @param radiusSquared - Radius of the circle squared, in every element
+ *
+ * @return __m256i with 1 in the 64 bit elements whose point is inside the circle
+ */
+__attribute__((target("avx2")))
+static inline __m256i avx2InCircleFloat(__m256i s[4], __m256 radius, __m256 radiusSquared){
+    __m256i mantissa = _mm256_or_si256(_mm256_srli_epi32(avx2Next(s), 9), _mm256_set1_epi32(FLOAT_ONE_BITS));
+    __m256 value = _mm256_castsi256_ps(mantissa);
+    __m256 xy = _mm256_mul_ps(_mm256_sub_ps(value, _mm256_set1_ps(1.0f)), radius);
+
+    __m256 squared = _mm256_mul_ps(xy, xy);
+    __m256 distance = _mm256_add_ps(squared, _mm256_permute_ps(squared, _MM_SHUFFLE(2, 3, 0, 1)));
+    __m256 inside = _mm256_cmp_ps(distance, radiusSquared, _CMP_LT_OQ);
+    return _mm256_and_si256(_mm256_castps_si256(inside), _mm256_set1_epi64x(1));
+}
+
+/*
+ * Function: countCirclePointsAvx2FloatBody
+ * ------------------------
+ * AVX2 float kernel, with the same register layout as countCirclePointsAvx2Body.
+ *
+ * @param *stream       - The xoshiro256** stream to draw points from
+ * @param radius        - Radius of the circle
+ * @param pointCount    - Number of points to draw
+ * @param *batchCircles - Set to the number of points inside the circle of each batch of
+ *                        RANDOM_LANES points, NULL to only return the total
+ *
+ * @return uint64_t of the number of points inside the circle
+ */
+__attribute__((target("avx2")))
+static inline __attribute__((always_inline)) uint64_t countCirclePointsAvx2FloatBody(RandomStream *stream,
+                                                                                     double radius,
+                                                                                     uint64_t pointCount,
+                                                                                     uint32_t *batchCircles){
+    __m256i low[4], high[4];
+    for(int i = 0; i < 4; i++){
+        low[i] = _mm256_loadu_si256((const __m256i*) &stream->state[i][0]);
+        high[i] = _mm256_loadu_si256((const __m256i*) &stream->state[i][4]);
+    }
+
+    const __m256 radiusVector = _mm256_set1_ps((float) radius);
+    const __m256 radiusSquared = _mm256_set1_ps((float)(radius * radius));
+    __m256i lowHits = _mm256_setzero_si256();
+    __m256i highHits = _mm256_setzero_si256();
+    uint64_t batches = pointCount / RANDOM_LANES;
+    uint64_t remainingPoints = pointCount % RANDOM_LANES;
+
+    for(uint64_t i = 0; i < batches; i++){
+        __m256i lowInside = avx2InCircleFloat(low, radiusVector, radiusSquared);
+        __m256i highInside = avx2InCircleFloat(high, radiusVector, radiusSquared);
+        lowHits = _mm256_add_epi64(lowHits, lowInside);
+        highHits = _mm256_add_epi64(highHits, highInside);
+        if(batchCircles != NULL){
+            batchCircles[i] = avx2Sum(_mm256_add_epi64(lowInside, highInside));
+        }
+    }
+
+    if(remainingPoints){
+        __m256i remaining = _mm256_set1_epi64x((long long) remainingPoints);
+        __m256i lowMask = _mm256_cmpgt_epi64(remaining, _mm256_set_epi64x(3, 2, 1, 0));
+        __m256i highMask = _mm256_cmpgt_epi64(remaining, _mm256_set_epi64x(7, 6, 5, 4));
+        __m256i lowInside = _mm256_and_si256(lowMask, avx2InCircleFloat(low, radiusVector, radiusSquared));
+        __m256i highInside = _mm256_and_si256(highMask, avx2InCircleFloat(high, radiusVector, radiusSquared));
+        lowHits = _mm256_add_epi64(lowHits, lowInside);
+        highHits = _mm256_add_epi64(highHits, highInside);
+        if(batchCircles != NULL){
+            batchCircles[batches] = avx2Sum(_mm256_add_epi64(lowInside, highInside));
+        }
+    }
+
+    for(int i = 0; i < 4; i++){
+        _mm256_storeu_si256((__m256i*) &stream->state[i][0], low[i]);
+        _mm256_storeu_si256((__m256i*) &stream->state[i][4], high[i]);
+    }
+
+    uint64_t hits[4];
+    _mm256_storeu_si256((__m256i*) hits, _mm256_add_epi64(lowHits, highHits));
+    return hits[0] + hits[1] + hits[2] + hits[3];
+}
+
+KERNEL_VARIANTS(__attribute__((target("avx2"))), countCirclePointsAvx2Float)
+
+/*
+ * Function: avx512Next
+ * ------------------------
+ * Advances eight xoshiro256** lanes by one step.
+ *
+ * @param s - The four state words, each holding eight lanes
+ *
+ * @return __m512i of the next random number of each lane
+ */
+__attribute__((target("avx512f")))
+static inline __m512i avx512Next(__m512i s[4]){
+    __m512i times5 = _mm512_add_epi64(_mm512_slli_epi64(s[1], 2), s[1]);
+    __m512i rotated = _mm512_rol_epi64(times5, 7);
+    __m512i result = _mm512_add_epi64(_mm512_slli_epi64(rotated, 3), rotated);
+    __m512i t = _mm512_slli_epi64(s[1], 17);
+
+    s[2] = _mm512_xor_si512(s[2], s[0]);
+    s[3] = _mm512_xor_si512(s[3], s[1]);
+    s[1] = _mm512_xor_si512(s[1], s[2]);
+    s[0] = _mm512_xor_si512(s[0], s[3]);
+    s[2] = _mm512_xor_si512(s[2], t);
+    s[3] = _mm512_rol_epi64(s[3], 45);
+
+    return result;
+}
+
+/*
+ * Function: avx512Coordinate
+ * ------------------------
+ * Vector version of randomBitsToCoordinate, scaled by the radius.
+ *
+ * @param bits   - Eight 64 bit random numbers
+ * @param radius - Radius of the circle, in every element
+ *
+ * @return __m512d of eight doubles in the range [0, r)
+ */
+__attribute__((target("avx512f")))
+static inline __m512d avx512Coordinate(__m512i bits, __m512d radius){
+    __m512i mantissa = _mm512_or_si512(_mm512_srli_epi64(bits, 12), _mm512_set1_epi64(DOUBLE_ONE_BITS));
+    __m512d value = _mm512_castsi512_pd(mantissa);
+    return _mm512_mul_pd(_mm512_sub_pd(value, _mm512_set1_pd(1.0)), radius);
+}
+
+/*
+ * Function: avx512InCircle
+ * ------------------------
+ * Draws eight points, one from each lane, and tests them against the circle.
+ *
+ * @param s             - The four state words, each holding eight lanes
+ * @param radius        - Radius of the circle, in every element
+ * @param radiusSquared - Radius of the circle squared, in every element
+ *
+ * @return __mmask8 with a bit set for each point inside the circle
+ */
+__attribute__((target("avx512f")))
+static inline __mmask8 avx512InCircle(__m512i s[4], __m512d radius, __m512d radiusSquared){
+    __m512d x = avx512Coordinate(avx512Next(s), radius);
+    __m512d y = avx512Coordinate(avx512Next(s), radius);
+    __m512d distance = _mm512_add_pd(_mm512_mul_pd(x, x), _mm512_mul_pd(y, y));
+    return _mm512_cmp_pd_mask(distance, radiusSquared, _CMP_LT_OQ);
+}
+
+/*
+ * Function: countCirclePointsAvx512Body
+ * ------------------------
+ * AVX-512 kernel. All eight lanes of the stream fit in one set of registers, hits are
+ * counted per element with a masked add.
+ *
+ * @param *stream       - The xoshiro256** stream to draw points from
+ * @param radius        - Radius of the circle
+ * @param pointCount    - Number of points to draw
+ * @param *batchCircles - Set to the number of points inside the circle of each batch of
+ *                        RANDOM_LANES points, NULL to only return the total
+ *
+ * @return uint64_t of the number of points inside the circle
+ */
+__attribute__((target("avx512f")))
+static inline __attribute__((always_inline)) uint64_t countCirclePointsAvx512Body(RandomStream *stream, double radius,
+                                                                                  uint64_t pointCount,
+                                                                                  uint32_t *batchCircles){
+    __m512i s[4];
+    for(int i = 0; i < 4; i++){
+        s[i] = _mm512_loadu_si512(stream->state[i]);
+    }
+
+    const __m512d radiusVector = _mm512_set1_pd(radius);
+    const __m512d radiusSquared = _mm512_set1_pd(radius * radius);
+    const __m512i one = _mm512_set1_epi64(1);
+    __m512i hits = _mm512_setzero_si512();
+    uint64_t batches = pointCount / RANDOM_LANES;
+    uint64_t remainingPoints = pointCount % RANDOM_LANES;
+
+    for(uint64_t i = 0; i < batches; i++){
+        __mmask8 inside = avx512InCircle(s, radiusVector, radiusSquared);
+        hits = _mm512_mask_add_epi64(hits, inside, hits, one);
+        if(batchCircles != NULL){
+            batchCircles[i] = (uint32_t) __builtin_popcount(inside);
+        }
+    }
+
+    if(remainingPoints){
+        __mmask8 remainingMask = (__mmask8)((1U << remainingPoints) - 1);
+        __mmask8 inside = avx512InCircle(s, radiusVector, radiusSquared) & remainingMask;
+        hits = _mm512_mask_add_epi64(hits, inside, hits, one);
+        if(batchCircles != NULL){
+            batchCircles[batches] = (uint32_t) __builtin_popcount(inside);
+        }
+    }
+
+    for(int i = 0; i < 4; i++){
+        _mm512_storeu_si512(stream->state[i], s[i]);
+    }
+    return (uint64_t) _mm512_reduce_add_epi64(hits);
+}
+
+KERNEL_VARIANTS(__attribute__((target("avx512f"))), countCirclePointsAvx512)
+
+/*
+ * Function: avx512InCircleFloat
+ * ------------------------
+ * Draws eight points, one from each lane, as sixteen floats x, y, x, y, ..., and tests
+ * them against the circle.
+ *
+ * @param s             - The four state words, each holding eight lanes
+ * @param radius        - Radius of the circle, in every element
+ * @param radiusSquared - Radius of the circle squared, in every element
+ *
+ * @return __mmask16 with the even bit of each point inside the circle set, odd bits are
+ *         set or clear with it
+ */
+__attribute__((target("avx512f")))
+static inline __mmask16 avx512InCircleFloat(__m512i s[4], __m512 radius, __m512 radiusSquared){
+    __m512i mantissa = _mm512_or_si512(_mm512_srli_epi32(avx512Next(s), 9), _mm512_set1_epi32(FLOAT_ONE_BITS));
+    __m512 value = _mm512_castsi512_ps(mantissa);
+    __m512 xy = _mm512_mul_ps(_mm512_sub_ps(value, _mm512_set1_ps(1.0f)), radius);
+
+    __m512 squared = _mm512_mul_ps(xy, xy);
+    __m512 distance = _mm512_add_ps(squared, _mm512_permute_ps(squared, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm512_cmp_ps_mask(distance, radiusSquared, _CMP_LT_OQ);
+}
+
+/*
+ * Function: countCirclePointsAvx512FloatBody
+ * ------------------------
+ * AVX-512 float kernel. The 32 bit mask of each point selects the low half of a 64 bit
+ * element holding 1, so hits are counted per 64 bit element as in the double kernels.
+ *
+ * @param *stream       - The xoshiro256** stream to draw points from
+ * @param radius        - Radius of the circle
+ * @param pointCount    - Number of points to draw
+ * @param *batchCircles - Set to the number of points inside the circle of each batch of
+ *                        RANDOM_LANES points, NULL to only return the total
+ *
+ * @return uint64_t of the number of points inside the circle
+ */
+__attribute__((target("avx512f")))
+static inline __attribute__((always_inline)) uint64_t countCirclePointsAvx512FloatBody(RandomStream *stream,
+                                                                                       double radius,
+                                                                                       uint64_t pointCount,
+                                                                                       uint32_t *batchCircles){
+    __m512i s[4];
+    for(int i = 0; i < 4; i++){
+        s[i] = _mm512_loadu_si512(stream->state[i]);
+    }
+
+    const __m512 radiusVector = _mm512_set1_ps((float) radius);
+    const __m512 radiusSquared = _mm512_set1_ps((float)(radius * radius));
+    const __m512i one = _mm512_set1_epi64(1);
+    __m512i hits = _mm512_setzero_si512();
+    uint64_t batches = pointCount / RANDOM_LANES;
+    uint64_t remainingPoints = pointCount % RANDOM_LANES;
+
+    for(uint64_t i = 0; i < batches; i++){
+        __mmask16 inside = avx512InCircleFloat(s, radiusVector, radiusSquared);
+        hits = _mm512_add_epi64(hits, _mm512_maskz_mov_epi32(inside, one));
+        if(batchCircles != NULL){
+            batchCircles[i] = (uint32_t) __builtin_popcount(inside & 0x5555); // Even bits, one per point
+        }
+    }
+
+    if(remainingPoints){
+        __mmask16 remainingMask = (__mmask16)((1U << (2 * remainingPoints)) - 1);
+        __mmask16 inside = avx512InCircleFloat(s, radiusVector, radiusSquared) & remainingMask;
+        hits = _mm512_add_epi64(hits, _mm512_maskz_mov_epi32(inside, one));
+        if(batchCircles != NULL){
+            batchCircles[batches] = (uint32_t) __builtin_popcount(inside & 0x5555);
+        }
+    }
+
+    for(int i = 0; i < 4; i++){
+        _mm512_storeu_si512(stream->state[i], s[i]);
+    }
+    return (uint64_t) _mm512_reduce_add_epi64(hits);
+}
+
+KERNEL_VARIANTS(__attribute__((target("avx512f"))), countCirclePointsAvx512Float)
+
+#endif //KERNEL_X86
+
+// Kernel used for each RandomType, for any radius, for the unit circle and counting each
+// batch. Philox streams are not vectorised, so only the xoshiro256** entries are rebound
+// by kernelSelect, except for the fixed point kernel.
+static CircleKernel circleKernels[] = {
+    [RANDOM_XOSHIRO] = countCirclePointsScalar,
+    [RANDOM_PHILOX] = countCirclePointsScalar
+};
+static CircleKernel unitCircleKernels[] = {
+    [RANDOM_XOSHIRO] = countCirclePointsScalarUnit,
+    [RANDOM_PHILOX] = countCirclePointsScalarUnit
+};
+static BatchKernel batchKernels[] = {
+    [RANDOM_XOSHIRO] = countCirclePointsScalarBatches,
+    [RANDOM_PHILOX] = countCirclePointsScalarBatches
+};
+static KernelType selectedKernel = KERNEL_SCALAR;
+static Precision selectedPrecision = PRECISION_DOUBLE;
+
+static const char *kernelNames[] = {
+    [KERNEL_AUTO] = "auto",
+    [KERNEL_SCALAR] = "scalar",
+    [KERNEL_SSE2] = "sse2",
+    [KERNEL_AVX2] = "avx2",
+    [KERNEL_AVX512] = "avx512",
+    [KERNEL_FIXED] = "fixed"
+};
+
+static const char *precisionNames[] = {
+    [PRECISION_AUTO] = "auto",
+    [PRECISION_DOUBLE] = "double",
+    [PRECISION_FLOAT] = "float"
+};
+
+/*
+ * Function: kernelSupported
+ * ------------------------
+ * Checks whether the CPU running the program can execute a kernel.
+ *
+ * @param type - The kernel to check
+ *
+ * @return int of 1 if the kernel can be used, otherwise returns 0
+ */
+int kernelSupported(KernelType type){
+    switch(type){
+        case KERNEL_AUTO:
+        case KERNEL_SCALAR:
+        case KERNEL_FIXED:
+            return 1;
+#ifdef KERNEL_X86
+        case KERNEL_SSE2:
+            return __builtin_cpu_supports("sse2");
+        case KERNEL_AVX2:
+            return __builtin_cpu_supports("avx2");
+        case KERNEL_AVX512:
+            return __builtin_cpu_supports("avx512f");
+#endif
+        default:
+            return 0;
+    }
+}
+
+/*
+ * Function: kernelBest
+ * ------------------------
+ * @return KernelType of the widest kernel supported by the CPU
+ */
+KernelType kernelBest(void){
+    for(KernelType type = KERNEL_AVX512; type > KERNEL_SCALAR; type--){
+        if(kernelSupported(type)){
+            return type;
+        }
+    }
+    return KERNEL_SCALAR;
+}
+
+/*
+ * Function: kernelSelect
+ * ------------------------
+ * Binds the kernel used by countCirclePoints. Called once at startup, before any
+ * worker thread is created, so the hot path never checks CPU features.
+ *
+ * @param type      - The kernel to use, or KERNEL_AUTO for the widest one supported
+ * @param precision - Precision of the kernel, PRECISION_AUTO is taken as double, see
+ *                    precisionFor. The fixed point kernel ignores it.
+ *
+ * @return int of 1 if the kernel was bound, 0 if the CPU does not support it
+ */
+int kernelSelect(KernelType type, Precision precision){
+    if(type == KERNEL_AUTO){
+        type = kernelBest();
+    }
+    if(!kernelSupported(type)){
+        return 0;
+    }
+
+    int useFloat = precision == PRECISION_FLOAT;
+    circleKernels[RANDOM_PHILOX] = countCirclePointsScalar;
+    unitCircleKernels[RANDOM_PHILOX] = countCirclePointsScalarUnit;
+    batchKernels[RANDOM_PHILOX] = countCirclePointsScalarBatches;
+    switch(type){
+        case KERNEL_FIXED:
+            circleKernels[RANDOM_XOSHIRO] = countCirclePointsFixed;
+            circleKernels[RANDOM_PHILOX] = countCirclePointsFixed;
+            unitCircleKernels[RANDOM_XOSHIRO] = countCirclePointsFixedUnit;
+            unitCircleKernels[RANDOM_PHILOX] = countCirclePointsFixedUnit;
+            batchKernels[RANDOM_XOSHIRO] = countCirclePointsFixedBatches;
+            batchKernels[RANDOM_PHILOX] = countCirclePointsFixedBatches;
+            break;
+#ifdef KERNEL_X86
+        case KERNEL_SSE2:
+            circleKernels[RANDOM_XOSHIRO] = useFloat ? countCirclePointsSse2Float : countCirclePointsSse2;
+            unitCircleKernels[RANDOM_XOSHIRO] = useFloat ? countCirclePointsSse2FloatUnit : countCirclePointsSse2Unit;
+            batchKernels[RANDOM_XOSHIRO] = useFloat ? countCirclePointsSse2FloatBatches : countCirclePointsSse2Batches;
+            break;
+        case KERNEL_AVX2:
+            circleKernels[RANDOM_XOSHIRO] = useFloat ? countCirclePointsAvx2Float : countCirclePointsAvx2;
+            unitCircleKernels[RANDOM_XOSHIRO] = useFloat ? countCirclePointsAvx2FloatUnit : countCirclePointsAvx2Unit;
+            batchKernels[RANDOM_XOSHIRO] = useFloat ? countCirclePointsAvx2FloatBatches : countCirclePointsAvx2Batches;
+            break;
+        case KERNEL_AVX512:
+            circleKernels[RANDOM_XOSHIRO] = useFloat ? countCirclePointsAvx512Float : countCirclePointsAvx512;
+            unitCircleKernels[RANDOM_XOSHIRO] = useFloat ? countCirclePointsAvx512FloatUnit : countCirclePointsAvx512Unit;
+            batchKernels[RANDOM_XOSHIRO] = useFloat ? countCirclePointsAvx512FloatBatches : countCirclePointsAvx512Batches;
+            break;
+#endif
+        default:
+            circleKernels[RANDOM_XOSHIRO] = useFloat ? countCirclePointsScalarFloat : countCirclePointsScalar;
+            unitCircleKernels[RANDOM_XOSHIRO] = useFloat ? countCirclePointsScalarFloatUnit : countCirclePointsScalarUnit;
+            batchKernels[RANDOM_XOSHIRO] = useFloat ? countCirclePointsScalarFloatBatches : countCirclePointsScalarBatches;
+            break;
+    }
+    selectedKernel = type;
+    selectedPrecision = useFloat && type != KERNEL_FIXED ? PRECISION_FLOAT : PRECISION_DOUBLE;
+    return 1;
+}
+
+/*
+ * Function: kernelSelected
+ * ------------------------
+ * @return KernelType of the kernel bound by kernelSelect
+ */
+KernelType kernelSelected(void){
+    return selectedKernel;
+}
+
+/*
+ * Function: kernelSelectedPrecision
+ * ------------------------
+ * @return Precision of the kernel bound by kernelSelect for xoshiro256** streams.
+ *         Philox streams always use double.
+ */
+Precision kernelSelectedPrecision(void){
+    return selectedPrecision;
+}
+
+/*
+ * Function: kernelTypeFromName
+ * ------------------------
+ * Converts a kernel name given on the command line into a KernelType.
+ *
+ * @param *name - "auto", "scalar", "sse2", "avx2", "avx512" or "fixed"
+ * @param *type - Set to the matching kernel
+ *
+ * @return int of 1 if the name is known, otherwise returns 0
+ */
+int kernelTypeFromName(const char *name, KernelType *type){
+    for(int i = 0; i < (int)(sizeof(kernelNames) / sizeof(kernelNames[0])); i++){
+        if(strcmp(name, kernelNames[i]) == 0){
+            *type = (KernelType) i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Function: kernelTypeName
+ * ------------------------
+ * @param type - The kernel
+ *
+ * @return const char* of the name of the kernel
+ */
+const char* kernelTypeName(KernelType type){
+    return kernelNames[type];
+}
+
+/*
+ * Function: precisionFor
+ * ------------------------
+ * Chooses the precision for PRECISION_AUTO. Float is used when the run cannot draw more
+ * than FLOAT_MAX_POINTS points: a fixed number of points below it, or a tolerance that
+ * is reached before it. See Precision in kernel.h.
+ *
+ * @param pointCount - Number of points, or the point limit of an adaptive run. 0 if there
+ *                     is no limit.
+ * @param tolerance  - Tolerance of an adaptive run, 0 if there is none
+ * @param radius     - Radius of the circle
+ *
+ * @return Precision of PRECISION_FLOAT or PRECISION_DOUBLE
+ */
+Precision precisionFor(uint64_t pointCount, double tolerance, double radius){
+    if(pointCount > 0 && pointCount <= FLOAT_MAX_POINTS){
+        return PRECISION_FLOAT;
+    }
+    if(tolerance >= FLOAT_MIN_TOLERANCE * radius * radius){
+        return PRECISION_FLOAT;
+    }
+    return PRECISION_DOUBLE;
+}
+
+/*
+ * Function: precisionFromName
+ * ------------------------
+ * Converts a precision name given on the command line into a Precision.
+ *
+ * @param *name      - "auto", "double" or "float"
+ * @param *precision - Set to the matching precision
+ *
+ * @return int of 1 if the name is known, otherwise returns 0
+ */
+int precisionFromName(const char *name, Precision *precision){
+    for(int i = 0; i < (int)(sizeof(precisionNames) / sizeof(precisionNames[0])); i++){
+        if(strcmp(name, precisionNames[i]) == 0){
+            *precision = (Precision) i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Function: precisionName
+ * ------------------------
+ * @param precision - The precision
+ *
+ * @return const char* of the name of the precision
+ */
+const char* precisionName(Precision precision){
+    return precisionNames[precision];
+}
+
+/*
+ * Function: countCirclePoints
+ * ------------------------
+ * Draws pointCount random points from the stream and counts how many are inside the
+ * circle, using the kernel bound by kernelSelect for the stream's generator. The unit
+ * circle, the default, takes the variant specialised for r = 1.
+ *
+ * @param *stream    - The stream to draw points from
+ * @param radius     - Radius of the circle
+ * @param pointCount - Number of points to draw
+ *
+ * @return uint64_t of the number of points inside the circle
+ */
+uint64_t countCirclePoints(RandomStream *stream, double radius, uint64_t pointCount){
+    CircleKernel *kernels = radius == 1.0 ? unitCircleKernels : circleKernels;
+    return kernels[stream->type](stream, radius, pointCount);
+}
+
+/*
+ * Function: countCirclePointsBatches
+ * ------------------------
+ * countCirclePoints that also counts each batch of RANDOM_LANES points, so a caller can
+ * draw a whole block in one call and still publish it batch by batch. Returns the same
+ * total as countCirclePoints.
+ *
+ * @param *stream       - The stream to draw points from
+ * @param radius        - Radius of the circle
+ * @param pointCount    - Number of points to draw
+ * @param *batchCircles - Set to the number of points inside the circle of each batch,
+ *                        (pointCount + RANDOM_LANES - 1) / RANDOM_LANES of them
+ *
+ * @return uint64_t of the number of points inside the circle
+ */
+uint64_t countCirclePointsBatches(RandomStream *stream, double radius, uint64_t pointCount, uint32_t *batchCircles){
+    return batchKernels[stream->type](stream, radius, pointCount, batchCircles);
+}
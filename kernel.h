@@ -0,0 +1,130 @@
+/* KERNEL.H
+ *
+ * Sampling kernels shared by every stage. A kernel draws a number of random points
+ * from a stream and returns how many of them are inside the circle.
+ *
+ * Points are drawn in the quadrant [0, r)^2 of the square around the circle, which by
+ * symmetry holds the same fraction of points inside the circle as the whole square.
+ * Every kernel is compiled twice: once for r = 1, where the coordinates are used as drawn
+ * and compared with the constant 1, and once for any r, with r and r^2 loaded once per
+ * call. countCirclePoints picks the version from the radius. countCirclePointsBatches also
+ * returns the count of each batch of RANDOM_LANES points of the call.
+ *
+ */
+#ifndef KERNEL_H
+#define KERNEL_H
+
+#include <stdint.h>
+#include "random.h"
+
+/* Enum: KernelType
+ * The versions of the sampling kernel. KERNEL_AUTO picks the widest floating point one the
+ * CPU supports. KERNEL_FIXED is the integer kernel, only used when asked for.
+ */
+typedef enum KernelTypeEnum{
+    KERNEL_AUTO,
+    KERNEL_SCALAR,
+    KERNEL_SSE2,
+    KERNEL_AVX2,
+    KERNEL_AVX512,
+    KERNEL_FIXED
+}KernelType;
+
+/* Enum: Precision
+ * Floating point precision of the scalar, SSE2, AVX2 and AVX-512 kernels.
+ *
+ * Double kernels take two random numbers per point, x and y. Float kernels take one,
+ * split into two 32 bit halves, so a vector register holds twice as many coordinates
+ * and half as many random numbers are drawn. Float coordinates are multiples of 2^-23
+ * and x^2 + y^2 is rounded to 24 bits, which moves the estimate by about 10^-7 of the
+ * area. That is a tenth of the 95% confidence interval after FLOAT_MAX_POINTS points,
+ * so PRECISION_AUTO picks float for any run that cannot use more points than that. Runs
+ * use double unless they ask for float or PRECISION_AUTO.
+ */
+typedef enum PrecisionEnum{
+    PRECISION_AUTO,
+    PRECISION_DOUBLE,
+    PRECISION_FLOAT
+}Precision;
+
+// Most points a run may draw with float kernels, see Precision
+#define FLOAT_MAX_POINTS 1000000000000ULL
+
+// 95% confidence interval (half width) of the area of a unit circle after FLOAT_MAX_POINTS
+// points. Tolerances below this, scaled by r^2, need more points and so use double.
+#define FLOAT_MIN_TOLERANCE 3.2e-6
+
+typedef uint64_t (*CircleKernel)(RandomStream *stream, double radius, uint64_t pointCount);
+typedef uint64_t (*BatchKernel)(RandomStream *stream, double radius, uint64_t pointCount, uint32_t *batchCircles);
+
+/*
+ * Function: isInCircle
+ * ------------------------
+ * Calculates whether the coordinate ( x , y ) is within the bounds of the circle with
+ * the radius provided.
+ * Uses Pythagoras' Theorem: a^2 + b^2 = c^2 to calculate length of point to the
+ * center of the circle. Returns boolean c^2 < r^2 where r is the radius of the circle.
+ * r^2 is passed in, so callers square the radius once rather than for every point.
+ *
+ * @param radiusSquared - Radius of the circle to check, squared.
+ * @param x             - The x coordinate of the point to check is in the circle
+ * @param y             - The y coordinate of the point to check is in the circle
+ *
+ * @return int of 1 if coordinate (x,y) is within the circle, otherwise returns 0
+ */
+static inline int isInCircle(double radiusSquared, double x, double y){
+    return (x*x) + (y*y) < radiusSquared;
+}
+
+/*
+ * Function: isInCircleFixed
+ * ------------------------
+ * Fixed point version of isInCircle for the quarter of the circle in the unit square.
+ * The low and high 32 bits of a random number are the coordinates x and y, as fractions
+ * of 2^32, so the radius is 2^32 and r^2 is 2^64. x^2 + y^2 < 2^64 exactly when adding
+ * the two 64 bit squares does not carry, which the compiler tests without a branch.
+ *
+ * @param bits - 64 random bits holding both coordinates
+ *
+ * @return uint64_t of 1 if the point is within the circle, otherwise returns 0
+ */
+static inline uint64_t isInCircleFixed(uint64_t bits){
+    uint64_t x = bits & 0xFFFFFFFFULL;
+    uint64_t y = bits >> 32;
+    uint64_t xSquared = x * x;
+    uint64_t distance = xSquared + y * y;
+    return distance >= xSquared; // No carry out of 64 bits
+}
+
+/*
+ * Function: isInCircleFloat
+ * ------------------------
+ * Single precision version of isInCircle, for the float kernels. The low and high 32
+ * bits of a random number give the coordinates x and y, scaled by the radius.
+ *
+ * @param radius        - Radius of the circle
+ * @param radiusSquared - Radius of the circle squared
+ * @param bits          - 64 random bits holding both coordinates
+ *
+ * @return int of 1 if the point is within the circle, otherwise returns 0
+ */
+static inline int isInCircleFloat(float radius, float radiusSquared, uint64_t bits){
+    float x = randomBitsToCoordinateFloat((uint32_t) bits) * radius;
+    float y = randomBitsToCoordinateFloat((uint32_t)(bits >> 32)) * radius;
+    return (x*x) + (y*y) < radiusSquared;
+}
+
+int kernelSupported(KernelType type);
+KernelType kernelBest(void);
+int kernelSelect(KernelType type, Precision precision);
+KernelType kernelSelected(void);
+Precision kernelSelectedPrecision(void);
+int kernelTypeFromName(const char *name, KernelType *type);
+const char* kernelTypeName(KernelType type);
+Precision precisionFor(uint64_t pointCount, double tolerance, double radius);
+int precisionFromName(const char *name, Precision *precision);
+const char* precisionName(Precision precision);
+uint64_t countCirclePoints(RandomStream *stream, double radius, uint64_t pointCount);
+uint64_t countCirclePointsBatches(RandomStream *stream, double radius, uint64_t pointCount, uint32_t *batchCircles);
+
+#endif //KERNEL_H
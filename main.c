@@ -0,0 +1,597 @@
+/* MAIN.C
+ *
+ * Command line front end of every estimation engine. The engine is chosen with --engine,
+ * so the engines are compared with the same build flags, kernels and random streams.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <time.h>
+#include <getopt.h>
+#include "engine.h"
+#include "kernel.h"
+#include "shard.h"
+#include "cluster.h"
+
+static const struct option longOptions[] = {
+    {"points", required_argument, NULL, 'p'},
+    {"threads", required_argument, NULL, 't'},
+    {"radius", required_argument, NULL, 'r'},
+    {"clock", no_argument, NULL, 'c'},
+    {"verbose", no_argument, NULL, 'v'},
+    {"generator", required_argument, NULL, 'g'},
+    {"kernel", required_argument, NULL, 'k'},
+    {"affinity", required_argument, NULL, 'a'},
+    {"strategy", required_argument, NULL, 's'},
+    {"runs", required_argument, NULL, 'n'},
+    {"tolerance", required_argument, NULL, 'e'},
+    {"deadline", required_argument, NULL, 'd'},
+    {"engine", required_argument, NULL, 'm'},
+    {"counters", no_argument, NULL, 'H'},
+    {"precision", required_argument, NULL, 'P'},
+    {"sequence", required_argument, NULL, 'q'},
+    {"estimator", required_argument, NULL, 'E'},
+    {"seed", required_argument, NULL, 'S'},
+    {"checkpoint", required_argument, NULL, 'C'},
+    {"checkpoint-interval", required_argument, NULL, 'I'},
+    {"extend", required_argument, NULL, 'X'},
+    {"first-point", required_argument, NULL, 'F'},
+    {"shard", required_argument, NULL, 'O'},
+    {"coordinate", required_argument, NULL, 'L'},
+    {"worker", required_argument, NULL, 'W'},
+    {"spawn", required_argument, NULL, 'N'},
+    {NULL, 0, NULL, 0}
+};
+
+/*
+ * Function: parsePointCount
+ * ------------------------
+ * Parses a number of points given on the command line. Point counts are 64 bit so a
+ * run is not limited to 2^31 samples.
+ *
+ * @param *text       - The command line argument
+ * @param *pointCount - Set to the parsed number of points
+ *
+ * @return int of 1 if the argument is a positive whole number, otherwise returns 0
+ */
+static int parsePointCount(const char *text, uint64_t *pointCount){
+    char *end;
+    errno = 0;
+    unsigned long long value = strtoull(text, &end, 10);
+
+    if(errno != 0 || end == text || *end != '\0' || value == 0 || strchr(text, '-') != NULL){
+        return 0;
+    }
+    *pointCount = value;
+    return 1;
+}
+
+/*
+ * Function: parseSeed
+ * ------------------------
+ * Parses a seed given on the command line.
+ *
+ * @param *text - The command line argument
+ * @param *seed - Set to the parsed seed
+ *
+ * @return int of 1 if the argument is a whole number that fits in 64 bits, otherwise returns 0
+ */
+static int parseSeed(const char *text, uint64_t *seed){
+    char *end;
+    errno = 0;
+    unsigned long long value = strtoull(text, &end, 0);
+
+    if(errno != 0 || end == text || *end != '\0' || strchr(text, '-') != NULL){
+        return 0;
+    }
+    *seed = value;
+    return 1;
+}
+
+/*
+ * Function: parseEstimate
+ * ------------------------
+ * Parses the result of a previous estimation given on the command line, in the form
+ * seed:firstPoint:pointCount:score printed after every single run of a fixed number of points.
+ *
+ * @param *text     - The command line argument
+ * @param *estimate - Set to the parsed estimation
+ *
+ * @return int of 1 if the argument is four whole numbers separated by ':', with at least one
+ *         point starting on a block, otherwise returns 0
+ */
+static int parseEstimate(const char *text, Estimate *estimate){
+    uint64_t *fields[] = {&estimate->seed, &estimate->firstPoint, &estimate->pointCount, &estimate->score};
+    const char *next = text;
+
+    if(strchr(text, '-') != NULL){
+        return 0;
+    }
+    for(int i = 0; i < 4; i++){
+        char *end;
+        errno = 0;
+        unsigned long long value = strtoull(next, &end, 10);
+        if(errno != 0 || end == next || *end != (i < 3 ? ':' : '\0')){
+            return 0;
+        }
+        *fields[i] = value;
+        next = end + 1;
+    }
+    return estimate->pointCount > 0 && estimate->firstPoint % RANDOM_BLOCK_POINTS == 0;
+}
+
+/*
+ * Function: main
+ * ------------------------
+ * Iterates through a large number of random coordinates, counting how many are within the
+ * bounds of a circle. It then calculates a rough estimate for the area of the circle.
+ * The points are calculated by the chosen engine, see engine.h.
+ * The time taken to calculate the area of the circle is calculated and displayed on completion.
+ *
+ * @param argc - Number of command line arguments provided
+ * @param *argv[] - array of pointers to the command line arguments
+ *        argv[0] - The name of the this executable file.
+ *        argv[1...n]:
+ *          [-m, --engine]    engine to use: serial, sharded (default) or shared
+ *          [-p, --points]    number of points to iterate through
+ *          [-t, --threads]   number of worker threads to create
+ *          [-r, --radius]    radius of the circle to calculate
+ *          [-c, --clock]     calculate and display execution time
+ *          [-v, --verbose]   record per thread instrumentation (spawn, sampling, lock and join
+ *                            time and lock acquisitions) and print the breakdown at exit
+ *          [-H, --counters]  read hardware performance counters in every worker thread and print
+ *                            IPC and branch, L1 and LLC misses per sample at exit (Linux)
+ *          [-g, --generator] random number generator to use: xoshiro (default) or philox
+ *          [-k, --kernel]    sampling kernel to use: auto (default), scalar, sse2, avx2, avx512 or fixed
+ *          [-P, --precision] precision of the kernel: double (default), float or auto. auto uses
+ *                            float when the run is limited to 10^12 points, by -p or by a
+ *                            tolerance that is reached first, see Precision in kernel.h.
+ *                            The result printed for -X does not hold the precision, so float
+ *                            and auto are only used when asked for.
+ *          [-q, --sequence]  where points come from: random (default) numbers, or the r2, halton
+ *                            or sobol low-discrepancy sequence (quasi-Monte Carlo), see sequence.h.
+ *                            Cannot be used with -e or -d.
+ *          [-E, --estimator] estimator of the area from random points: hit (default, hit or miss),
+ *                            stratified, antithetic or mean (sample mean), see estimator.h.
+ *                            Only hit uses the sampling kernel, and only hit can use -q.
+ *                            mean draws at most 2^44 points, -e and -d stop there.
+ *          [-S, --seed]      seed of the random numbers (default: the current time). Point k
+ *                            of a run always comes from the same random numbers, so runs with
+ *                            the same seed and -p give the same area for any -t and engine.
+ *          [-C, --checkpoint] file the run is saved to while it goes, and resumed from if it exists.
+ *                            A resumed run only draws the points the file does not hold and
+ *                            gives the area of an uninterrupted run. Needs the same -p, -S,
+ *                            -r, -g, -E, -q and kernel precision as the run that wrote it,
+ *                            and cannot be used with -e, -d or -n.
+ *          [-I, --checkpoint-interval] seconds between two saves of the checkpoint (default 60)
+ *          [-X, --extend]    extend the result of a previous run, seed:firstPoint:points:score as
+ *                            printed after it, to -p points. Only the new points, and those of
+ *                            its last partial block, are drawn, and the area is exactly that of
+ *                            a run of -p points. Takes the seed from the result, needs the same
+ *                            -r, -g, -E, -q and -P as the previous run (-P auto picks the
+ *                            precision it picked) and cannot be used with -C, -e, -d or -n.
+ *          [-F, --first-point] index of the first point of the run (default 0), a multiple of 65536.
+ *                            Runs of disjoint ranges with the same seed are independent parts
+ *                            of one estimation, see --shard. Cannot be used with -C or -X.
+ *          [-O, --shard]     file the result of the run is written to, with its options and time,
+ *                            as JSON if it ends in .json and otherwise binary. shardmerge merges
+ *                            the shards of disjoint ranges into one estimate, see shard.h.
+ *                            Cannot be used with -e, -d or -n.
+ *          [-L, --coordinate] run as the coordinator of worker processes, listening on this Unix
+ *                            socket path. The points are handed out in ranges and the area is
+ *                            exactly that of one process, see cluster.h. Ranges of workers that
+ *                            die are handed to others. Cannot be used with -C, -X, -e, -d or -n.
+ *          [-N, --spawn]     number of worker processes the coordinator forks, each with -t
+ *                            threads, or numa for one per NUMA node with a thread per CPU of
+ *                            the node (default 0: only workers started with --worker)
+ *          [-W, --worker]    run as a worker of the coordinator listening on this Unix socket
+ *                            path, with the -m, -t, -a and -s given here. The points and their
+ *                            options come from the coordinator.
+ *          [-a, --affinity]  worker thread affinity: none (default), compact or scatter
+ *          [-s, --strategy]  strategy used to update the shared total of the shared engine:
+ *                            mutex, atomic, batched (default) or sharded
+ *          [-n, --runs]      number of estimations to run back to back on the same worker threads
+ *          [-e, --tolerance] keep drawing points until the 95% confidence interval of the area
+ *                            is narrower than this tolerance. -p then limits the number of points.
+ *          [-d, --deadline]  time limit in milliseconds, the estimate reached by then is returned.
+ *                            -p then limits the number of points, if given.
+ *
+ * @return int of how program exits
+ */
+int main(int argc, char *argv[]) {
+    // Default Values, used if not arguments provided
+    EngineType engineType = ENGINE_SHARDED;
+    EngineOptions options = {
+        .threadCount = 10,
+        .randomType = RANDOM_XOSHIRO,
+        .affinity = AFFINITY_NONE,
+        .strategy = STRATEGY_BATCHED,
+        .instrument = 0,
+        .sequence = SEQUENCE_RANDOM,
+        .estimatorType = ESTIMATOR_HIT,
+        .seed = (uint64_t) time(NULL),
+        .checkpoint = NULL
+    };
+    uint64_t pointCount = 100000;
+    double radius = 1.0;
+    int timer = 0;
+    KernelType kernelType = KERNEL_AUTO;
+    Precision precision = PRECISION_DOUBLE;
+    int runs = 1;
+    double tolerance = 0;
+    double timeLimit = 0;
+    uint64_t pointLimit = 0;
+    const char *checkpointPath = NULL;
+    double checkpointInterval = 60;
+    Checkpoint checkpoint;
+    const char *extendText = NULL;
+    Estimate estimate = {0};
+    Estimate prior;
+    uint64_t firstPoint = 0;
+    const char *shardPath = NULL;
+    const char *coordinatorPath = NULL;
+    const char *workerPath = NULL;
+    int spawnCount = 0;
+    int c;
+
+    // Retrieving Arguments
+    while ((c = getopt_long(argc, argv, "p:t:r:cvg:k:P:q:E:S:C:I:X:F:O:L:W:N:a:s:n:e:d:m:H", longOptions, NULL)) != -1){
+        switch(c){
+            case 'm': // Engine
+                if(!engineTypeFromName(optarg, &engineType)){
+                    fprintf(stderr, "Unknown engine: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'p': // Point Count
+                if(!parsePointCount(optarg, &pointCount)){
+                    fprintf(stderr, "Invalid number of points: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                pointLimit = pointCount;
+                break;
+            case 't': // Thread Count
+                options.threadCount = atoi(optarg);
+                break;
+            case 'r': // Radius
+                radius = atof(optarg);
+                break;
+            case 'c': // Clock (timer)
+                timer = 1;
+                break;
+            case 'v': // Verbose (per thread instrumentation)
+                options.instrument |= INSTRUMENT_PHASES;
+                break;
+            case 'H': // Hardware performance counters
+                options.instrument |= INSTRUMENT_COUNTERS;
+                break;
+            case 'g': // Random number generator
+                if(!randomTypeFromName(optarg, &options.randomType)){
+                    fprintf(stderr, "Unknown random number generator: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'k': // Sampling kernel
+                if(!kernelTypeFromName(optarg, &kernelType)){
+                    fprintf(stderr, "Unknown sampling kernel: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'P': // Kernel precision
+                if(!precisionFromName(optarg, &precision)){
+                    fprintf(stderr, "Unknown precision: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'q': // Quasi-Monte Carlo sequence
+                if(!sequenceTypeFromName(optarg, &options.sequence)){
+                    fprintf(stderr, "Unknown sequence: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'E': // Estimator
+                if(!estimatorTypeFromName(optarg, &options.estimatorType)){
+                    fprintf(stderr, "Unknown estimator: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'S': // Seed
+                if(!parseSeed(optarg, &options.seed)){
+                    fprintf(stderr, "Invalid seed: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'C': // Checkpoint file
+                checkpointPath = optarg;
+                break;
+            case 'I': // Checkpoint interval
+                checkpointInterval = atof(optarg);
+                break;
+            case 'X': // Previous result to extend
+                if(!parseEstimate(optarg, &prior)){
+                    fprintf(stderr, "Invalid result to extend: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                extendText = optarg;
+                break;
+            case 'F': // First point of the run
+                if(!parseSeed(optarg, &firstPoint) || firstPoint % RANDOM_BLOCK_POINTS != 0){
+                    fprintf(stderr, "Invalid first point, it must be a multiple of %llu: %s\n", RANDOM_BLOCK_POINTS, optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'O': // Result shard file
+                shardPath = optarg;
+                break;
+            case 'L': // Coordinator socket
+                coordinatorPath = optarg;
+                break;
+            case 'W': // Worker of a coordinator
+                workerPath = optarg;
+                break;
+            case 'N': // Worker processes to fork
+                spawnCount = strcmp(optarg, "numa") == 0 ? CLUSTER_SPAWN_NUMA : atoi(optarg);
+                if(spawnCount < 0 && spawnCount != CLUSTER_SPAWN_NUMA){
+                    fprintf(stderr, "Invalid number of worker processes: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'a': // Thread affinity
+                if(!affinityFromName(optarg, &options.affinity)){
+                    fprintf(stderr, "Unknown affinity policy: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 's': // Shared total strategy
+                if(!strategyFromName(optarg, &options.strategy)){
+                    fprintf(stderr, "Unknown strategy: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'n': // Number of estimations
+                runs = atoi(optarg);
+                break;
+            case 'e': // Tolerance
+                tolerance = atof(optarg);
+                break;
+            case 'd': // Time limit
+                timeLimit = atof(optarg) / 1000.0;
+                break;
+            default:
+                return EXIT_FAILURE;
+        }
+    }
+    if(engineType == ENGINE_SERIAL){
+        options.threadCount = 1;
+    }
+    if(options.sequence != SEQUENCE_RANDOM && options.estimatorType != ESTIMATOR_HIT){
+        fprintf(stderr, "Sequences can only be used with the hit estimator\n");
+        return EXIT_FAILURE;
+    }
+    if(options.sequence != SEQUENCE_RANDOM && (tolerance > 0 || timeLimit > 0)){
+        fprintf(stderr, "Sequences can only be used with a fixed number of points, without -e or -d\n");
+        return EXIT_FAILURE;
+    }
+    if(pointCount > estimatorMaxPoints(options.estimatorType) || pointLimit > estimatorMaxPoints(options.estimatorType)){
+        fprintf(stderr, "The %s estimator can draw at most %" PRIu64 " points\n", estimatorTypeName(options.estimatorType),
+                estimatorMaxPoints(options.estimatorType));
+        return EXIT_FAILURE;
+    }
+    if(options.threadCount < 1){
+        fprintf(stderr, "Invalid number of threads: %d\n", options.threadCount);
+        return EXIT_FAILURE;
+    }
+    if(workerPath != NULL){
+        return clusterWork(workerPath, engineType, &options) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if(coordinatorPath != NULL && (checkpointPath != NULL || extendText != NULL || tolerance > 0 || timeLimit > 0 ||
+                                   runs > 1)){
+        fprintf(stderr, "A coordinator can only run a single run of a fixed number of points, without -C or -X\n");
+        return EXIT_FAILURE;
+    }
+    if(spawnCount != 0 && coordinatorPath == NULL){
+        fprintf(stderr, "Worker processes can only be forked by a coordinator\n");
+        return EXIT_FAILURE;
+    }
+    if(checkpointPath != NULL && (tolerance > 0 || timeLimit > 0 || runs > 1)){
+        fprintf(stderr, "A checkpoint can only be used with a single run of a fixed number of points\n");
+        return EXIT_FAILURE;
+    }
+    if(checkpointPath != NULL && checkpointInterval <= 0){
+        fprintf(stderr, "Invalid checkpoint interval: %f\n", checkpointInterval);
+        return EXIT_FAILURE;
+    }
+    if(extendText != NULL && (checkpointPath != NULL || tolerance > 0 || timeLimit > 0 || runs > 1)){
+        fprintf(stderr, "A result can only be extended by a single run of a fixed number of points\n");
+        return EXIT_FAILURE;
+    }
+    if(firstPoint != 0 && (checkpointPath != NULL || extendText != NULL || tolerance > 0 || timeLimit > 0 || runs > 1)){
+        fprintf(stderr, "A first point can only be given to a single run of a fixed number of points, without -C or -X\n");
+        return EXIT_FAILURE;
+    }
+    if(shardPath != NULL && (tolerance > 0 || timeLimit > 0 || runs > 1)){
+        fprintf(stderr, "A shard can only be written by a single run of a fixed number of points\n");
+        return EXIT_FAILURE;
+    }
+    if(extendText != NULL && pointCount < prior.pointCount){
+        fprintf(stderr, "Cannot extend a result of %" PRIu64 " points to %" PRIu64 " points\n",
+                prior.pointCount, pointCount);
+        return EXIT_FAILURE;
+    }
+    if(extendText != NULL){
+        options.seed = prior.seed;
+    }
+
+    if(precision == PRECISION_AUTO){
+        int adaptive = tolerance > 0 || timeLimit > 0;
+        uint64_t runPoints = extendText != NULL ? prior.pointCount : pointCount; // As the previous run picked it
+        precision = precisionFor(adaptive ? pointLimit : runPoints, tolerance, radius);
+    }
+    if(!kernelSelect(kernelType, precision)){
+        fprintf(stderr, "Sampling kernel %s is not supported by this CPU\n", kernelTypeName(kernelType));
+        return EXIT_FAILURE;
+    }
+    if(checkpointPath != NULL){
+        CheckpointHeader run = {
+            .seed = options.seed,
+            .pointCount = pointCount,
+            .radius = radius,
+            .randomType = options.randomType,
+            .estimatorType = options.estimatorType,
+            .sequence = options.sequence,
+            .precision = kernelSelectedPrecision(),
+            .fixedPoint = kernelSelected() == KERNEL_FIXED
+        };
+        if(!checkpointOpen(&checkpoint, checkpointPath, checkpointInterval, &run)){
+            fprintf(stderr, "Cannot resume from checkpoint %s: it is unreadable or of another run\n", checkpointPath);
+            return EXIT_FAILURE;
+        }
+        options.checkpoint = &checkpoint;
+    }
+
+    struct timespec startTime, endTime;
+    if(timer) {
+        clock_gettime(CLOCK_REALTIME, &startTime); // Get the start time
+    }
+
+    double area = 0;
+    double error = 0;
+    double runStart = monotonicSeconds();
+    Engine engine = {0};
+    // Repeated estimations reuse one engine, so the threads are only created once.
+    // It is kept until exit so its instrumentation can be printed last. A coordinator has none.
+    if(coordinatorPath == NULL && !engineCreate(&engine, engineType, &options)){
+        perror("Error creating Engine: ");
+        return EXIT_FAILURE;
+    }
+    if(coordinatorPath != NULL){
+        ClusterJob job = {
+            .seed = options.seed,
+            .firstPoint = firstPoint,
+            .pointCount = pointCount,
+            .radius = radius,
+            .randomType = options.randomType,
+            .estimatorType = options.estimatorType,
+            .sequence = options.sequence,
+            .precision = kernelSelectedPrecision(),
+            .fixedPoint = kernelSelected() == KERNEL_FIXED
+        };
+        if(!clusterCoordinate(coordinatorPath, &job, spawnCount, engineType, &options, &estimate)){
+            perror("Error running coordinator");
+            return EXIT_FAILURE;
+        }
+        area = estimatorArea(options.estimatorType, estimate.score, estimate.pointCount, radius);
+    } else if(runs > 1 || tolerance > 0 || timeLimit > 0){
+        for(int run = 1; run <= runs; run++){
+            if(tolerance > 0 || timeLimit > 0){
+                area = engineRunAdaptive(&engine, tolerance, timeLimit, pointLimit, radius, &pointCount, &error);
+            } else {
+                area = engineRun(&engine, pointCount, radius);
+            }
+            if(runs > 1){
+                printf("Estimation %d: The Area of the circle is: %f\n", run, area);
+            }
+        }
+    } else {
+        // A single run of a fixed number of points gives an exact result, which can be extended
+        if(extendText != NULL){
+            engineExtend(&engine, &prior, pointCount, radius, &estimate);
+        } else {
+            estimate.seed = options.seed;
+            estimate.firstPoint = firstPoint;
+            estimate.pointCount = pointCount;
+            estimate.score = engineRunRange(&engine, firstPoint, pointCount, radius);
+        }
+        area = estimatorArea(options.estimatorType, estimate.score, estimate.pointCount, radius); // Calculate the area of the circle
+    }
+    double runSeconds = monotonicSeconds() - runStart;
+
+    // Print Results. The threads of a coordinator run are those of its workers.
+    if(coordinatorPath == NULL){
+        printf("Number of Points = %" PRIu64 ", Number of Threads = %d, ", pointCount, options.threadCount);
+    } else if(spawnCount != 0){
+        printf("Number of Points = %" PRIu64 ", Worker Processes = %d%s, Threads per Worker = %d, ", pointCount,
+               spawnCount == CLUSTER_SPAWN_NUMA ? numaNodeCount() : spawnCount,
+               spawnCount == CLUSTER_SPAWN_NUMA ? " (one per NUMA node)" : "", options.threadCount);
+    } else {
+        printf("Number of Points = %" PRIu64 ", Worker Processes = separate, ", pointCount);
+    }
+    printf("Circle Radius = %f, Seed = %" PRIu64 "\n", radius, options.seed);
+    printf("Engine = %s, Sampling Kernel = %s, ", engineTypeName(engineType), kernelTypeName(kernelSelected()));
+    if(options.randomType == RANDOM_XOSHIRO && kernelSelected() != KERNEL_FIXED){
+        printf("Precision = %s, ", precisionName(kernelSelectedPrecision()));
+    }
+    printf("Random Number Generator = %s, Affinity = %s", randomTypeName(options.randomType),
+           affinityName(options.affinity));
+    if(options.estimatorType != ESTIMATOR_HIT){
+        printf(", Estimator = %s", estimatorTypeName(options.estimatorType));
+    }
+    if(options.sequence != SEQUENCE_RANDOM){
+        printf(", Sequence = %s", sequenceTypeName(options.sequence));
+    }
+    if(engineType == ENGINE_SHARED){
+        printf(", Strategy = %s", strategyName(options.strategy));
+    }
+    printf("\n");
+    printf("The Area of the circle is: %f\n", area);
+    if(tolerance > 0 || timeLimit > 0){
+        printf("Achieved Error = +/- %f (95%% confidence)\n", error);
+    }
+    if(estimate.pointCount > 0){
+        printf("Result = %" PRIu64 ":%" PRIu64 ":%" PRIu64 ":%" PRIu64 "\n", estimate.seed, estimate.firstPoint,
+               estimate.pointCount, estimate.score);
+    }
+    if(extendText != NULL){
+        uint64_t priorBlockPoints = prior.pointCount % RANDOM_BLOCK_POINTS; // Points of its partial last block
+        printf("Extended = %s, Points Drawn = %" PRIu64 "\n", extendText,
+               pointCount - (prior.pointCount - priorBlockPoints) + priorBlockPoints);
+    }
+    if(coordinatorPath != NULL){
+        printf("Coordinator = %s\n", coordinatorPath);
+    }
+    if(shardPath != NULL){
+        Shard shard = {
+            .seed = estimate.seed,
+            .firstPoint = estimate.firstPoint,
+            .pointCount = estimate.pointCount,
+            .score = estimate.score,
+            .radius = radius,
+            .randomType = options.randomType,
+            .estimatorType = options.estimatorType,
+            .sequence = options.sequence,
+            .precision = kernelSelectedPrecision(),
+            .fixedPoint = kernelSelected() == KERNEL_FIXED,
+            .seconds = runSeconds
+        };
+        if(!shardWrite(&shard, shardPath)){
+            perror("Error writing shard");
+            return EXIT_FAILURE;
+        }
+        printf("Shard = %s\n", shardPath);
+    }
+    if(options.checkpoint != NULL){
+        printf("Checkpoint = %s, Points Restored = %" PRIu64 "\n", checkpointPath, checkpoint.restoredPoints);
+        checkpointClose(&checkpoint);
+    }
+
+    if(timer) {
+        clock_gettime(CLOCK_REALTIME, &endTime); // Get the time at the end of the algorithm
+        double elapsedTime = (endTime.tv_sec - startTime.tv_sec) + // Calculate the diff in time between start and end
+                             (endTime.tv_nsec - startTime.tv_nsec) / 1000000000.0;
+        printf("Elapsed Time: %f seconds\n", elapsedTime);
+    }
+    if(engine.state != NULL){
+        if(options.instrument & INSTRUMENT_PHASES){
+            statsPrint(engineStats(&engine), stdout);
+        }
+        if(options.instrument & INSTRUMENT_COUNTERS){
+            statsPrintCounters(engineStats(&engine), stdout);
+        }
+        engineDestroy(&engine);
+    }
+
+    return EXIT_SUCCESS;
+}
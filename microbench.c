@@ -0,0 +1,452 @@
+/* MICROBENCH.C
+ *
+ * Microbenchmarks of the hot path components, timed in isolation so the slowest one can be
+ * found without guessing from total wall time:
+ *
+ *   rng-*      - random coordinate generation, two coordinates per sample
+ *   hit-test   - isInCircle on coordinates already in memory (L1/L2 resident), and
+ *                isInCircleFixed on random numbers already in memory
+ *   kernel-*   - every supported sampling kernel, generation and hit test together, in
+ *                double and in float (kernel-*-float) precision
+ *   reduce-*   - adding the circle points of every RANDOM_LANES batch to a total shared by
+ *                the worker threads, as the engines do: one mutex per update, one atomic
+ *                add per update, or a thread-local count summed once at the end
+ *
+ * Each component reports nanoseconds and cycles per sample, the best of the repetitions.
+ * Cycles come from the time stamp counter, which ticks at a constant rate that may differ
+ * from the core clock under frequency scaling. Reduction costs are per sample of thread
+ * time (wall time * threads / samples).
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <getopt.h>
+#include "kernel.h"
+#include "topology.h"
+#include "pool.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MICROBENCH_TSC
+#include <x86intrin.h>
+#endif
+
+// Coordinates held in memory for the hit test, 64KB so they stay in L2
+#define HIT_TEST_POINTS 4096
+
+/* Enum: ReduceType
+ * How the reduction microbenchmark adds batches to the total.
+ */
+typedef enum ReduceTypeEnum{
+    REDUCE_MUTEX,
+    REDUCE_ATOMIC,
+    REDUCE_LOCAL
+}ReduceType;
+
+static const char *reduceNames[] = {
+    [REDUCE_MUTEX] = "reduce-mutex",
+    [REDUCE_ATOMIC] = "reduce-atomic",
+    [REDUCE_LOCAL] = "reduce-local"
+};
+
+/* Structure: LocalCount
+ * Thread-local count of the reduce-local microbenchmark, on its own cache line.
+ *
+ * @variable value - Circle points counted by the thread
+ */
+typedef struct LocalCountStruct{
+    _Alignas(CACHE_LINE_SIZE) uint64_t value;
+}LocalCount;
+
+/* Structure: Reduction
+ * Shared state of the reduction microbenchmark.
+ *
+ * @variable type       - How batches are added to the total
+ * @variable updates    - Number of batches added by each thread
+ * @variable mutex      - Protects total with REDUCE_MUTEX
+ * @variable total      - Total with REDUCE_MUTEX
+ * @variable atomicTotal - Total with REDUCE_ATOMIC and REDUCE_LOCAL
+ * @variable *locals    - Count of each thread with REDUCE_LOCAL
+ */
+typedef struct ReductionStruct{
+    ReduceType type;
+    uint64_t updates;
+    pthread_mutex_t mutex;
+    uint64_t total;
+    atomic_uint_fast64_t atomicTotal;
+    LocalCount *locals;
+}Reduction;
+
+/* Structure: Timer
+ * Start of a timed section.
+ *
+ * @variable seconds - CLOCK_MONOTONIC time in seconds
+ * @variable cycles  - Time stamp counter, 0 where there is none
+ */
+typedef struct TimerStruct{
+    double seconds;
+    uint64_t cycles;
+}Timer;
+
+// Results are added here so the compiler cannot drop the work being timed
+volatile double sink;
+
+static const struct option longOptions[] = {
+    {"samples", required_argument, NULL, 'p'},
+    {"threads", required_argument, NULL, 't'},
+    {"repetitions", required_argument, NULL, 'n'},
+    {NULL, 0, NULL, 0}
+};
+
+/*
+ * Function: timerStart
+ * ------------------------
+ * @return Timer of the current time and cycle count
+ */
+static Timer timerStart(void){
+    Timer timer;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    timer.seconds = now.tv_sec + now.tv_nsec / 1000000000.0;
+#ifdef MICROBENCH_TSC
+    timer.cycles = __rdtsc();
+#else
+    timer.cycles = 0;
+#endif
+    return timer;
+}
+
+/*
+ * Function: timerStop
+ * ------------------------
+ * Converts the time since a timer started into nanoseconds and cycles per sample, keeping
+ * the best (lowest) of the repetitions so far.
+ *
+ * @param start    - The timer
+ * @param samples  - Number of samples the section processed
+ * @param scale    - Multiplier of the elapsed time, the thread count for reductions
+ * @param *nanos   - Lowest nanoseconds per sample so far, updated
+ * @param *cycles  - Cycles per sample of that repetition, updated
+ */
+static void timerStop(Timer start, uint64_t samples, double scale, double *nanos, double *cycles){
+    Timer end = timerStart();
+    double sampleNanos = (end.seconds - start.seconds) * 1e9 * scale / (double)samples;
+
+    if(sampleNanos < *nanos){
+        *nanos = sampleNanos;
+        *cycles = (double)(end.cycles - start.cycles) * scale / (double)samples;
+    }
+}
+
+/*
+ * Function: printResult
+ * ------------------------
+ * Prints one CSV line of results.
+ *
+ * @param *component - Name of the component
+ * @param samples    - Number of samples of each repetition
+ * @param nanos      - Nanoseconds per sample
+ * @param cycles     - Cycles per sample
+ */
+static void printResult(const char *component, uint64_t samples, double nanos, double cycles){
+#ifdef MICROBENCH_TSC
+    printf("%s,%" PRIu64 ",%.3f,%.2f\n", component, samples, nanos, cycles);
+#else
+    (void) cycles;
+    printf("%s,%" PRIu64 ",%.3f,\n", component, samples, nanos);
+#endif
+}
+
+/*
+ * Function: benchmarkRandom
+ * ------------------------
+ * Times the generation of two coordinates per sample. xoshiro256** is read lane by lane in
+ * batches of RANDOM_LANES, as the scalar kernel does.
+ *
+ * @param type        - The random number generator
+ * @param samples     - Samples per repetition
+ * @param repetitions - Number of repetitions
+ */
+static void benchmarkRandom(RandomType type, uint64_t samples, int repetitions){
+    RandomStream stream;
+    double nanos = 1e300, cycles = 0, total = 0;
+    char name[64];
+
+    randomSeed(&stream, type, 1, 0);
+    for(int r = 0; r < repetitions; r++){
+        Timer start = timerStart();
+        if(type == RANDOM_XOSHIRO){
+            for(uint64_t i = 0; i < samples; i += RANDOM_LANES){
+                for(int lane = 0; lane < RANDOM_LANES; lane++){
+                    total += randomBitsToCoordinate(xoshiroLaneNext(stream.state, lane));
+                    total += randomBitsToCoordinate(xoshiroLaneNext(stream.state, lane));
+                }
+            }
+        } else {
+            for(uint64_t i = 0; i < samples; i++){
+                total += randomCoordinate(&stream);
+                total += randomCoordinate(&stream);
+            }
+        }
+        timerStop(start, samples, 1, &nanos, &cycles);
+    }
+    sink = total;
+
+    snprintf(name, sizeof(name), "rng-%s", randomTypeName(type));
+    printResult(name, samples, nanos, cycles);
+}
+
+/*
+ * Function: benchmarkHitTest
+ * ------------------------
+ * Times isInCircle on HIT_TEST_POINTS coordinates generated beforehand, read over and over.
+ *
+ * @param samples     - Samples per repetition
+ * @param repetitions - Number of repetitions
+ */
+static void benchmarkHitTest(uint64_t samples, int repetitions){
+    static double x[HIT_TEST_POINTS], y[HIT_TEST_POINTS];
+    RandomStream stream;
+    double nanos = 1e300, cycles = 0;
+    uint64_t circlePoints = 0;
+
+    randomSeed(&stream, RANDOM_XOSHIRO, 1, 0);
+    for(int i = 0; i < HIT_TEST_POINTS; i++){
+        x[i] = randomCoordinate(&stream);
+        y[i] = randomCoordinate(&stream);
+    }
+
+    for(int r = 0; r < repetitions; r++){
+        Timer start = timerStart();
+        for(uint64_t i = 0; i < samples; i++){
+            circlePoints += isInCircle(1.0, x[i % HIT_TEST_POINTS], y[i % HIT_TEST_POINTS]);
+        }
+        timerStop(start, samples, 1, &nanos, &cycles);
+    }
+    sink = (double)circlePoints;
+
+    printResult("hit-test", samples, nanos, cycles);
+}
+
+/*
+ * Function: benchmarkHitTestFixed
+ * ------------------------
+ * Times isInCircleFixed on HIT_TEST_POINTS random numbers generated beforehand, read over
+ * and over.
+ *
+ * @param samples     - Samples per repetition
+ * @param repetitions - Number of repetitions
+ */
+static void benchmarkHitTestFixed(uint64_t samples, int repetitions){
+    static uint64_t bits[HIT_TEST_POINTS];
+    RandomStream stream;
+    double nanos = 1e300, cycles = 0;
+    uint64_t circlePoints = 0;
+
+    randomSeed(&stream, RANDOM_XOSHIRO, 1, 0);
+    for(int i = 0; i < HIT_TEST_POINTS; i++){
+        bits[i] = randomNext(&stream);
+    }
+
+    for(int r = 0; r < repetitions; r++){
+        Timer start = timerStart();
+        for(uint64_t i = 0; i < samples; i++){
+            circlePoints += isInCircleFixed(bits[i % HIT_TEST_POINTS]);
+        }
+        timerStop(start, samples, 1, &nanos, &cycles);
+    }
+    sink = (double)circlePoints;
+
+    printResult("hit-test-fixed", samples, nanos, cycles);
+}
+
+/*
+ * Function: benchmarkKernel
+ * ------------------------
+ * Times a sampling kernel, generation and hit test together, for comparison with the sum
+ * of the two components.
+ *
+ * @param type        - The kernel, which must be supported by the CPU
+ * @param precision   - Precision of the kernel
+ * @param samples     - Samples per repetition
+ * @param repetitions - Number of repetitions
+ */
+static void benchmarkKernel(KernelType type, Precision precision, uint64_t samples, int repetitions){
+    RandomStream stream;
+    double nanos = 1e300, cycles = 0;
+    uint64_t circlePoints = 0;
+    char name[64];
+
+    kernelSelect(type, precision);
+    randomSeed(&stream, RANDOM_XOSHIRO, 1, 0);
+    for(int r = 0; r < repetitions; r++){
+        Timer start = timerStart();
+        circlePoints += countCirclePoints(&stream, 1.0, samples);
+        timerStop(start, samples, 1, &nanos, &cycles);
+    }
+    sink = (double)circlePoints;
+
+    snprintf(name, sizeof(name), "kernel-%s%s", kernelTypeName(type),
+             kernelSelectedPrecision() == PRECISION_FLOAT ? "-float" : "");
+    printResult(name, samples, nanos, cycles);
+}
+
+/*
+ * Function: reduceTask
+ * ------------------------
+ * Pool task of the reduction microbenchmark. Adds one batch count per update to the
+ * total, the count itself varying like a real batch's would.
+ *
+ * @param *r     - void pointer to the Reduction
+ * @param worker - Index of the current thread
+ */
+static void reduceTask(void *r, int worker){
+    Reduction *reduction = (Reduction*) r;
+    LocalCount *local = &reduction->locals[worker];
+
+    for(uint64_t i = 0; i < reduction->updates; i++){
+        uint64_t batchCirclePoints = (i * 0x9E3779B97F4A7C15ULL) >> 61; // 0 to RANDOM_LANES - 1
+
+        switch(reduction->type){
+            case REDUCE_MUTEX:
+                pthread_mutex_lock(&reduction->mutex);
+                reduction->total += batchCirclePoints;
+                pthread_mutex_unlock(&reduction->mutex);
+                break;
+            case REDUCE_ATOMIC:
+                atomic_fetch_add_explicit(&reduction->atomicTotal, batchCirclePoints, memory_order_relaxed);
+                break;
+            case REDUCE_LOCAL:
+                local->value += batchCirclePoints;
+                break;
+        }
+    }
+    if(reduction->type == REDUCE_LOCAL){
+        atomic_fetch_add_explicit(&reduction->atomicTotal, local->value, memory_order_relaxed);
+    }
+}
+
+/*
+ * Function: benchmarkReduction
+ * ------------------------
+ * Times adding the circle points of samples / RANDOM_LANES batches to a shared total,
+ * split over the threads of the pool.
+ *
+ * @param *pool       - The worker threads
+ * @param type        - How batches are added to the total
+ * @param samples     - Samples per repetition
+ * @param repetitions - Number of repetitions
+ */
+static void benchmarkReduction(ThreadPool *pool, ReduceType type, uint64_t samples, int repetitions){
+    Reduction reduction;
+    double nanos = 1e300, cycles = 0;
+    uint64_t threadSamples = samples / pool->threadCount;
+
+    reduction.type = type;
+    reduction.updates = threadSamples / RANDOM_LANES;
+    pthread_mutex_init(&reduction.mutex, NULL);
+    reduction.locals = aligned_alloc(CACHE_LINE_SIZE, sizeof(LocalCount) * pool->threadCount);
+    if(reduction.locals == NULL){
+        perror("Error allocating Reduction: ");
+        exit(EXIT_FAILURE);
+    }
+
+    for(int r = 0; r < repetitions; r++){
+        reduction.total = 0;
+        atomic_store(&reduction.atomicTotal, 0);
+        for(int i = 0; i < pool->threadCount; i++){
+            reduction.locals[i].value = 0;
+        }
+
+        Timer start = timerStart();
+        poolRun(pool, reduceTask, &reduction);
+        timerStop(start, reduction.updates * RANDOM_LANES * pool->threadCount, pool->threadCount, &nanos, &cycles);
+    }
+    sink = (double)(reduction.total + atomic_load(&reduction.atomicTotal));
+
+    pthread_mutex_destroy(&reduction.mutex);
+    free(reduction.locals);
+    printResult(reduceNames[type], threadSamples * pool->threadCount, nanos, cycles);
+}
+
+/*
+ * Function: main
+ * ------------------------
+ * Runs every microbenchmark and prints a CSV line for each:
+ * component,samples,ns_per_sample,cycles_per_sample
+ *
+ * @param argc - Number of command line arguments provided
+ * @param *argv[] - array of pointers to the command line arguments
+ *        argv[0] - The name of the this executable file.
+ *        argv[1...n]:
+ *          [-p, --samples]     samples of each repetition (default 2^24)
+ *          [-t, --threads]     threads of the reduction microbenchmarks (default the CPU count)
+ *          [-n, --repetitions] repetitions of each microbenchmark, the best is reported (default 5)
+ *
+ * @return int of how program exits
+ */
+int main(int argc, char *argv[]){
+    uint64_t samples = 1ULL << 24;
+    int threadCount = cpuCount();
+    int repetitions = 5;
+    int c;
+
+    // Retrieving Arguments
+    while((c = getopt_long(argc, argv, "p:t:n:", longOptions, NULL)) != -1){
+        switch(c){
+            case 'p': // Samples
+                errno = 0;
+                samples = strtoull(optarg, NULL, 10);
+                if(errno != 0 || samples == 0){
+                    fprintf(stderr, "Invalid number of samples: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 't': // Thread Count
+                threadCount = atoi(optarg);
+                break;
+            case 'n': // Repetitions
+                repetitions = atoi(optarg);
+                break;
+            default:
+                return EXIT_FAILURE;
+        }
+    }
+    if(threadCount < 1 || repetitions < 1){
+        fprintf(stderr, "Thread count and repetitions must be at least 1\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("component,samples,ns_per_sample,cycles_per_sample\n");
+    benchmarkRandom(RANDOM_XOSHIRO, samples, repetitions);
+    benchmarkRandom(RANDOM_PHILOX, samples, repetitions);
+    benchmarkHitTest(samples, repetitions);
+    benchmarkHitTestFixed(samples, repetitions);
+    for(KernelType type = KERNEL_SCALAR; type <= KERNEL_FIXED; type++){
+        if(kernelSupported(type)){
+            benchmarkKernel(type, PRECISION_DOUBLE, samples, repetitions);
+        }
+    }
+    for(KernelType type = KERNEL_SCALAR; type <= KERNEL_AVX512; type++){
+        if(kernelSupported(type)){
+            benchmarkKernel(type, PRECISION_FLOAT, samples, repetitions);
+        }
+    }
+
+    ThreadPool pool;
+    if(!poolCreate(&pool, threadCount, AFFINITY_NONE)){
+        perror("Error creating Thread Pool: ");
+        return EXIT_FAILURE;
+    }
+    for(ReduceType type = REDUCE_MUTEX; type <= REDUCE_LOCAL; type++){
+        benchmarkReduction(&pool, type, samples, repetitions);
+    }
+    poolDestroy(&pool);
+
+    return EXIT_SUCCESS;
+}
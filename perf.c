@@ -0,0 +1,168 @@
+/* PERF.C
+ *
+ * Per thread hardware performance counters. See perf.h.
+ *
+ */
+#include <string.h>
+#include "perf.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+// Type and config of each event
+static const struct { uint32_t type; uint64_t config; } perfEvents[] = {
+    [PERF_CYCLES] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    [PERF_INSTRUCTIONS] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    [PERF_BRANCH_MISSES] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    [PERF_L1D_MISSES] = {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    [PERF_LLC_MISSES] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES}
+};
+#endif
+
+static const char *perfEventNames[] = {
+    [PERF_CYCLES] = "cycles",
+    [PERF_INSTRUCTIONS] = "instructions",
+    [PERF_BRANCH_MISSES] = "branch-misses",
+    [PERF_L1D_MISSES] = "L1d-misses",
+    [PERF_LLC_MISSES] = "LLC-misses"
+};
+
+/*
+ * Function: perfOpen
+ * ------------------------
+ * Opens the counters of the calling thread, disabled, as one group led by the cycles
+ * counter. Must be called by the thread that is to be counted.
+ *
+ * @param *counters - The counters to open
+ *
+ * @return int of the number of counters opened, 0 if the system provides none
+ */
+int perfOpen(PerfCounters *counters){
+    int opened = 0;
+
+    counters->opened = 1;
+    for(int i = 0; i < PERF_EVENT_COUNT; i++){
+        counters->fds[i] = -1;
+    }
+#ifdef __linux__
+    for(int i = 0; i < PERF_EVENT_COUNT; i++){
+        int leader = counters->fds[PERF_CYCLES];
+        if(i != PERF_CYCLES && leader < 0){
+            break;
+        }
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = perfEvents[i].type;
+        attr.config = perfEvents[i].config;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        attr.disabled = i == PERF_CYCLES; // The others follow the leader
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        // pid 0 and cpu -1: the calling thread, on whichever CPU it runs
+        counters->fds[i] = (int) syscall(SYS_perf_event_open, &attr, 0, -1, i == PERF_CYCLES ? -1 : leader, 0);
+        opened += counters->fds[i] >= 0;
+    }
+#endif
+    return opened;
+}
+
+/*
+ * Function: perfStart
+ * ------------------------
+ * Resets and enables the counters.
+ *
+ * @param *counters - The counters, opened by the calling thread
+ */
+void perfStart(PerfCounters *counters){
+#ifdef __linux__
+    if(counters->fds[PERF_CYCLES] >= 0){
+        ioctl(counters->fds[PERF_CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(counters->fds[PERF_CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#else
+    (void) counters;
+#endif
+}
+
+/*
+ * Function: perfStop
+ * ------------------------
+ * Disables the counters and adds their counts since perfStart to values. If the kernel
+ * multiplexed the group, the counts are scaled by the time enabled over the time running.
+ *
+ * @param *counters  - The counters, opened by the calling thread
+ * @param *values    - PERF_EVENT_COUNT totals the counts are added to
+ * @param *available - Or'd with a bit (1 << event) for each counter that could be read
+ * @param *scaled    - Or'd with a bit (1 << event) for each counter that was scaled
+ */
+void perfStop(PerfCounters *counters, uint64_t *values, unsigned *available, unsigned *scaled){
+#ifdef __linux__
+    // Number of counters, time enabled, time running, then the counts in the order opened
+    uint64_t group[3 + PERF_EVENT_COUNT];
+    int leader = counters->fds[PERF_CYCLES];
+
+    if(leader < 0){
+        return;
+    }
+    ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    ssize_t size = read(leader, group, sizeof(group));
+    if(size < (ssize_t)(3 * sizeof(uint64_t)) || group[2] == 0){
+        return; // The group never ran
+    }
+    uint64_t enabled = group[1], running = group[2];
+    uint64_t next = 0;
+    for(int i = 0; i < PERF_EVENT_COUNT && next < group[0]; i++){
+        if(counters->fds[i] < 0){
+            continue;
+        }
+        uint64_t count = group[3 + next++];
+        if(running < enabled){
+            count = (uint64_t)((double)count * enabled / running);
+            *scaled |= 1u << i;
+        }
+        values[i] += count;
+        *available |= 1u << i;
+    }
+#else
+    (void) counters;
+    (void) values;
+    (void) available;
+    (void) scaled;
+#endif
+}
+
+/*
+ * Function: perfClose
+ * ------------------------
+ * @param *counters - The counters to close
+ */
+void perfClose(PerfCounters *counters){
+    if(!counters->opened){
+        return;
+    }
+#ifdef __linux__
+    for(int i = 0; i < PERF_EVENT_COUNT; i++){
+        if(counters->fds[i] >= 0){
+            close(counters->fds[i]);
+        }
+    }
+#endif
+    counters->opened = 0;
+}
+
+/*
+ * Function: perfEventName
+ * ------------------------
+ * @param event - The event
+ *
+ * @return const char* of the name of the event
+ */
+const char* perfEventName(PerfEvent event){
+    return perfEventNames[event];
+}
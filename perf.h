@@ -0,0 +1,47 @@
+/* PERF.H
+ *
+ * Hardware performance counters of a worker thread, read with perf_event_open on Linux.
+ * The counters are opened as one group under the cycles counter, so they count over the
+ * same intervals and their ratios hold. A CPU or virtual machine that lacks an event
+ * still reports the others, but nothing is counted without cycles. When the PMU has too
+ * few counters the kernel multiplexes the group; its counts are then scaled up from the
+ * time it ran and flagged. Only user space is counted, which works with the default
+ * perf_event_paranoid setting.
+ *
+ */
+#ifndef PERF_H
+#define PERF_H
+
+#include <stdint.h>
+
+/* Enum: PerfEvent
+ * The counted events.
+ */
+typedef enum PerfEventEnum{
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_BRANCH_MISSES,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_EVENT_COUNT
+}PerfEvent;
+
+/* Structure: PerfCounters
+ * The counters of one thread.
+ *
+ * @variable fds    - File descriptor of each counter, -1 if it could not be opened. The
+ *                   cycles counter leads the group.
+ * @variable opened - Set once perfOpen has been called on the owning thread
+ */
+typedef struct PerfCountersStruct{
+    int fds[PERF_EVENT_COUNT];
+    int opened;
+}PerfCounters;
+
+int perfOpen(PerfCounters *counters);
+void perfStart(PerfCounters *counters);
+void perfStop(PerfCounters *counters, uint64_t *values, unsigned *available, unsigned *scaled);
+void perfClose(PerfCounters *counters);
+const char* perfEventName(PerfEvent event);
+
+#endif //PERF_H
@@ -0,0 +1,146 @@
+/* POOL.C
+ *
+ * Persistent pool of worker threads. See pool.h.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "pool.h"
+#include "stats.h"
+
+/*
+ * Function: poolThread
+ * ------------------------
+ * Body of every pool thread. Pins itself, then runs each task posted to the pool until
+ * the pool is destroyed.
+ *
+ * @param *w - void pointer to the PoolWorker of the thread
+ *
+ * @return void* that will always be NULL
+ */
+static void* poolThread(void *w){
+    PoolWorker *worker = (PoolWorker*) w;
+    ThreadPool *pool = worker->pool;
+    uint64_t seenGeneration = 0;
+
+    pinThread(pool->affinity, worker->id);
+    worker->ready = monotonicSeconds();
+
+    pthread_mutex_lock(&pool->mutex);
+    while(1){
+        while(pool->generation == seenGeneration && !pool->stopping){
+            pthread_cond_wait(&pool->start, &pool->mutex);
+        }
+        if(pool->stopping){
+            break;
+        }
+        seenGeneration = pool->generation;
+        PoolTask task = pool->task;
+        void *arg = pool->arg;
+        pthread_mutex_unlock(&pool->mutex);
+
+        task(arg, worker->id);
+        worker->finished = monotonicSeconds();
+
+        pthread_mutex_lock(&pool->mutex);
+        if(--pool->running == 0){
+            pthread_cond_signal(&pool->done);
+        }
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;
+}
+
+/*
+ * Function: poolCreate
+ * ------------------------
+ * Creates the threads of a pool. The threads wait for tasks posted with poolRun.
+ *
+ * @param *pool       - The pool to create
+ * @param threadCount - Number of threads in the pool
+ * @param affinity    - How the threads are pinned to CPUs
+ *
+ * @return int of 1 on success, 0 if the threads could not be created
+ */
+int poolCreate(ThreadPool *pool, int threadCount, Affinity affinity){
+    pool->threadCount = threadCount;
+    pool->affinity = affinity;
+    pool->generation = 0;
+    pool->running = 0;
+    pool->stopping = 0;
+    pool->task = NULL;
+    pool->arg = NULL;
+    pool->threads = malloc(sizeof(pthread_t) * threadCount);
+    pool->workers = malloc(sizeof(PoolWorker) * threadCount);
+    if(pool->threads == NULL || pool->workers == NULL){
+        free(pool->threads);
+        free(pool->workers);
+        return 0;
+    }
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    for(int i = 0; i < threadCount; i++){
+        pool->workers[i].pool = pool;
+        pool->workers[i].id = i;
+        pool->workers[i].created = monotonicSeconds();
+
+        int status = pthread_create(&(pool->threads[i]), NULL, poolThread, &pool->workers[i]);
+        if(status != 0){
+            perror("Error creating Thread: ");
+            pool->threadCount = i;
+            poolDestroy(pool);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Function: poolRun
+ * ------------------------
+ * Runs task(arg, worker) on every thread of the pool and waits for all of them to finish.
+ *
+ * @param *pool - The pool to run the task on
+ * @param task  - The function each thread runs
+ * @param *arg  - Argument passed to the task
+ */
+void poolRun(ThreadPool *pool, PoolTask task, void *arg){
+    pthread_mutex_lock(&pool->mutex);
+    pool->task = task;
+    pool->arg = arg;
+    pool->running = pool->threadCount;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+
+    while(pool->running > 0){
+        pthread_cond_wait(&pool->done, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+/*
+ * Function: poolDestroy
+ * ------------------------
+ * Stops and joins the threads of a pool and frees it.
+ *
+ * @param *pool - The pool to destroy
+ */
+void poolDestroy(ThreadPool *pool){
+    pthread_mutex_lock(&pool->mutex);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for(int i = 0; i < pool->threadCount; i++){
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->done);
+    free(pool->threads);
+    free(pool->workers);
+}
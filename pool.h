@@ -0,0 +1,70 @@
+/* POOL.H
+ *
+ * Persistent pool of worker threads. Threads are created and pinned once, then sleep
+ * between runs, so repeated estimations do not pay for pthread_create and pthread_join.
+ *
+ */
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include "topology.h"
+
+typedef void (*PoolTask)(void *arg, int worker);
+
+typedef struct ThreadPoolStruct ThreadPool;
+
+/* Structure: PoolWorker
+ * Passed to each pool thread.
+ *
+ * @variable *pool    - The pool the thread belongs to
+ * @variable id       - Index of the thread in the pool
+ * @variable created  - CLOCK_MONOTONIC time at which the thread was created
+ * @variable ready    - Time at which the thread was pinned and ready for tasks
+ * @variable finished - Time at which the thread finished its last task
+ */
+typedef struct PoolWorkerStruct{
+    ThreadPool *pool;
+    int id;
+    double created;
+    double ready;
+    double finished;
+}PoolWorker;
+
+/* Structure: ThreadPool
+ * Holds the threads of a pool and the task they are running.
+ *
+ * @variable threadCount - Number of threads in the pool
+ * @variable *threads    - The pool threads
+ * @variable *workers    - The PoolWorker passed to each thread
+ * @variable affinity    - How the threads are pinned to CPUs
+ * @variable mutex       - Protects every variable below
+ * @variable start       - Signalled when a new task is posted, or the pool is stopping
+ * @variable done        - Signalled when the last thread finishes a task
+ * @variable generation  - Incremented for every task posted
+ * @variable running     - Number of threads still running the current task
+ * @variable stopping    - Set when the pool is being destroyed
+ * @variable task        - The task being run
+ * @variable *arg        - Argument passed to the task
+ */
+struct ThreadPoolStruct{
+    int threadCount;
+    pthread_t *threads;
+    PoolWorker *workers;
+    Affinity affinity;
+    pthread_mutex_t mutex;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    uint64_t generation;
+    int running;
+    int stopping;
+    PoolTask task;
+    void *arg;
+};
+
+int poolCreate(ThreadPool *pool, int threadCount, Affinity affinity);
+void poolRun(ThreadPool *pool, PoolTask task, void *arg);
+void poolDestroy(ThreadPool *pool);
+
+#endif //POOL_H
@@ -0,0 +1,120 @@
+/* PROGRESS.C
+ *
+ * Running totals and confidence interval of an estimation. See progress.h.
+ *
+ */
+#include <math.h>
+#include "progress.h"
+#include "stats.h"
+
+/*
+ * Function: progressInit
+ * ------------------------
+ * @param *progress - The totals to initialise
+ * @param radius    - Radius of the circle
+ * @param unit      - Score of a point inside the circle, see estimatorUnit
+ * @param tolerance - Half width of the 95% confidence interval of the area at which the
+ *                    run stops, 0 to never stop
+ * @param timeLimit - Seconds from now after which the run stops, 0 for no limit
+ */
+void progressInit(Progress *progress, double radius, uint64_t unit, double tolerance, double timeLimit){
+    pthread_mutex_init(&progress->mutex, NULL);
+    progress->pointCount = 0;
+    progress->circlePoints = 0;
+    progress->batches = 0;
+    progress->mean = 0;
+    progress->m2 = 0;
+    progress->radius = radius;
+    progress->unit = unit;
+    progress->tolerance = tolerance;
+    progress->deadline = timeLimit > 0 ? monotonicSeconds() + timeLimit : 0;
+}
+
+/*
+ * Function: progressDestroy
+ * ------------------------
+ * @param *progress - The totals to free
+ */
+void progressDestroy(Progress *progress){
+    pthread_mutex_destroy(&progress->mutex);
+}
+
+/*
+ * Function: confidenceHalfWidth
+ * ------------------------
+ * Half width of the 95% confidence interval of the area, from the variance of the chunk
+ * estimates. Must be called with the mutex held.
+ *
+ * @param *progress - The totals
+ *
+ * @return double of the half width, or INFINITY until two chunks have been reported
+ */
+static double confidenceHalfWidth(Progress *progress){
+    if(progress->batches < 2){
+        return INFINITY;
+    }
+    double variance = progress->m2 / (double)(progress->batches - 1);
+    return PROGRESS_Z * sqrt(variance / (double)progress->batches);
+}
+
+/*
+ * Function: progressReport
+ * ------------------------
+ * Adds a finished chunk to the totals and checks whether the tolerance has been reached or
+ * the deadline has passed. Chunks reported after that are still added, so the final area
+ * uses every point drawn.
+ *
+ * @param *progress     - The totals
+ * @param pointCount    - Number of points in the chunk
+ * @param circlePoints  - Number of those points inside the circle
+ *
+ * @return int of 1 if the run should stop, otherwise returns 0
+ */
+int progressReport(Progress *progress, uint64_t pointCount, uint64_t circlePoints){
+    double area = ((double)circlePoints/((double)pointCount*(double)progress->unit))*4*progress->radius*progress->radius;
+
+    pthread_mutex_lock(&progress->mutex);
+    progress->pointCount += pointCount;
+    progress->circlePoints += circlePoints;
+    progress->batches++;
+
+    double delta = area - progress->mean;
+    progress->mean += delta / (double)progress->batches;
+    progress->m2 += delta * (area - progress->mean);
+
+    int done = progress->tolerance > 0 && progress->batches >= PROGRESS_MIN_BATCHES &&
+               confidenceHalfWidth(progress) < progress->tolerance;
+    pthread_mutex_unlock(&progress->mutex);
+
+    return done || (progress->deadline > 0 && monotonicSeconds() >= progress->deadline);
+}
+
+/*
+ * Function: progressArea
+ * ------------------------
+ * @param *progress - The totals
+ *
+ * @return double of the area of the circle estimated from every point reported
+ */
+double progressArea(Progress *progress){
+    pthread_mutex_lock(&progress->mutex);
+    double area = progress->pointCount == 0 ? 0 :
+                  ((double)progress->circlePoints/((double)progress->pointCount*(double)progress->unit))*
+                  4*progress->radius*progress->radius;
+    pthread_mutex_unlock(&progress->mutex);
+    return area;
+}
+
+/*
+ * Function: progressError
+ * ------------------------
+ * @param *progress - The totals
+ *
+ * @return double of the half width of the 95% confidence interval of the area
+ */
+double progressError(Progress *progress){
+    pthread_mutex_lock(&progress->mutex);
+    double error = confidenceHalfWidth(progress);
+    pthread_mutex_unlock(&progress->mutex);
+    return error;
+}
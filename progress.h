@@ -0,0 +1,56 @@
+/* PROGRESS.H
+ *
+ * Running totals of an estimation that is not given a fixed number of points. Workers
+ * report every chunk they finish; the running variance of the per chunk estimates
+ * (batch means) gives a confidence interval for the area. The run is stopped once the
+ * interval is narrower than the requested tolerance, or once its time limit has passed.
+ *
+ */
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+// z value of a two sided 95% confidence interval
+#define PROGRESS_Z 1.959963984540054
+// Chunks reported before the variance estimate is trusted
+#define PROGRESS_MIN_BATCHES 32
+// Points in each chunk of a run without a fixed number of points. Smaller than the
+// default chunk so the run stops soon after the tolerance is reached.
+#define PROGRESS_CHUNK_POINTS (1ULL << 16)
+
+/* Structure: Progress
+ * Totals of the chunks reported so far.
+ *
+ * @variable mutex        - Protects every variable below, taken once per chunk
+ * @variable pointCount   - Number of points reported
+ * @variable circlePoints - Score of those points, the number inside the circle times unit
+ * @variable batches      - Number of chunks reported
+ * @variable mean         - Mean of the area estimated by each chunk
+ * @variable m2           - Sum of squared differences from the mean (Welford's algorithm)
+ * @variable radius       - Radius of the circle
+ * @variable unit         - Score of a point inside the circle, see estimatorUnit
+ * @variable tolerance    - Half width of the confidence interval to reach, 0 to never stop
+ * @variable deadline     - CLOCK_MONOTONIC time in seconds at which to stop, 0 for no limit
+ */
+typedef struct ProgressStruct{
+    pthread_mutex_t mutex;
+    uint64_t pointCount;
+    uint64_t circlePoints;
+    uint64_t batches;
+    double mean;
+    double m2;
+    double radius;
+    uint64_t unit;
+    double tolerance;
+    double deadline;
+}Progress;
+
+void progressInit(Progress *progress, double radius, uint64_t unit, double tolerance, double timeLimit);
+void progressDestroy(Progress *progress);
+int progressReport(Progress *progress, uint64_t pointCount, uint64_t circlePoints);
+double progressArea(Progress *progress);
+double progressError(Progress *progress);
+
+#endif //PROGRESS_H
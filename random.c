@@ -0,0 +1,354 @@
+/* RANDOM.C
+ *
+ * Seeding, jumping and block functions of the random number streams.
+ * See random.h for the hot path functions.
+ *
+ */
+#include <string.h>
+#include "random.h"
+
+// Philox4x32 multipliers and Weyl sequence constants used to bump the key
+#define PHILOX_M0 0xD2511F53U
+#define PHILOX_M1 0xCD9E8D57U
+#define PHILOX_W0 0x9E3779B9U
+#define PHILOX_W1 0xBB67AE85U
+#define PHILOX_ROUNDS 10
+
+// Jump polynomials of 2^i blocks of a xoshiro256** block stream, 2^(64 + i) numbers each:
+// x^(2^(64 + i)) modulo the characteristic polynomial of the generator, the same form as
+// the polynomials of xoshiroJump (2^128, reached by twice the last one) and xoshiroLongJump
+static const uint64_t blockJumps[64][4] = {
+    {0xB13C16E8096F0754ULL, 0xB60D6C5B8C78F106ULL, 0x34FAFF184785C20AULL, 0x12E4A2FBFC19BFF9ULL},
+    {0x69135F8AE4F3BECBULL, 0xE9CD737204214BDFULL, 0x71C9CDDCC21B4D96ULL, 0x1E22C55ED04628F4ULL},
+    {0x43F19411729E47A3ULL, 0xCDC2F8ABC30FACD8ULL, 0xD3C646CA742CFD35ULL, 0xB6E16802C1E5A473ULL},
+    {0xE1040FEFA7016612ULL, 0xCF7A45DDBD380C46ULL, 0xE9121D42D889F1E6ULL, 0x71583507471DF592ULL},
+    {0x7DC73DE451F84F31ULL, 0xEF00865CCDC62B40ULL, 0x3481941C63B9723BULL, 0x790035ED5D8A5206ULL},
+    {0xB7FDE9C10DDE1033ULL, 0xE2B26892066519E7ULL, 0x1B2E1E5F58CA50E9ULL, 0xC5245C9108C8303BULL},
+    {0xF7E31117FCA1FDE3ULL, 0xD0229895C9855019ULL, 0x80DD958FC2CE8B38ULL, 0x72636702AF55F1AEULL},
+    {0xF4FDF1938A08C423ULL, 0x369B623AC732F278ULL, 0x59970509D58AFCB4ULL, 0xAF24371B5A1A053DULL},
+    {0xE38BD8D6060EECB2ULL, 0x4F2A8443CC705E1BULL, 0x98AEA009DE1E6B3BULL, 0xC2A214D5CCFDC9CCULL},
+    {0x779E326BEA03051EULL, 0xFE60945B17507FF1ULL, 0xB35A81DDFD74498BULL, 0x045C97103176AD4CULL},
+    {0xF99F64A8EEF50ACCULL, 0x967C5D39BFF598C3ULL, 0xE54B1F90F1804A5BULL, 0x8C79D3FD0CD87D25ULL},
+    {0x5BF7C3946011203DULL, 0x00DC697C0CE8F5BFULL, 0x9B135F39CBD24442ULL, 0x44A26649C72EAF79ULL},
+    {0x1FE0CE6E4A5FBFA9ULL, 0x05063F82926B1050ULL, 0x6F0BD8889BC16B65ULL, 0x621F84D4C5B7D5B2ULL},
+    {0x0BD0D4953231DC02ULL, 0x8CAC609DD3F769EAULL, 0xA2CE3240999F0395ULL, 0xAFB60DE4EF76F2D8ULL},
+    {0xE41A05C6D5AD6443ULL, 0xB46E28D0DD20BE9CULL, 0x5D5A93BB678D1FF3ULL, 0x6D9D47D177FDA8E1ULL},
+    {0x3750097BC18818DFULL, 0xC05CB5489FABD6BAULL, 0xF671F175F29BD401ULL, 0x69B492AD849876A0ULL},
+    {0x6C1A4D1BEE4CFB25ULL, 0x0355DAB5AAADA356ULL, 0x5D23C239088B488EULL, 0x2C09EBB60B81941AULL},
+    {0x85BC661B5FE4C77FULL, 0xA77D08C97AA93A7BULL, 0x1C4DF4E6DC4DAA6CULL, 0x3D8C3676399ECE2DULL},
+    {0x0D50032E0877BA29ULL, 0xB12FEC5CC6984936ULL, 0x97595CE59431E3AAULL, 0xD6FC185137AF1D8BULL},
+    {0x49AA26E5D4BF7857ULL, 0x754228FC68530845ULL, 0xD5CACE972FEE73FAULL, 0x86B251394485C94BULL},
+    {0x8D480422727CA5CEULL, 0xDFD675636A53A2ADULL, 0xBFF33C810D4F1E62ULL, 0xB0BAAE7F98B528C0ULL},
+    {0xB0908FAA94BFC92CULL, 0x7D85E7CB6751BCBBULL, 0x6A4D1FD3BF02D558ULL, 0x3FA865FF30EA93F7ULL},
+    {0xD0D6BE52A69E58C9ULL, 0xA789C54654CA7C28ULL, 0x5AA4DACDC52ADD36ULL, 0x3C3C2884D98788BCULL},
+    {0x5F3F3B8FEF0ED6B3ULL, 0x41288120B4579CF8ULL, 0x4C9CA45E4BC2A3C3ULL, 0x15E0FED2F7BCCFEFULL},
+    {0xD262B21891DB8D4EULL, 0x53B8A4A16A46D7C3ULL, 0x9C885317A50787EBULL, 0xA949942AFC5A2F2CULL},
+    {0x718AEC6A573DE99DULL, 0xC0A2019A1A152787ULL, 0x4EA029EA5DBF8C1DULL, 0xFE740FFAD9E17687ULL},
+    {0x07F145F47C78AC8EULL, 0x35E2E29698D7EB0DULL, 0x228277008B5FB669ULL, 0x77A27A67F88F49E1ULL},
+    {0x6627DA855E5050FBULL, 0x7C62ECE20D8BE011ULL, 0x6648B4EF24A58856ULL, 0x1029F062E580DA26ULL},
+    {0xA9FFE6995923A7B1ULL, 0x34092A8E98B795BEULL, 0x6F17A03A6BC6A877ULL, 0xA0D23922F4DC9916ULL},
+    {0x062E89B53F6CEA07ULL, 0x0EE2CAF1DF36F661ULL, 0x35E67F142DA25ACAULL, 0x336F2F9401F82041ULL},
+    {0xBF67135726C63517ULL, 0x93B549A81FD07BE4ULL, 0xD617E92E93EA4567ULL, 0xA3A29886C86C3CDEULL},
+    {0x21FF06188C9CC699ULL, 0xF9D3A86C856B8A26ULL, 0xC51D91ED4856B46EULL, 0xFE0143FD314C9E7EULL},
+    {0x148C356C3114B7A9ULL, 0xCDB45D7DEF42C317ULL, 0xB27C05962EA56A13ULL, 0x31EEBB6C82A9615FULL},
+    {0x5D4DA92B5D749EE7ULL, 0xD8AED72F2C4C8D06ULL, 0xD863413B92CAE906ULL, 0xC78709F4E0724160ULL},
+    {0xC72A478E776AA7E8ULL, 0xE2ECE3B6969FE76AULL, 0xF59E618FAAEBAE8AULL, 0x43B4A1C47D75F54AULL},
+    {0x85043FB7B5EC46D9ULL, 0xB24FEEE905FD9032ULL, 0xF018DA68303DD3AAULL, 0x57F74D5C8E13EABEULL},
+    {0x1FE7835E4087FE62ULL, 0xA797DD2A234C782BULL, 0x6BEF1C2CBCFF5536ULL, 0xBF7E526FEAFE9FABULL},
+    {0x2B8E518FF5D4CF7BULL, 0x5AA27A4749244838ULL, 0x75B4D7F6CC9F25E1ULL, 0x944120083AF78D61ULL},
+    {0x3D6F902C3475CABEULL, 0x1BF5AAD8660B3DFFULL, 0x1965EE22FD231EADULL, 0xA1D8B4C28AEBB851ULL},
+    {0x8F55A96AFE8C60D6ULL, 0xC97A1BEEDB0CD181ULL, 0x65E7E4D9E2832455ULL, 0x9C9E175A184AFB53ULL},
+    {0x652CB4CCD4073F0FULL, 0x74B6DA57EA2BC33AULL, 0x0A65EEF991740328ULL, 0xB9D862913D6F7E40ULL},
+    {0x1045804FFACE6BF3ULL, 0x10698E01C2AE9C87ULL, 0xD4B46D9444C365A7ULL, 0x82998B76E46A33D6ULL},
+    {0x0A2C871D4E66D5CDULL, 0x02416381D70E6C43ULL, 0xF1A9CB543A0BFA10ULL, 0x8DA69514B40B00E7ULL},
+    {0xB79A9592B42DCF38ULL, 0x4DC5FF02CD80EA1DULL, 0x83D4E917F16BE77BULL, 0x27B45C44EE4A6229ULL},
+    {0x4D5D5691E346A117ULL, 0xAE1E5F3FF8B47720ULL, 0x219D46C745E04DE7ULL, 0x3762BEAB010E60B1ULL},
+    {0xA26C20FEB2AE9F7DULL, 0xB46FBA890F1CA8F6ULL, 0x634AD6497E9D5D70ULL, 0x1CBF90CD7272DB76ULL},
+    {0xB0C0F65D5E452C0DULL, 0x9B34B9C8C6C9C0E0ULL, 0x4FB63D3B5EB99097ULL, 0x5F46DAF7953C1BB3ULL},
+    {0x7FAFC3B0810DB88EULL, 0xA08F672EAF81F898ULL, 0x188DC353D2D4788AULL, 0x0127923940E883A8ULL},
+    {0xFF09F37DF22EAB9AULL, 0xE903694ADA9D6795ULL, 0x9A5475C8D2FB2D20ULL, 0x19809DF824096BA1ULL},
+    {0x656C70A5F3F5C710ULL, 0x861797E8573BFCD7ULL, 0xE6A590CA622A3320ULL, 0x7EA9FC3051E87B78ULL},
+    {0x6AAA9929398CD48AULL, 0x5AD3EEC2014D42B6ULL, 0x84D72B234E8A5479ULL, 0x644A875145D5D51FULL},
+    {0x6C738865ED73B377ULL, 0x00659F02B37A017CULL, 0x203951CFD23E94CBULL, 0x6D2CC53F91AF5F85ULL},
+    {0xF7AF674289519C6CULL, 0x8BC10737770D137EULL, 0xBEF3D95E4E54413AULL, 0xC0864662B10083E8ULL},
+    {0xF5238B0FF86D1867ULL, 0x1D6286A155723D48ULL, 0xEB185B3B61EF2507ULL, 0xCECDA49FAF04BBFBULL},
+    {0x644B243F9D056A3AULL, 0x99C6CD156B9744DFULL, 0xA02CCBD8D031B5D5ULL, 0x2732A7244A31E5DDULL},
+    {0x25523B168236DA8CULL, 0x75E9335039224B3BULL, 0xDF8F6390D609A5D4ULL, 0x216F9077C64F36F6ULL},
+    {0xC291983AA3A3A178ULL, 0x565C9F7A11C40482ULL, 0xEF5B7611F90B7C08ULL, 0x56AB0CA212A8D012ULL},
+    {0xB400D4604C1D59DBULL, 0xD73FE72BA2D98892ULL, 0xC7ABDFBC652ABF3EULL, 0x45C2AD3649667C04ULL},
+    {0x9BB885CD5AA00A8CULL, 0x543FA081564A326FULL, 0x058B3D55BFAA4AADULL, 0x91C1510F9B6F2EF8ULL},
+    {0x7A3E03325FB2EEB7ULL, 0x09CF7D85A86C1A90ULL, 0x53C8DFBA6C9AACAEULL, 0x9D6EF09217BF59B7ULL},
+    {0xE98651FA6FB0337BULL, 0x0BBFD59ED2151F31ULL, 0xD8289B4AE487D7E1ULL, 0xA1A3090EF816C214ULL},
+    {0xAEB33557C76543FEULL, 0x1B18A0517CEA386AULL, 0x56E93ECB5B361995ULL, 0xAA72E405FB26C80AULL},
+    {0x46555CF90FC3D1CBULL, 0x57C811875C625284ULL, 0x8397AEEDC528C3F0ULL, 0xFD4D894C8F82680AULL},
+    {0xEACBD852B93BD815ULL, 0x4DD8801BAA92FDDAULL, 0xA50845F0F4301985ULL, 0xD46CB8565ABAD18EULL}
+};
+
+/*
+ * Function: splitMix64
+ * ------------------------
+ * Returns the next number of a SplitMix64 sequence. Used to expand a single seed
+ * into a full generator state, as recommended by the xoshiro authors.
+ *
+ * @param *x - The SplitMix64 state, advanced by each call
+ *
+ * @return uint64_t of the next number in the sequence
+ */
+static uint64_t splitMix64(uint64_t *x){
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/*
+ * Function: xoshiroApplyJump
+ * ------------------------
+ * Advances a xoshiro256** state by the distance encoded in the jump polynomial provided.
+ *
+ * @param state - The state to advance
+ * @param jump  - The jump polynomial
+ */
+static void xoshiroApplyJump(uint64_t state[4], const uint64_t jump[4]){
+    uint64_t s[4] = {0, 0, 0, 0};
+
+    for(int i = 0; i < 4; i++){
+        for(int b = 0; b < 64; b++){
+            if(jump[i] & (1ULL << b)){
+                s[0] ^= state[0];
+                s[1] ^= state[1];
+                s[2] ^= state[2];
+                s[3] ^= state[3];
+            }
+            xoshiroNext(state);
+        }
+    }
+    memcpy(state, s, sizeof(s));
+}
+
+/*
+ * Function: xoshiroApplyJumpLanes
+ * ------------------------
+ * Advances every lane of a stream's xoshiro256** state by the distance encoded in the jump
+ * polynomial provided. The lanes are stepped together, as the vector kernels step them.
+ *
+ * @param state - The lane interleaved state to advance
+ * @param jump  - The jump polynomial
+ */
+static void xoshiroApplyJumpLanes(uint64_t state[4][RANDOM_LANES], const uint64_t jump[4]){
+    uint64_t s[4][RANDOM_LANES] = {{0}};
+
+    for(int i = 0; i < 4; i++){
+        for(int b = 0; b < 64; b++){
+            uint64_t mask = 0 - ((jump[i] >> b) & 1);
+            for(int lane = 0; lane < RANDOM_LANES; lane++){
+                s[0][lane] ^= state[0][lane] & mask;
+                s[1][lane] ^= state[1][lane] & mask;
+                s[2][lane] ^= state[2][lane] & mask;
+                s[3][lane] ^= state[3][lane] & mask;
+            }
+            for(int lane = 0; lane < RANDOM_LANES; lane++){
+                uint64_t t = state[1][lane] << 17;
+                state[2][lane] ^= state[0][lane];
+                state[3][lane] ^= state[1][lane];
+                state[1][lane] ^= state[2][lane];
+                state[0][lane] ^= state[3][lane];
+                state[2][lane] ^= t;
+                state[3][lane] = rotateLeft(state[3][lane], 45);
+            }
+        }
+    }
+    memcpy(state, s, sizeof(s));
+}
+
+/*
+ * Function: xoshiroJump
+ * ------------------------
+ * Advances a xoshiro256** state by 2^128 steps.
+ *
+ * @param state - The state to advance
+ */
+void xoshiroJump(uint64_t state[4]){
+    static const uint64_t jump[4] = {0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL,
+                                     0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL};
+    xoshiroApplyJump(state, jump);
+}
+
+/*
+ * Function: xoshiroLongJump
+ * ------------------------
+ * Advances a xoshiro256** state by 2^192 steps.
+ *
+ * @param state - The state to advance
+ */
+void xoshiroLongJump(uint64_t state[4]){
+    static const uint64_t jump[4] = {0x76E15D3EFEFDCBBFULL, 0xC5004E441C522FB3ULL,
+                                     0x77710069854EE241ULL, 0x39109BB02ACBE635ULL};
+    xoshiroApplyJump(state, jump);
+}
+
+/*
+ * Function: philoxBlock
+ * ------------------------
+ * Computes one Philox4x32-10 block: ten rounds of multiply/xor mixing of the counter,
+ * bumping the key between each round.
+ *
+ * @param counter - The counter to encrypt
+ * @param key     - The key of the stream
+ * @param output  - The four random 32 bit words
+ */
+void philoxBlock(const uint32_t counter[4], const uint32_t key[2], uint32_t output[4]){
+    uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+    uint32_t k0 = key[0], k1 = key[1];
+
+    for(int round = 0; round < PHILOX_ROUNDS; round++){
+        uint64_t product0 = (uint64_t)PHILOX_M0 * c0;
+        uint64_t product1 = (uint64_t)PHILOX_M1 * c2;
+
+        c0 = (uint32_t)(product1 >> 32) ^ c1 ^ k0;
+        c1 = (uint32_t)product1;
+        c2 = (uint32_t)(product0 >> 32) ^ c3 ^ k1;
+        c3 = (uint32_t)product0;
+
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+
+    output[0] = c0;
+    output[1] = c1;
+    output[2] = c2;
+    output[3] = c3;
+}
+
+/*
+ * Function: randomSeed
+ * ------------------------
+ * Initialises a random stream. Streams created with the same seed but a different
+ * streamId never overlap:
+ *   - xoshiro256** streams are long jumped streamId times (2^192 numbers apart),
+ *     then each lane of the stream is jumped 2^128 numbers from the previous lane
+ *   - Philox streams put the streamId in the upper half of the counter
+ *
+ * @param *stream  - The stream to initialise
+ * @param type     - The generator to use
+ * @param seed     - The seed shared by all streams of a run
+ * @param streamId - Index of this stream, normally the worker thread number
+ */
+void randomSeed(RandomStream *stream, RandomType type, uint64_t seed, uint64_t streamId){
+    memset(stream, 0, sizeof(*stream));
+    stream->type = type;
+
+    if(type == RANDOM_PHILOX){
+        uint64_t mix = seed;
+        uint64_t key = splitMix64(&mix);
+        stream->key[0] = (uint32_t)key;
+        stream->key[1] = (uint32_t)(key >> 32);
+        stream->counter[2] = (uint32_t)streamId;
+        stream->counter[3] = (uint32_t)(streamId >> 32);
+        stream->bufferIndex = 2; // Empty, the first call generates a block
+        return;
+    }
+
+    uint64_t mix = seed;
+    uint64_t state[4];
+    for(int i = 0; i < 4; i++){
+        state[i] = splitMix64(&mix);
+    }
+    for(uint64_t i = 0; i < streamId; i++){
+        xoshiroLongJump(state);
+    }
+
+    // Lanes of the stream are 2^128 numbers apart
+    for(int lane = 0; lane < RANDOM_LANES; lane++){
+        for(int i = 0; i < 4; i++){
+            stream->state[i][lane] = state[i];
+        }
+        xoshiroJump(state);
+    }
+}
+
+/*
+ * Function: randomSeedBlock
+ * ------------------------
+ * Initialises the stream of one block of points of a run, see RANDOM_BLOCK_POINTS. The
+ * streams of the blocks of a seed never overlap:
+ *   - xoshiro256** lanes start from the seed expanded as randomSeed does, lane l long
+ *     jumped l times (2^192 numbers apart), and are jumped 2^64 numbers for each block.
+ *     Each lane draws at most 2 * RANDOM_BLOCK_POINTS / RANDOM_LANES numbers of a block,
+ *     far fewer than 2^64, and a run has fewer than 2^48 blocks. The state at the start
+ *     of the last block is kept, so a later block only jumps by the blocks in between,
+ *     one jump per set bit of their number.
+ *   - Philox streams put the block in the upper half of the counter, as randomSeed does
+ *     with the streamId
+ *
+ * @param *stream - The stream to initialise, already initialised by randomSeed or
+ *                  randomSeedBlock
+ * @param type    - The generator to use
+ * @param seed    - The seed of the run
+ * @param block   - Index of the block, its first point divided by RANDOM_BLOCK_POINTS
+ */
+void randomSeedBlock(RandomStream *stream, RandomType type, uint64_t seed, uint64_t block){
+    if(type == RANDOM_PHILOX){
+        randomSeed(stream, type, seed, block);
+        return;
+    }
+
+    if(stream->type != type || !stream->blockSeeded || stream->blockSeed != seed || stream->block > block){
+        uint64_t mix = seed;
+        uint64_t state[4];
+        for(int i = 0; i < 4; i++){
+            state[i] = splitMix64(&mix);
+        }
+        for(int lane = 0; lane < RANDOM_LANES; lane++){
+            for(int i = 0; i < 4; i++){
+                stream->blockState[i][lane] = state[i];
+            }
+            xoshiroLongJump(state);
+        }
+        stream->type = type;
+        stream->blockSeeded = 1;
+        stream->blockSeed = seed;
+        stream->block = 0;
+    }
+
+    for(uint64_t distance = block - stream->block, i = 0; distance != 0; distance >>= 1, i++){
+        if(distance & 1){
+            xoshiroApplyJumpLanes(stream->blockState, blockJumps[i]);
+        }
+    }
+    stream->block = block;
+    memcpy(stream->state, stream->blockState, sizeof(stream->state));
+}
+
+/*
+ * Function: randomTypeFromName
+ * ------------------------
+ * Converts a generator name given on the command line into a RandomType.
+ *
+ * @param *name - "xoshiro" or "philox"
+ * @param *type - Set to the matching generator
+ *
+ * @return int of 1 if the name is known, otherwise returns 0
+ */
+int randomTypeFromName(const char *name, RandomType *type){
+    if(strcmp(name, "xoshiro") == 0){
+        *type = RANDOM_XOSHIRO;
+        return 1;
+    }
+    if(strcmp(name, "philox") == 0){
+        *type = RANDOM_PHILOX;
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Function: randomTypeName
+ * ------------------------
+ * @param type - The generator
+ *
+ * @return const char* of the name of the generator
+ */
+const char* randomTypeName(RandomType type){
+    return type == RANDOM_PHILOX ? "philox" : "xoshiro";
+}
@@ -0,0 +1,231 @@
+/* RANDOM.H
+ *
+ * Parallel random number streams used by the worker threads. Two generators are
+ * provided behind the same interface:
+ *   - xoshiro256** : small, very fast generator. Each stream is split into RANDOM_LANES
+ *                    lanes for the vector kernels.
+ *   - Philox4x32-10: counter based generator. Each stream uses its own counter range,
+ *                    so streams can never overlap.
+ *
+ * The engines draw the points of a run from block streams: point k of a run is drawn from
+ * the stream of block k / RANDOM_BLOCK_POINTS, seeded by randomSeedBlock, whichever thread
+ * draws it. A run with the same seed therefore gives the same counts for any number of
+ * threads and any scheduling. The block streams of a seed never overlap, with either
+ * generator: xoshiro256** blocks are jumped 2^64 numbers apart with precomputed jump
+ * polynomials, Philox blocks take their own counter range.
+ *
+ * randomSeed creates provably disjoint xoshiro256** streams with the jump functions,
+ * 2^192 numbers apart and their lanes 2^128 apart. The microbenchmarks and the sequence
+ * shifts draw from them, the engines only use it to initialise the streams they then seed
+ * blocks of.
+ *
+ */
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <stdint.h>
+
+/* Enum: RandomType
+ * The random number generators that a RandomStream can use.
+ */
+typedef enum RandomTypeEnum{
+    RANDOM_XOSHIRO,
+    RANDOM_PHILOX
+}RandomType;
+
+// Number of interleaved xoshiro256** sub-streams held by each stream. Batched kernels
+// advance all lanes together, drawing one point from each lane per batch.
+#define RANDOM_LANES 8
+
+// Number of points drawn from each block stream. Chunks of the scheduler start on a block.
+#define RANDOM_BLOCK_POINTS (1ULL << 16)
+
+/* Structure: RandomStream
+ * Holds the state of one random number stream. Each worker thread owns one stream.
+ *
+ * @variable state       - xoshiro256** state of each lane, stored as state[word][lane] so a
+ *                         vector register can hold the same word of several lanes.
+ *                         Lanes are 2^128 numbers apart when seeded by randomSeed, and
+ *                         2^192 when seeded by randomSeedBlock.
+ * @variable blockState  - xoshiro256** state of each lane at the start of the last block
+ *                         seeded by randomSeedBlock
+ * @variable blockSeed   - Seed of blockState
+ * @variable block       - Block of blockState
+ * @variable blockSeeded - 1 once blockState holds a block, cleared by randomSeed
+ * @variable type        - The generator used by this stream
+ * @variable counter     - Philox counter, words 0-1 are the position, words 2-3 the stream id
+ * @variable key         - Philox key, created from the seed
+ * @variable buffer      - Philox output block not yet handed out
+ * @variable bufferIndex - Number of 64 bit words of the buffer already handed out
+ */
+typedef struct RandomStreamStruct{
+    uint64_t state[4][RANDOM_LANES];
+    uint64_t blockState[4][RANDOM_LANES];
+    uint64_t blockSeed;
+    uint64_t block;
+    int blockSeeded;
+    RandomType type;
+    uint32_t counter[4];
+    uint32_t key[2];
+    uint64_t buffer[2];
+    int bufferIndex;
+}RandomStream;
+
+void randomSeed(RandomStream *stream, RandomType type, uint64_t seed, uint64_t streamId);
+void randomSeedBlock(RandomStream *stream, RandomType type, uint64_t seed, uint64_t block);
+int randomTypeFromName(const char *name, RandomType *type);
+const char* randomTypeName(RandomType type);
+void xoshiroJump(uint64_t state[4]);
+void xoshiroLongJump(uint64_t state[4]);
+void philoxBlock(const uint32_t counter[4], const uint32_t key[2], uint32_t output[4]);
+
+/*
+ * Function: randomBlockRound
+ * ------------------------
+ * @param pointCount - Number of points
+ *
+ * @return uint64_t of pointCount rounded up to a whole number of blocks
+ */
+static inline uint64_t randomBlockRound(uint64_t pointCount){
+    return (pointCount + RANDOM_BLOCK_POINTS - 1) / RANDOM_BLOCK_POINTS * RANDOM_BLOCK_POINTS;
+}
+
+static inline uint64_t rotateLeft(uint64_t x, int k){
+    return (x << k) | (x >> (64 - k));
+}
+
+/*
+ * Function: xoshiroNext
+ * ------------------------
+ * Advances a xoshiro256** state by one step.
+ *
+ * @param state - The four word state to advance
+ *
+ * @return uint64_t of the next random number
+ */
+static inline uint64_t xoshiroNext(uint64_t state[4]){
+    uint64_t result = rotateLeft(state[1] * 5, 7) * 9;
+    uint64_t t = state[1] << 17;
+
+    state[2] ^= state[0];
+    state[3] ^= state[1];
+    state[1] ^= state[2];
+    state[0] ^= state[3];
+    state[2] ^= t;
+    state[3] = rotateLeft(state[3], 45);
+
+    return result;
+}
+
+/*
+ * Function: xoshiroLaneNext
+ * ------------------------
+ * Advances one lane of a stream's xoshiro256** state by one step.
+ *
+ * @param state - The lane interleaved state of a stream
+ * @param lane  - The lane to advance
+ *
+ * @return uint64_t of the next random number of the lane
+ */
+static inline uint64_t xoshiroLaneNext(uint64_t state[4][RANDOM_LANES], int lane){
+    uint64_t s[4] = {state[0][lane], state[1][lane], state[2][lane], state[3][lane]};
+    uint64_t result = xoshiroNext(s);
+
+    state[0][lane] = s[0];
+    state[1][lane] = s[1];
+    state[2][lane] = s[2];
+    state[3][lane] = s[3];
+    return result;
+}
+
+/*
+ * Function: philoxNext
+ * ------------------------
+ * Returns the next 64 bits of a Philox stream. Each block of the generator gives
+ * two 64 bit numbers, after which the counter is incremented.
+ *
+ * @param *stream - The Philox stream to read from
+ *
+ * @return uint64_t of the next random number
+ */
+static inline uint64_t philoxNext(RandomStream *stream){
+    if(stream->bufferIndex == 2){
+        uint32_t block[4];
+        philoxBlock(stream->counter, stream->key, block);
+        stream->buffer[0] = ((uint64_t)block[1] << 32) | block[0];
+        stream->buffer[1] = ((uint64_t)block[3] << 32) | block[2];
+        stream->bufferIndex = 0;
+
+        // 64 bit position held in counter words 0 and 1
+        if(++stream->counter[0] == 0){
+            stream->counter[1]++;
+        }
+    }
+    return stream->buffer[stream->bufferIndex++];
+}
+
+/*
+ * Function: randomNext
+ * ------------------------
+ * Returns the next 64 random bits of a stream, whichever generator it uses.
+ * Single draws from a xoshiro256** stream come from lane 0.
+ *
+ * @param *stream - The stream to read from
+ *
+ * @return uint64_t of the next random number
+ */
+static inline uint64_t randomNext(RandomStream *stream){
+    if(stream->type == RANDOM_PHILOX){
+        return philoxNext(stream);
+    }
+    return xoshiroLaneNext(stream->state, 0);
+}
+
+/*
+ * Function: randomBitsToCoordinate
+ * ------------------------
+ * Converts the top 52 bits of a random number into a double between 0 and 1, a coordinate
+ * of the quadrant of the square that points are drawn from (the circle is symmetric, so
+ * the quadrant holds the same fraction of points inside it as the whole square).
+ * The bits are placed in the mantissa of a double in [1, 2), which avoids an integer
+ * to double conversion and a division, and 1 is subtracted. The vector kernels use the
+ * same conversion so every kernel sees exactly the same coordinates.
+ *
+ * @param bits - 64 random bits
+ *
+ * @return double in the range [0, 1)
+ */
+static inline double randomBitsToCoordinate(uint64_t bits){
+    union { uint64_t i; double d; } value;
+    value.i = (bits >> 12) | 0x3FF0000000000000ULL;
+    return value.d - 1;
+}
+
+/*
+ * Function: randomBitsToCoordinateFloat
+ * ------------------------
+ * Single precision version of randomBitsToCoordinate, from the top 23 of 32 bits.
+ * Every value is a multiple of 2^-23, which a float holds exactly.
+ *
+ * @param bits - 32 random bits
+ *
+ * @return float in the range [0, 1)
+ */
+static inline float randomBitsToCoordinateFloat(uint32_t bits){
+    union { uint32_t i; float f; } value;
+    value.i = (bits >> 9) | 0x3F800000U;
+    return value.f - 1;
+}
+
+/*
+ * Function: randomCoordinate
+ * ------------------------
+ * @param *stream - The stream to read from
+ *
+ * @return double in the range [0, 1) made from the next random number of the stream
+ */
+static inline double randomCoordinate(RandomStream *stream){
+    return randomBitsToCoordinate(randomNext(stream));
+}
+
+#endif //RANDOM_H
@@ -0,0 +1,184 @@
+/* SCHEDULER.C
+ *
+ * Lock free chunk ranges for the work stealing scheduler. See scheduler.h.
+ *
+ */
+#include <stdlib.h>
+#include "scheduler.h"
+
+static inline uint64_t packRange(uint64_t first, uint64_t last){
+    return (last << 32) | first;
+}
+
+static inline uint64_t rangeFirst(uint64_t range){
+    return range & 0xFFFFFFFFULL;
+}
+
+static inline uint64_t rangeLast(uint64_t range){
+    return range >> 32;
+}
+
+/*
+ * Function: schedulerInit
+ * ------------------------
+ * Allocates the queues of a scheduler and sets up its first run.
+ *
+ * @param *scheduler  - The scheduler to initialise
+ * @param pointCount  - Total number of points of the run
+ * @param chunkPoints - Number of points in each chunk, see schedulerReset
+ * @param workerCount - Number of workers
+ *
+ * @return int of 1 on success, 0 if the queues could not be allocated
+ */
+int schedulerInit(Scheduler *scheduler, uint64_t pointCount, uint64_t chunkPoints, int workerCount){
+    scheduler->workerCount = workerCount;
+    scheduler->queues = aligned_alloc(CACHE_LINE_SIZE, sizeof(ChunkQueue) * workerCount);
+    if(scheduler->queues == NULL){
+        return 0;
+    }
+    schedulerReset(scheduler, pointCount, chunkPoints);
+    return 1;
+}
+
+/*
+ * Function: schedulerReset
+ * ------------------------
+ * Splits the points of a new run into chunks and gives each worker an equal, contiguous
+ * range of chunks. Must not be called while workers are taking chunks.
+ *
+ * @param *scheduler  - The scheduler to reset
+ * @param pointCount  - Total number of points of the run
+ * @param chunkPoints - Number of points in each chunk, raised if the run would need more
+ *                      than 2^32 - 1 chunks
+ */
+void schedulerReset(Scheduler *scheduler, uint64_t pointCount, uint64_t chunkPoints){
+    if(chunkPoints == 0){
+        chunkPoints = SCHEDULER_CHUNK_POINTS;
+    }
+    while(pointCount / chunkPoints + (pointCount % chunkPoints != 0) > SCHEDULER_MAX_CHUNKS){
+        chunkPoints *= 2;
+    }
+
+    scheduler->pointCount = pointCount;
+    scheduler->chunkPoints = chunkPoints;
+    scheduler->chunkCount = pointCount / chunkPoints + (pointCount % chunkPoints != 0);
+    atomic_store_explicit(&scheduler->stopped, 0, memory_order_relaxed);
+
+    for(int i = 0; i < scheduler->workerCount; i++){
+        uint64_t first = scheduler->chunkCount * i / scheduler->workerCount;
+        uint64_t last = scheduler->chunkCount * (i + 1) / scheduler->workerCount;
+        atomic_store_explicit(&scheduler->queues[i].range, packRange(first, last), memory_order_relaxed);
+    }
+}
+
+/*
+ * Function: schedulerDestroy
+ * ------------------------
+ * @param *scheduler - The scheduler to free
+ */
+void schedulerDestroy(Scheduler *scheduler){
+    free(scheduler->queues);
+    scheduler->queues = NULL;
+}
+
+/*
+ * Function: schedulerStop
+ * ------------------------
+ * Stops handing out chunks, for runs that end before every point has been calculated.
+ * Chunks already handed out are still finished by their workers.
+ *
+ * @param *scheduler - The scheduler to stop
+ */
+void schedulerStop(Scheduler *scheduler){
+    atomic_store_explicit(&scheduler->stopped, 1, memory_order_relaxed);
+}
+
+/*
+ * Function: takeOwnChunk
+ * ------------------------
+ * Takes the first chunk of a worker's own range.
+ *
+ * @param *queue - The worker's queue
+ * @param *chunk - Set to the index of the chunk taken
+ *
+ * @return int of 1 if a chunk was taken, 0 if the range is empty
+ */
+static int takeOwnChunk(ChunkQueue *queue, uint64_t *chunk){
+    uint64_t range = atomic_load_explicit(&queue->range, memory_order_acquire);
+
+    while(rangeFirst(range) < rangeLast(range)){
+        uint64_t taken = packRange(rangeFirst(range) + 1, rangeLast(range));
+        if(atomic_compare_exchange_weak_explicit(&queue->range, &range, taken,
+                                                 memory_order_acq_rel, memory_order_acquire)){
+            *chunk = rangeFirst(range);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Function: stealChunks
+ * ------------------------
+ * Steals the back half of another worker's range. The first stolen chunk is returned,
+ * the rest become the thief's own range.
+ *
+ * @param *victim - The queue to steal from
+ * @param *thief  - The stealing worker's own queue, which is empty
+ * @param *chunk  - Set to the index of the first chunk stolen
+ *
+ * @return int of 1 if chunks were stolen, 0 if the victim's range is empty
+ */
+static int stealChunks(ChunkQueue *victim, ChunkQueue *thief, uint64_t *chunk){
+    uint64_t range = atomic_load_explicit(&victim->range, memory_order_acquire);
+
+    while(rangeFirst(range) < rangeLast(range)){
+        uint64_t first = rangeFirst(range), last = rangeLast(range);
+        uint64_t middle = last - (last - first + 1) / 2;
+
+        if(atomic_compare_exchange_weak_explicit(&victim->range, &range, packRange(first, middle),
+                                                 memory_order_acq_rel, memory_order_acquire)){
+            // Nobody steals from an empty range, so the thief's queue can simply be replaced
+            atomic_store_explicit(&thief->range, packRange(middle + 1, last), memory_order_release);
+            *chunk = middle;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Function: schedulerNext
+ * ------------------------
+ * Gives a worker its next chunk of points, from its own range or stolen from another
+ * worker's range.
+ *
+ * @param *scheduler  - The scheduler of the run
+ * @param worker      - Index of the calling worker
+ * @param *firstPoint - Set to the index of the first point of the chunk
+ * @param *pointCount - Set to the number of points in the chunk
+ *
+ * @return int of 1 if a chunk was given, 0 once every chunk has been handed out or the
+ *         scheduler has been stopped
+ */
+int schedulerNext(Scheduler *scheduler, int worker, uint64_t *firstPoint, uint64_t *pointCount){
+    if(atomic_load_explicit(&scheduler->stopped, memory_order_relaxed)){
+        return 0;
+    }
+
+    ChunkQueue *own = &scheduler->queues[worker];
+    uint64_t chunk;
+    int found = takeOwnChunk(own, &chunk);
+
+    for(int i = 1; !found && i < scheduler->workerCount; i++){
+        found = stealChunks(&scheduler->queues[(worker + i) % scheduler->workerCount], own, &chunk);
+    }
+    if(!found){
+        return 0;
+    }
+
+    *firstPoint = chunk * scheduler->chunkPoints;
+    *pointCount = scheduler->pointCount - *firstPoint < scheduler->chunkPoints ?
+                  scheduler->pointCount - *firstPoint : scheduler->chunkPoints;
+    return 1;
+}
@@ -0,0 +1,56 @@
+/* SCHEDULER.H
+ *
+ * Work stealing scheduler. The points of a run are split into fixed size chunks and each
+ * worker starts with an equal, contiguous range of chunks. A worker takes chunks from the
+ * front of its own range; once that is empty it steals the back half of another worker's
+ * range, so fast workers take over the work of slow ones.
+ *
+ */
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "topology.h"
+
+// Default number of points in a chunk, about a millisecond of work for one thread
+#define SCHEDULER_CHUNK_POINTS (1ULL << 20)
+// Chunk indices are held in 32 bits, larger runs use larger chunks
+#define SCHEDULER_MAX_CHUNKS 0xFFFFFFFFULL
+
+/* Structure: ChunkQueue
+ * The range of chunks still owned by one worker, on its own cache line.
+ *
+ * @variable range - Index of the first chunk in the low 32 bits, index one past the last
+ *                   chunk in the high 32 bits. Both ends change with a single compare and swap.
+ */
+typedef struct ChunkQueueStruct{
+    _Alignas(CACHE_LINE_SIZE) atomic_uint_fast64_t range;
+}ChunkQueue;
+
+/* Structure: Scheduler
+ * Holds the chunk ranges of every worker of a run.
+ *
+ * @variable pointCount  - Total number of points of the run
+ * @variable chunkPoints - Number of points in each chunk, the last chunk may be smaller
+ * @variable chunkCount  - Number of chunks
+ * @variable workerCount - Number of workers, one queue each
+ * @variable *queues     - The chunk range of each worker
+ * @variable stopped     - Set by schedulerStop, no chunk is handed out once it is set
+ */
+typedef struct SchedulerStruct{
+    uint64_t pointCount;
+    uint64_t chunkPoints;
+    uint64_t chunkCount;
+    int workerCount;
+    ChunkQueue *queues;
+    atomic_int stopped;
+}Scheduler;
+
+int schedulerInit(Scheduler *scheduler, uint64_t pointCount, uint64_t chunkPoints, int workerCount);
+void schedulerReset(Scheduler *scheduler, uint64_t pointCount, uint64_t chunkPoints);
+void schedulerDestroy(Scheduler *scheduler);
+void schedulerStop(Scheduler *scheduler);
+int schedulerNext(Scheduler *scheduler, int worker, uint64_t *firstPoint, uint64_t *pointCount);
+
+#endif //SCHEDULER_H
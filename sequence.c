@@ -0,0 +1,298 @@
+/* SEQUENCE.C
+ *
+ * Randomised low-discrepancy sequences for quasi-Monte Carlo sampling. See sequence.h.
+ *
+ * Coordinates are held as fractions of 2^64, so a shift modulo 1 is a wrapping add and a
+ * digital shift an exclusive or. They are converted to [0, 1) with randomBitsToCoordinate,
+ * as random numbers are, and scaled by the radius.
+ *
+ */
+#include <string.h>
+#include "sequence.h"
+#include "random.h"
+#include "kernel.h"
+
+// 1/g and 1/g^2 as fractions of 2^64, g being the plastic number (x^3 = x + 1)
+#define R2_ALPHA_X 0xC13FA9A902A6328FULL
+#define R2_ALPHA_Y 0x91E10DA5C79E7B1CULL
+// Base 3 digits of a 64 bit index
+#define HALTON_DIGITS 41
+
+static const char *sequenceNames[] = {
+    [SEQUENCE_RANDOM] = "random",
+    [SEQUENCE_R2] = "r2",
+    [SEQUENCE_HALTON] = "halton",
+    [SEQUENCE_SOBOL] = "sobol"
+};
+
+/*
+ * Function: reverseBits
+ * ------------------------
+ * @param x - 64 bits
+ *
+ * @return uint64_t of the bits of x in reverse order, the radical inverse of x in base 2
+ *         as a fraction of 2^64
+ */
+static uint64_t reverseBits(uint64_t x){
+    x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+    x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+    x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    x = ((x >> 8) & 0x00FF00FF00FF00FFULL) | ((x & 0x00FF00FF00FF00FFULL) << 8);
+    x = ((x >> 16) & 0x0000FFFF0000FFFFULL) | ((x & 0x0000FFFF0000FFFFULL) << 16);
+    return (x >> 32) | (x << 32);
+}
+
+/* Structure: RadicalInverse3
+ * Radical inverse in base 3 of an index, updated digit by digit as the index is
+ * incremented, which costs one digit on average instead of a division per digit.
+ *
+ * @variable weights - Weight of each digit, 3^-(k+1) as a fraction of 2^64
+ * @variable digits  - Base 3 digits of the index, least significant first
+ * @variable value   - Radical inverse of the index, as a fraction of 2^64
+ */
+typedef struct RadicalInverse3Struct{
+    uint64_t weights[HALTON_DIGITS];
+    uint8_t digits[HALTON_DIGITS];
+    uint64_t value;
+}RadicalInverse3;
+
+/*
+ * Function: radicalInverse3Init
+ * ------------------------
+ * @param *inverse - Set to the radical inverse of n
+ * @param n        - Index of the point
+ */
+static void radicalInverse3Init(RadicalInverse3 *inverse, uint64_t n){
+    inverse->value = 0;
+    for(int k = 0; k < HALTON_DIGITS; k++){
+        inverse->weights[k] = k == 0 ? UINT64_MAX / 3 : inverse->weights[k - 1] / 3;
+        inverse->digits[k] = (uint8_t)(n % 3);
+        inverse->value += inverse->digits[k] * inverse->weights[k];
+        n /= 3;
+    }
+}
+
+/*
+ * Function: radicalInverse3Next
+ * ------------------------
+ * Moves the radical inverse on to the next index.
+ *
+ * @param *inverse - The radical inverse
+ */
+static void radicalInverse3Next(RadicalInverse3 *inverse){
+    int k = 0;
+    while(k < HALTON_DIGITS - 1 && inverse->digits[k] == 2){
+        inverse->digits[k] = 0;
+        inverse->value -= 2 * inverse->weights[k];
+        k++;
+    }
+    inverse->digits[k]++;
+    inverse->value += inverse->weights[k];
+}
+
+/*
+ * Function: sobolDirections
+ * ------------------------
+ * Fills the direction numbers of the second dimension of the Sobol sequence, from the
+ * primitive polynomial x + 1: m_1 = 1 and m_k = 2 m_(k-1) xor m_(k-1).
+ * The first dimension's are the bits 2^-1, 2^-2, ...
+ *
+ * @param directions - 64 direction numbers, as fractions of 2^64
+ */
+static void sobolDirections(uint64_t directions[64]){
+    directions[0] = 1ULL << 63;
+    for(int bit = 1; bit < 64; bit++){
+        directions[bit] = directions[bit - 1] ^ (directions[bit - 1] >> 1);
+    }
+}
+
+/*
+ * Function: sequenceInit
+ * ------------------------
+ * Randomises a sequence. Engines seeded alike use the same points.
+ *
+ * @param *sequence - The sequence
+ * @param type      - Which sequence to use
+ * @param seed      - Seed the random shift is drawn from
+ */
+void sequenceInit(Sequence *sequence, SequenceType type, uint64_t seed){
+    RandomStream stream;
+
+    randomSeed(&stream, RANDOM_PHILOX, seed, SEQUENCE_STREAM_ID);
+    sequence->type = type;
+    sequence->shift[0] = randomNext(&stream);
+    sequence->shift[1] = randomNext(&stream);
+}
+
+/*
+ * Function: countCirclePointsR2
+ * ------------------------
+ * @param *sequence     - The R2 sequence
+ * @param radius        - Radius of the circle
+ * @param firstIndex    - Index of the first point
+ * @param pointCount    - Number of points
+ * @param *batchCircles - Number of points inside the circle of each batch of RANDOM_LANES
+ *                        points, added to, or NULL
+ *
+ * @return uint64_t of the number of points inside the circle
+ */
+static uint64_t countCirclePointsR2(const Sequence *sequence, double radius, uint64_t firstIndex,
+                                    uint64_t pointCount, uint32_t *batchCircles){
+    const double radiusSquared = radius * radius;
+    uint64_t circlePoints = 0;
+    uint64_t x = sequence->shift[0] + firstIndex * R2_ALPHA_X;
+    uint64_t y = sequence->shift[1] + firstIndex * R2_ALPHA_Y;
+
+    for(uint64_t i = 0; i < pointCount; i++){
+        int inside = isInCircle(radiusSquared, randomBitsToCoordinate(x) * radius, randomBitsToCoordinate(y) * radius);
+        circlePoints += inside;
+        if(batchCircles != NULL){
+            batchCircles[i / RANDOM_LANES] += inside;
+        }
+        x += R2_ALPHA_X;
+        y += R2_ALPHA_Y;
+    }
+    return circlePoints;
+}
+
+/*
+ * Function: countCirclePointsHalton
+ * ------------------------
+ * @param *sequence     - The Halton sequence
+ * @param radius        - Radius of the circle
+ * @param firstIndex    - Index of the first point
+ * @param pointCount    - Number of points
+ * @param *batchCircles - Number of points inside the circle of each batch of RANDOM_LANES
+ *                        points, added to, or NULL
+ *
+ * @return uint64_t of the number of points inside the circle
+ */
+static uint64_t countCirclePointsHalton(const Sequence *sequence, double radius, uint64_t firstIndex,
+                                        uint64_t pointCount, uint32_t *batchCircles){
+    const double radiusSquared = radius * radius;
+    uint64_t circlePoints = 0;
+    RadicalInverse3 inverse;
+
+    radicalInverse3Init(&inverse, firstIndex);
+    for(uint64_t n = firstIndex; n < firstIndex + pointCount; n++){
+        uint64_t x = reverseBits(n) + sequence->shift[0];
+        uint64_t y = inverse.value + sequence->shift[1];
+        int inside = isInCircle(radiusSquared, randomBitsToCoordinate(x) * radius, randomBitsToCoordinate(y) * radius);
+        circlePoints += inside;
+        if(batchCircles != NULL){
+            batchCircles[(n - firstIndex) / RANDOM_LANES] += inside;
+        }
+        radicalInverse3Next(&inverse);
+    }
+    return circlePoints;
+}
+
+/*
+ * Function: countCirclePointsSobol
+ * ------------------------
+ * Point n is the Sobol point of the Gray code of n, so consecutive points differ in one
+ * direction number: the one of the lowest set bit of n.
+ *
+ * @param *sequence     - The Sobol sequence
+ * @param radius        - Radius of the circle
+ * @param firstIndex    - Index of the first point
+ * @param pointCount    - Number of points
+ * @param *batchCircles - Number of points inside the circle of each batch of RANDOM_LANES
+ *                        points, added to, or NULL
+ *
+ * @return uint64_t of the number of points inside the circle
+ */
+static uint64_t countCirclePointsSobol(const Sequence *sequence, double radius, uint64_t firstIndex,
+                                       uint64_t pointCount, uint32_t *batchCircles){
+    const double radiusSquared = radius * radius;
+    uint64_t directions[64];
+    uint64_t circlePoints = 0;
+    uint64_t gray = firstIndex ^ (firstIndex >> 1);
+    uint64_t x = reverseBits(gray) ^ sequence->shift[0];
+    uint64_t y = sequence->shift[1];
+
+    sobolDirections(directions);
+    for(int bit = 0; bit < 64; bit++){
+        if((gray >> bit) & 1){
+            y ^= directions[bit];
+        }
+    }
+
+    for(uint64_t i = 0; i < pointCount; i++){
+        int inside = isInCircle(radiusSquared, randomBitsToCoordinate(x) * radius, randomBitsToCoordinate(y) * radius);
+        circlePoints += inside;
+        if(batchCircles != NULL){
+            batchCircles[i / RANDOM_LANES] += inside;
+        }
+
+        uint64_t next = firstIndex + i + 1;
+        int bit = next != 0 ? __builtin_ctzll(next) : 63;
+        x ^= 1ULL << (63 - bit);
+        y ^= directions[bit];
+    }
+    return circlePoints;
+}
+
+/*
+ * Function: countCirclePointsSequence
+ * ------------------------
+ * Counts how many of the points firstIndex to firstIndex + pointCount - 1 of a sequence
+ * are inside the circle. Workers given disjoint index ranges together count each point
+ * of the run once.
+ *
+ * @param *sequence     - The sequence, not SEQUENCE_RANDOM
+ * @param radius        - Radius of the circle
+ * @param firstIndex    - Index of the first point
+ * @param pointCount    - Number of points
+ * @param *batchCircles - Set to the number of points inside the circle of each batch of
+ *                        RANDOM_LANES points, NULL to only return the total
+ *
+ * @return uint64_t of the number of points inside the circle
+ */
+uint64_t countCirclePointsSequence(const Sequence *sequence, double radius, uint64_t firstIndex,
+                                   uint64_t pointCount, uint32_t *batchCircles){
+    if(batchCircles != NULL){
+        memset(batchCircles, 0, sizeof(uint32_t) * ((pointCount + RANDOM_LANES - 1) / RANDOM_LANES));
+    }
+    switch(sequence->type){
+        case SEQUENCE_R2:
+            return countCirclePointsR2(sequence, radius, firstIndex, pointCount, batchCircles);
+        case SEQUENCE_HALTON:
+            return countCirclePointsHalton(sequence, radius, firstIndex, pointCount, batchCircles);
+        case SEQUENCE_SOBOL:
+            return countCirclePointsSobol(sequence, radius, firstIndex, pointCount, batchCircles);
+        default:
+            return 0;
+    }
+}
+
+/*
+ * Function: sequenceTypeFromName
+ * ------------------------
+ * Converts a sequence name given on the command line into a SequenceType.
+ *
+ * @param *name - "random", "r2", "halton" or "sobol"
+ * @param *type - Set to the matching sequence
+ *
+ * @return int of 1 if the name is known, otherwise returns 0
+ */
+int sequenceTypeFromName(const char *name, SequenceType *type){
+    for(int i = 0; i < (int)(sizeof(sequenceNames) / sizeof(sequenceNames[0])); i++){
+        if(strcmp(name, sequenceNames[i]) == 0){
+            *type = (SequenceType) i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Function: sequenceTypeName
+ * ------------------------
+ * @param type - The sequence
+ *
+ * @return const char* of the name of the sequence
+ */
+const char* sequenceTypeName(SequenceType type){
+    return sequenceNames[type];
+}
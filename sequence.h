@@ -0,0 +1,54 @@
+/* SEQUENCE.H
+ *
+ * Quasi-Monte Carlo sampling. Instead of random points, point n of a run is point n of a
+ * two dimensional low-discrepancy sequence, which covers the square far more evenly:
+ *
+ *   r2     - Additive recurrence on the plastic number, n * (1/g, 1/g^2) mod 1
+ *   halton - Radical inverse of n in bases 2 and 3
+ *   sobol  - Sobol sequence in Gray code order, second dimension from the polynomial x + 1
+ *
+ * Every point is addressed by its index, so the engines hand out ranges of indices in the
+ * same way as ranges of random points and a parallel run uses exactly the points 0..N-1,
+ * whatever the number of threads. Each run is randomised from the engine's seed: r2 and
+ * halton are shifted modulo 1 (Cranley-Patterson rotation), sobol is scrambled with a
+ * random digital shift, which keeps its net structure. The error is then unbiased and
+ * falls at close to O(1/N) for smooth integrands. The circle's edge is not smooth, which
+ * gives about O(N^-3/4) in practice, still far faster than the O(N^-1/2) of random points.
+ *
+ */
+#ifndef SEQUENCE_H
+#define SEQUENCE_H
+
+#include <stdint.h>
+
+/* Enum: SequenceType
+ * Where the points of a run come from. SEQUENCE_RANDOM uses the random number streams.
+ */
+typedef enum SequenceTypeEnum{
+    SEQUENCE_RANDOM,
+    SEQUENCE_R2,
+    SEQUENCE_HALTON,
+    SEQUENCE_SOBOL
+}SequenceType;
+
+// Philox stream the randomisation of a sequence is drawn from, never used by a worker
+#define SEQUENCE_STREAM_ID UINT64_MAX
+
+/* Structure: Sequence
+ * A randomised low-discrepancy sequence, shared read only by every worker thread.
+ *
+ * @variable type  - The sequence
+ * @variable shift - Random shift of each dimension, as a fraction of 2^64
+ */
+typedef struct SequenceStruct{
+    SequenceType type;
+    uint64_t shift[2];
+}Sequence;
+
+void sequenceInit(Sequence *sequence, SequenceType type, uint64_t seed);
+uint64_t countCirclePointsSequence(const Sequence *sequence, double radius, uint64_t firstIndex,
+                                   uint64_t pointCount, uint32_t *batchCircles);
+int sequenceTypeFromName(const char *name, SequenceType *type);
+const char* sequenceTypeName(SequenceType type);
+
+#endif //SEQUENCE_H
@@ -0,0 +1,260 @@
+/* SHARD.C
+ *
+ * Result shard files, binary or JSON. See shard.h.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include "shard.h"
+#include "random.h"
+#include "estimator.h"
+#include "sequence.h"
+#include "kernel.h"
+
+// Format of a JSON shard, in place of SHARD_MAGIC
+#define SHARD_JSON_FORMAT "mcshard"
+// Longest JSON shard read, far more than one written by shardWrite
+#define SHARD_JSON_MAX_BYTES 4096
+
+/*
+ * Function: isJsonPath
+ * ------------------------
+ * @param *path - Path of a shard file
+ *
+ * @return int of 1 if the name ends in .json, otherwise returns 0
+ */
+static int isJsonPath(const char *path){
+    size_t length = strlen(path);
+    return length >= 5 && strcmp(path + length - 5, ".json") == 0;
+}
+
+/*
+ * Function: shardValid
+ * ------------------------
+ * @param *shard - A shard that has been read
+ *
+ * @return int of 1 if the shard is of this format and version and every field holds a
+ *         value a run can write, otherwise returns 0
+ */
+static int shardValid(const Shard *shard){
+    return shard->magic == SHARD_MAGIC && shard->version == SHARD_VERSION && shard->pointCount > 0 &&
+           shard->firstPoint % RANDOM_BLOCK_POINTS == 0 && shard->firstPoint + shard->pointCount > shard->firstPoint &&
+           shard->randomType <= RANDOM_PHILOX && shard->estimatorType <= ESTIMATOR_MEAN &&
+           shard->sequence <= SEQUENCE_SOBOL && shard->precision >= PRECISION_DOUBLE &&
+           shard->precision <= PRECISION_FLOAT && shard->fixedPoint <= 1;
+}
+
+/*
+ * Function: writeJson
+ * ------------------------
+ * @param *shard - The shard
+ * @param *file  - The open shard file
+ *
+ * @return int of 1 if the shard was written, otherwise returns 0
+ */
+static int writeJson(const Shard *shard, FILE *file){
+    return fprintf(file, "{\"format\": \"%s\", \"version\": %" PRIu64 ", \"seed\": %" PRIu64 ", "
+                         "\"first_point\": %" PRIu64 ", \"points\": %" PRIu64 ", \"score\": %" PRIu64 ", "
+                         "\"radius\": %.17g, \"generator\": \"%s\", \"estimator\": \"%s\", \"sequence\": \"%s\", "
+                         "\"precision\": \"%s\", \"fixed_point\": %" PRIu64 ", \"seconds\": %.9f}\n",
+                   SHARD_JSON_FORMAT, shard->version, shard->seed, shard->firstPoint, shard->pointCount,
+                   shard->score, shard->radius, randomTypeName((RandomType) shard->randomType),
+                   estimatorTypeName((EstimatorType) shard->estimatorType),
+                   sequenceTypeName((SequenceType) shard->sequence), precisionName((Precision) shard->precision),
+                   shard->fixedPoint, shard->seconds) > 0;
+}
+
+/*
+ * Function: jsonValue
+ * ------------------------
+ * Finds the value of a member of a JSON object. Only the flat objects written by
+ * writeJson are read, so no nesting or escapes are handled.
+ *
+ * @param *text - The JSON object
+ * @param *name - Name of the member
+ *
+ * @return const char* of the first character of the value, or NULL if there is no such member
+ */
+static const char* jsonValue(const char *text, const char *name){
+    size_t length = strlen(name);
+
+    for(const char *key = strchr(text, '"'); key != NULL; key = strchr(key + 1, '"')){
+        if(strncmp(key + 1, name, length) != 0 || key[length + 1] != '"'){
+            continue;
+        }
+        const char *value = key + length + 2;
+        value += strspn(value, " \t\r\n");
+        if(*value != ':'){
+            continue;
+        }
+        value++;
+        return value + strspn(value, " \t\r\n");
+    }
+    return NULL;
+}
+
+/*
+ * Function: jsonInteger
+ * ------------------------
+ * @param *text  - The JSON object
+ * @param *name  - Name of the member
+ * @param *value - Set to the value of the member
+ *
+ * @return int of 1 if the member is a whole number that fits in 64 bits, otherwise returns 0
+ */
+static int jsonInteger(const char *text, const char *name, uint64_t *value){
+    const char *start = jsonValue(text, name);
+    char *end;
+
+    if(start == NULL || *start < '0' || *start > '9'){
+        return 0;
+    }
+    errno = 0;
+    *value = strtoull(start, &end, 10);
+    return errno == 0 && end != start;
+}
+
+/*
+ * Function: jsonDouble
+ * ------------------------
+ * @param *text  - The JSON object
+ * @param *name  - Name of the member
+ * @param *value - Set to the value of the member
+ *
+ * @return int of 1 if the member is a number, otherwise returns 0
+ */
+static int jsonDouble(const char *text, const char *name, double *value){
+    const char *start = jsonValue(text, name);
+    char *end;
+
+    if(start == NULL){
+        return 0;
+    }
+    *value = strtod(start, &end);
+    return end != start;
+}
+
+/*
+ * Function: jsonString
+ * ------------------------
+ * @param *text  - The JSON object
+ * @param *name  - Name of the member
+ * @param *value - Set to the string, without its quotes
+ * @param size   - Size of value
+ *
+ * @return int of 1 if the member is a string shorter than size, otherwise returns 0
+ */
+static int jsonString(const char *text, const char *name, char *value, size_t size){
+    const char *start = jsonValue(text, name);
+    const char *end;
+
+    if(start == NULL || *start != '"' || (end = strchr(start + 1, '"')) == NULL ||
+       (size_t)(end - start - 1) >= size){
+        return 0;
+    }
+    memcpy(value, start + 1, end - start - 1);
+    value[end - start - 1] = '\0';
+    return 1;
+}
+
+/*
+ * Function: readJson
+ * ------------------------
+ * @param *shard - Set to the shard read
+ * @param *file  - The open shard file
+ *
+ * @return int of 1 if every member of a shard was read, otherwise returns 0
+ */
+static int readJson(Shard *shard, FILE *file){
+    char text[SHARD_JSON_MAX_BYTES + 1];
+    char format[16], generator[16], estimator[16], sequence[16], precision[16];
+    RandomType randomType;
+    EstimatorType estimatorType;
+    SequenceType sequenceType;
+    Precision precisionType;
+
+    size_t length = fread(text, 1, SHARD_JSON_MAX_BYTES, file);
+    text[length] = '\0';
+    if(!jsonString(text, "format", format, sizeof(format)) || strcmp(format, SHARD_JSON_FORMAT) != 0 ||
+       !jsonInteger(text, "version", &shard->version) || !jsonInteger(text, "seed", &shard->seed) ||
+       !jsonInteger(text, "first_point", &shard->firstPoint) || !jsonInteger(text, "points", &shard->pointCount) ||
+       !jsonInteger(text, "score", &shard->score) || !jsonDouble(text, "radius", &shard->radius) ||
+       !jsonString(text, "generator", generator, sizeof(generator)) || !randomTypeFromName(generator, &randomType) ||
+       !jsonString(text, "estimator", estimator, sizeof(estimator)) ||
+       !estimatorTypeFromName(estimator, &estimatorType) ||
+       !jsonString(text, "sequence", sequence, sizeof(sequence)) || !sequenceTypeFromName(sequence, &sequenceType) ||
+       !jsonString(text, "precision", precision, sizeof(precision)) ||
+       !precisionFromName(precision, &precisionType) || !jsonInteger(text, "fixed_point", &shard->fixedPoint) ||
+       !jsonDouble(text, "seconds", &shard->seconds)){
+        return 0;
+    }
+    shard->magic = SHARD_MAGIC;
+    shard->randomType = randomType;
+    shard->estimatorType = estimatorType;
+    shard->sequence = sequenceType;
+    shard->precision = precisionType;
+    return 1;
+}
+
+/*
+ * Function: shardWrite
+ * ------------------------
+ * Writes a shard file, as JSON if the name ends in .json and otherwise in binary.
+ *
+ * @param *shard - The shard, magic and version are written as SHARD_MAGIC and SHARD_VERSION
+ * @param *path  - Path of the shard file
+ *
+ * @return int of 1 if the file was written, otherwise returns 0
+ */
+int shardWrite(const Shard *shard, const char *path){
+    Shard written = *shard;
+    written.magic = SHARD_MAGIC;
+    written.version = SHARD_VERSION;
+
+    FILE *file = fopen(path, isJsonPath(path) ? "w" : "wb");
+    if(file == NULL){
+        return 0;
+    }
+    int done = isJsonPath(path) ? writeJson(&written, file) : fwrite(&written, sizeof(written), 1, file) == 1;
+    return fclose(file) == 0 && done;
+}
+
+/*
+ * Function: shardRead
+ * ------------------------
+ * Reads a shard file in either format, whatever its name.
+ *
+ * @param *shard - Set to the shard read
+ * @param *path  - Path of the shard file
+ *
+ * @return int of 1 if the file is a valid shard of this version, otherwise returns 0
+ */
+int shardRead(Shard *shard, const char *path){
+    FILE *file = fopen(path, "rb");
+    if(file == NULL){
+        return 0;
+    }
+    int first = fgetc(file);
+    rewind(file);
+    int read = first == '{' ? readJson(shard, file) : fread(shard, sizeof(*shard), 1, file) == 1;
+    fclose(file);
+    return read && shardValid(shard);
+}
+
+/*
+ * Function: shardSameRun
+ * ------------------------
+ * @param *a - A shard
+ * @param *b - Another shard
+ *
+ * @return int of 1 if the shards are ranges of the same estimation and can be merged,
+ *         otherwise returns 0
+ */
+int shardSameRun(const Shard *a, const Shard *b){
+    return a->seed == b->seed && a->radius == b->radius && a->randomType == b->randomType &&
+           a->estimatorType == b->estimatorType && a->sequence == b->sequence && a->precision == b->precision &&
+           a->fixedPoint == b->fixedPoint;
+}
@@ -0,0 +1,65 @@
+/* SHARD.H
+ *
+ * Result shards. A single run of a fixed number of points can write its exact result, the
+ * range of the block streams of random.h it drew and how long it took, to a shard file.
+ * Runs of disjoint ranges with the same seed, on any number of processes or machines, are
+ * merged into one estimate by adding their points and scores, see shardmerge.c.
+ *
+ * A shard is written in one of two formats, picked by the name of the file:
+ *
+ *   name.json - One JSON object with the fields of Shard, names in snake case and the
+ *               generator, estimator, sequence and precision by name
+ *   otherwise - The Shard structure as it is in memory, in native byte order
+ *
+ * Both start with the format and its version, and shardRead reads either.
+ *
+ */
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <stdint.h>
+
+// "MCSHARD" and a version number, at the start of every shard
+#define SHARD_MAGIC 0x4452414853434DULL
+#define SHARD_VERSION 3
+
+/* Structure: Shard
+ * Result of one run. The fields from seed to fixedPoint, except the range and its score,
+ * identify the estimation; only shards that match in them are merged.
+ *
+ * @variable magic         - SHARD_MAGIC
+ * @variable version       - SHARD_VERSION
+ * @variable seed          - Seed of the run
+ * @variable firstPoint    - Index of the first point drawn, a multiple of RANDOM_BLOCK_POINTS
+ * @variable pointCount    - Number of points drawn
+ * @variable score         - Score of the points, the number inside the circle with the hit
+ *                           estimator, see estimatorSample
+ * @variable radius        - Radius of the circle
+ * @variable randomType    - Random number generator, a RandomType
+ * @variable estimatorType - Estimator of the area, an EstimatorType
+ * @variable sequence      - Sequence the points come from, a SequenceType
+ * @variable precision     - Precision of the sampling kernel, a Precision
+ * @variable fixedPoint    - 1 if the fixed point kernel drew the points, otherwise 0
+ * @variable seconds       - Time the run took, in seconds
+ */
+typedef struct ShardStruct{
+    uint64_t magic;
+    uint64_t version;
+    uint64_t seed;
+    uint64_t firstPoint;
+    uint64_t pointCount;
+    uint64_t score;
+    double radius;
+    uint64_t randomType;
+    uint64_t estimatorType;
+    uint64_t sequence;
+    uint64_t precision;
+    uint64_t fixedPoint;
+    double seconds;
+}Shard;
+
+int shardWrite(const Shard *shard, const char *path);
+int shardRead(Shard *shard, const char *path);
+int shardSameRun(const Shard *a, const Shard *b);
+
+#endif //SHARD_H
@@ -0,0 +1,162 @@
+/* SHARDMERGE.C
+ *
+ * Offline merge of result shards. Reads any number of shards written with --shard, checks
+ * they are ranges of the same estimation that do not overlap, and prints the estimate of
+ * all their points. See shard.h.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <getopt.h>
+#include "shard.h"
+#include "random.h"
+#include "estimator.h"
+#include "sequence.h"
+#include "kernel.h"
+
+static const struct option longOptions[] = {
+    {"output", required_argument, NULL, 'o'},
+    {NULL, 0, NULL, 0}
+};
+
+/* Structure: ShardFile
+ * A shard and the file it was read from.
+ *
+ * @variable shard - The shard
+ * @variable *path - Path of its file
+ */
+typedef struct ShardFileStruct{
+    Shard shard;
+    const char *path;
+}ShardFile;
+
+/*
+ * Function: compareFirstPoint
+ * ------------------------
+ * Orders shard files by the first point of their range, for qsort.
+ *
+ * @param *a - A ShardFile
+ * @param *b - Another ShardFile
+ *
+ * @return int of -1, 0 or 1 as the range of a starts before, with or after that of b
+ */
+static int compareFirstPoint(const void *a, const void *b){
+    uint64_t first = ((const ShardFile*) a)->shard.firstPoint, second = ((const ShardFile*) b)->shard.firstPoint;
+    return (first > second) - (first < second);
+}
+
+/*
+ * Function: main
+ * ------------------------
+ * Merges shards into one estimate of the area of the circle. The points and scores of the
+ * shards are added, so the estimate is that of a run of all their points. If the ranges
+ * are contiguous it is exactly the run of that range, and its Result can be extended with
+ * --extend.
+ *
+ * @param argc - Number of command line arguments provided
+ * @param *argv[] - array of pointers to the command line arguments
+ *        argv[0] - The name of the this executable file.
+ *        argv[1...n]:
+ *          [-o, --output] file the merged shard is written to, JSON if it ends in .json.
+ *                         Only if the ranges are contiguous.
+ *          shard files    the shards to merge, binary or JSON, in any order
+ *
+ * @return int of how program exits
+ */
+int main(int argc, char *argv[]){
+    const char *outputPath = NULL;
+    int c;
+
+    while((c = getopt_long(argc, argv, "o:", longOptions, NULL)) != -1){
+        switch(c){
+            case 'o': // Merged shard
+                outputPath = optarg;
+                break;
+            default:
+                return EXIT_FAILURE;
+        }
+    }
+    int shardCount = argc - optind;
+    if(shardCount < 1){
+        fprintf(stderr, "Usage: %s [--output merged.json] shard...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    ShardFile *files = malloc(sizeof(ShardFile) * shardCount);
+    if(files == NULL){
+        perror("Error allocating shards: ");
+        return EXIT_FAILURE;
+    }
+    for(int i = 0; i < shardCount; i++){
+        files[i].path = argv[optind + i];
+        if(!shardRead(&files[i].shard, files[i].path)){
+            fprintf(stderr, "Cannot read shard %s: it is unreadable or not a shard of this version\n", files[i].path);
+            free(files);
+            return EXIT_FAILURE;
+        }
+        if(!shardSameRun(&files[i].shard, &files[0].shard)){
+            fprintf(stderr, "Shards %s and %s are of different runs: the seed, radius, generator, estimator, "
+                            "sequence or kernel precision differ\n", files[0].path, files[i].path);
+            free(files);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Sorted by first point, a range overlaps another only if it overlaps the next one
+    qsort(files, shardCount, sizeof(ShardFile), compareFirstPoint);
+    Shard merged = files[0].shard;
+    double longestSeconds = files[0].shard.seconds;
+    int contiguous = 1;
+    for(int i = 1; i < shardCount; i++){
+        const Shard *previous = &files[i - 1].shard, *shard = &files[i].shard;
+        if(previous->firstPoint + previous->pointCount > shard->firstPoint){
+            fprintf(stderr, "Shards %s and %s overlap: points %" PRIu64 " to %" PRIu64 " and %" PRIu64 " to %" PRIu64 "\n",
+                    files[i - 1].path, files[i].path, previous->firstPoint,
+                    previous->firstPoint + previous->pointCount - 1, shard->firstPoint,
+                    shard->firstPoint + shard->pointCount - 1);
+            free(files);
+            return EXIT_FAILURE;
+        }
+        contiguous = contiguous && previous->firstPoint + previous->pointCount == shard->firstPoint;
+        merged.pointCount += shard->pointCount;
+        merged.score += shard->score;
+        merged.seconds += shard->seconds;
+        longestSeconds = shard->seconds > longestSeconds ? shard->seconds : longestSeconds;
+    }
+    if(merged.pointCount > estimatorMaxPoints((EstimatorType) merged.estimatorType)){
+        fprintf(stderr, "The shards hold more points than the %s estimator can add up: %" PRIu64 "\n",
+                estimatorTypeName((EstimatorType) merged.estimatorType), merged.pointCount);
+        free(files);
+        return EXIT_FAILURE;
+    }
+
+    if(outputPath != NULL && !contiguous){
+        fprintf(stderr, "Cannot write %s: the ranges of the shards are not contiguous\n", outputPath);
+        free(files);
+        return EXIT_FAILURE;
+    }
+
+    printf("Number of Shards = %d, Number of Points = %" PRIu64 ", Circle Radius = %f, Seed = %" PRIu64 "\n",
+           shardCount, merged.pointCount, merged.radius, merged.seed);
+    printf("Random Number Generator = %s, Estimator = %s, Sequence = %s, Precision = %s%s\n",
+           randomTypeName((RandomType) merged.randomType), estimatorTypeName((EstimatorType) merged.estimatorType),
+           sequenceTypeName((SequenceType) merged.sequence), precisionName((Precision) merged.precision),
+           merged.fixedPoint ? ", Sampling Kernel = fixed" : "");
+    printf("The Area of the circle is: %f\n", estimatorArea((EstimatorType) merged.estimatorType, merged.score,
+                                                            merged.pointCount, merged.radius));
+    printf("Total Time = %f seconds, Longest Shard = %f seconds\n", merged.seconds, longestSeconds);
+    if(contiguous){
+        printf("Result = %" PRIu64 ":%" PRIu64 ":%" PRIu64 ":%" PRIu64 "\n", merged.seed, merged.firstPoint,
+               merged.pointCount, merged.score);
+    }
+    free(files);
+
+    if(outputPath != NULL && !shardWrite(&merged, outputPath)){
+        perror("Error writing shard");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
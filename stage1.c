@@ -4,85 +4,341 @@
  * Date: 12/11/2020
  * Last Modified: 12/11/2020
  *
+ * The serial engine: every point is calculated by the calling thread.
+ *
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include "engine.h"
+#include "kernel.h"
+#include "scheduler.h"
+#include "progress.h"
+#include "stats.h"
+#include "perf.h"
+
+/* Structure: Estimator
+ * Reusable estimation context of the serial engine. Each estimation continues the
+ * random number stream, or the sequence, of the previous one.
+ *
+ * @variable random        - The random number stream, seeded for each block of points
+ * @variable seed          - Seed of the run
+ * @variable estimatorType - Estimator of the area from the stream, see estimator.h
+ * @variable sequence      - Low-discrepancy sequence used instead of the stream, see sequence.h
+ * @variable pointIndex    - Index of the next point, in the block streams, the sequence or
+ *                           the strata
+ * @variable checkpoint    - Checkpoint of the next estimation, NULL once it has run or if none
+ * @variable instrument    - INSTRUMENT_ flags of what is recorded in stats, 0 for nothing
+ * @variable stats         - Instrumentation of the calling thread, as worker 0
+ * @variable perf          - Hardware counters of the calling thread, with INSTRUMENT_COUNTERS
+ */
+typedef struct EstimatorStruct{
+    RandomStream random;
+    uint64_t seed;
+    EstimatorType estimatorType;
+    Sequence sequence;
+    uint64_t pointIndex;
+    Checkpoint *checkpoint;
+    int instrument;
+    EngineStats stats;
+    PerfCounters perf;
+}Estimator;
+
+/*
+ * Function: countersStart
+ * ------------------------
+ * Starts the hardware counters of an estimation, with INSTRUMENT_COUNTERS.
+ *
+ * @param *estimator - The estimator
+ */
+static void countersStart(Estimator *estimator){
+    if(estimator->instrument & INSTRUMENT_COUNTERS){
+        perfStart(&estimator->perf);
+    }
+}
+
+/*
+ * Function: countersStop
+ * ------------------------
+ * Adds the hardware counts of an estimation to the instrumentation, with INSTRUMENT_COUNTERS.
+ *
+ * @param *estimator - The estimator
+ */
+static void countersStop(Estimator *estimator){
+    if(estimator->instrument & INSTRUMENT_COUNTERS){
+        WorkerStats *stats = &estimator->stats.workers[0];
+        perfStop(&estimator->perf, stats->counters, &stats->countersRead, &stats->countersScaled);
+    }
+}
 
 /*
- * Function: isInCircle
+ * Function: drawPoints
  * ------------------------
- * Calculates whether the coordinate ( x , y ) is within the bounds of the circle with
- * the radius provided.
- * Uses Pythagoras' Theorem: a^2 + b^2 = c^2 to calculate length of point to the
- * center of the circle. Returns boolean c^2 < r^2 where r is the radius of the circle
+ * Draws the next points from the block streams, or from the sequence.
  *
- * @param radius - Radius of the circle to check.
- * @param x      - The x coordinate of the point to check is in the circle
- * @param y      - The y coordinate of the point to check is in the circle
+ * @param *estimator - The estimator
+ * @param radius     - Radius of the circle
+ * @param pointCount - Number of points to draw
  *
- * @return int of 1 if coordinate (x,y) is within the circle, otherwise returns 0
+ * @return uint64_t of the score of the points, the number inside the circle with a hit or
+ *         miss estimator
  */
-int isInCircle(double radius, double x, double y){
-    return (x*x) + (y*y) < (radius*radius);
+static uint64_t drawPoints(Estimator *estimator, double radius, uint64_t pointCount){
+    uint64_t circlePoints;
+    if(estimator->sequence.type == SEQUENCE_RANDOM){
+        circlePoints = estimatorSampleRange(estimator->estimatorType, &estimator->random, estimator->seed, radius,
+                                            estimator->pointIndex, pointCount, NULL);
+    } else {
+        circlePoints = countCirclePointsSequence(&estimator->sequence, radius, estimator->pointIndex, pointCount,
+                                                 NULL);
+    }
+    estimator->pointIndex += pointCount;
+    return circlePoints;
 }
 
 /*
- * Function: calculateCircleArea
+ * Function: sampleChunk
+ * ------------------------
+ * Draws one chunk of points, timing it when the estimator is instrumented.
+ *
+ * @param *estimator - The estimator
+ * @param radius     - Radius of the circle
+ * @param pointCount - Number of points to draw
+ *
+ * @return uint64_t of the number of points inside the circle
+ */
+static uint64_t sampleChunk(Estimator *estimator, double radius, uint64_t pointCount){
+    if(!estimator->instrument){
+        return drawPoints(estimator, radius, pointCount);
+    }
+
+    WorkerStats *stats = &estimator->stats.workers[0];
+    double start = monotonicSeconds();
+    uint64_t circlePoints = drawPoints(estimator, radius, pointCount);
+    stats->samplingSeconds += monotonicSeconds() - start;
+    stats->chunks++;
+    stats->points += pointCount;
+    return circlePoints;
+}
+
+/*
+ * Function: sampleCheckpointed
+ * ------------------------
+ * Draws the points of a run in the chunks the scheduler of the threaded engines would hand
+ * out, skipping the chunks restored from the checkpoint and reporting the others to it.
+ *
+ * @param *estimator - The estimator, with a checkpoint
+ * @param radius     - Radius of the circle
+ * @param pointCount - Number of points of the run
+ *
+ * @return uint64_t of the score of every point of the run, restored or drawn
+ */
+static uint64_t sampleCheckpointed(Estimator *estimator, double radius, uint64_t pointCount){
+    Checkpoint *checkpoint = estimator->checkpoint;
+    uint64_t firstIndex = estimator->pointIndex;
+    uint64_t firstPoint, chunkPoints;
+    Scheduler scheduler;
+
+    if(!schedulerInit(&scheduler, pointCount, SCHEDULER_CHUNK_POINTS, 1)){
+        perror("Error creating Scheduler: ");
+        exit(EXIT_FAILURE);
+    }
+    if(!checkpointStart(checkpoint, scheduler.chunkPoints)){
+        fprintf(stderr, "Error restoring checkpoint: it does not match the chunks of the run\n");
+        exit(EXIT_FAILURE);
+    }
+
+    uint64_t circlePoints = checkpoint->restoredScore;
+    while(schedulerNext(&scheduler, 0, &firstPoint, &chunkPoints)){
+        uint64_t chunk = firstPoint / scheduler.chunkPoints;
+        if(checkpointRestored(checkpoint, chunk)){
+            continue;
+        }
+        estimator->pointIndex = firstIndex + firstPoint;
+        uint64_t chunkCirclePoints = sampleChunk(estimator, radius, chunkPoints);
+        checkpointReport(checkpoint, chunk, chunkPoints, chunkCirclePoints);
+        circlePoints += chunkCirclePoints;
+    }
+    estimator->pointIndex = firstIndex + pointCount;
+
+    checkpointFinish(checkpoint);
+    schedulerDestroy(&scheduler);
+    return circlePoints;
+}
+
+/*
+ * Function: estimatorCreate
+ * ------------------------
+ * Allocates an estimator and seeds its random number stream and sequence.
+ *
+ * @param *options - Settings of the engine, only the random number generator, seed,
+ *                   estimator, sequence, checkpoint and instrumentation are used
+ *
+ * @return void* of the estimator, or NULL if it could not be allocated
+ */
+static void* estimatorCreate(const EngineOptions *options){
+    Estimator *estimator = malloc(sizeof(Estimator));
+    if(estimator == NULL){
+        return NULL;
+    }
+    estimator->instrument = options->instrument;
+    if(estimator->instrument && !statsCreate(&estimator->stats, 1)){
+        free(estimator);
+        return NULL;
+    }
+    if(estimator->instrument & INSTRUMENT_COUNTERS){
+        perfOpen(&estimator->perf);
+    }
+    estimator->seed = options->seed;
+    randomSeed(&estimator->random, options->randomType, estimator->seed, 0);
+    estimator->estimatorType = options->estimatorType;
+    sequenceInit(&estimator->sequence, options->sequence, estimator->seed);
+    estimator->pointIndex = 0;
+    estimator->checkpoint = options->checkpoint;
+    return estimator;
+}
+
+/*
+ * Function: estimatorRunRange
+ * ------------------------
+ * Iterates through a range of random coordinates, counting how many are within the bounds
+ * of a circle. With a checkpoint the points are drawn in chunks, see sampleCheckpointed.
+ * The next estimation is not moved.
+ *
+ * @param *e         - void pointer to the estimator
+ * @param firstPoint - Index of the first point to draw, a multiple of RANDOM_BLOCK_POINTS
+ * @param pointCount - Number of points to draw
+ * @param radius     - Radius of the circle to calculate the area of.
+ *
+ * @return uint64_t of the score of the points, see estimatorSample
+ */
+static uint64_t estimatorRunRange(void *e, uint64_t firstPoint, uint64_t pointCount, double radius){
+    Estimator *estimator = (Estimator*) e;
+    uint64_t nextIndex = estimator->pointIndex;
+
+    estimator->pointIndex = firstPoint;
+    countersStart(estimator);
+    uint64_t circlePoints;
+    if(estimator->checkpoint != NULL){
+        circlePoints = sampleCheckpointed(estimator, radius, pointCount);
+        estimator->checkpoint = NULL;
+    } else {
+        circlePoints = sampleChunk(estimator, radius, pointCount);
+    }
+    countersStop(estimator);
+    estimator->pointIndex = nextIndex;
+
+    return circlePoints;
+}
+
+/*
+ * Function: estimatorRun
  * ------------------------
  * Iterates through a large number of random coordinates, counting how many are within the
  * bounds of a circle. It then calculates a rough estimate for the area of the circle.
  *
- * @param radius     - Radius of the circle to calculate the area of.
+ * @param *e         - void pointer to the estimator
  * @param pointCount - Number of random coordinates to iterate through. The greater the
  *                     pointCount, the more accurate the area calculation will be.
+ * @param radius     - Radius of the circle to calculate the area of.
  *
  * @return double of the calculated area of the circle
  */
-double calculateCircleArea(double radius, int pointCount){
-    int circlePoints = 0;
+static double estimatorRun(void *e, uint64_t pointCount, double radius){
+    Estimator *estimator = (Estimator*) e;
 
-    for(int i = 0; i < pointCount; i++){
-        double x = ((double)rand()*2 / (double)RAND_MAX) - 1; // Random double between -1 and 1
-        double y = ((double)rand()*2 / (double)RAND_MAX) - 1; // Random double between -1 and 1
-
-        if(isInCircle(radius, x, y)){
-            circlePoints++;
-        }
-    }
+    uint64_t circlePoints = estimatorRunRange(estimator, estimator->pointIndex, pointCount, radius);
+    estimator->pointIndex = randomBlockRound(estimator->pointIndex + pointCount); // The next run starts on a block
 
     // Returns the area of the circle calculated by:
     // percentage of points in circle * area of the circle's smallest enclosing square
-    return ((double)circlePoints/(double)pointCount)*4*radius*radius;
+    return estimatorArea(estimator->estimatorType, circlePoints, pointCount, radius);
 }
+
 /*
- * Function: main
+ * Function: estimatorRunAdaptive
  * ------------------------
- * Iterates through a large number of random coordinates, counting how many are within the
- * bounds of a circle. It then calculates a rough estimate for the area of the circle.
+ * Draws chunks of PROGRESS_CHUNK_POINTS points until the 95% confidence interval of the
+ * area is narrower than the tolerance, the time limit has passed or the point limit is
+ * reached.
  *
- * @param argc - Number of command line arguments provided
- * @param *argv[] - array of pointers to the command line arguments
- *        argv[0] - The name of the this executable file.
- *        argv[1] - [Optional] number of points to iterate through
- *        argv[2] - [Optional] radius of the circle to calculate
+ * @param *e          - void pointer to the estimator
+ * @param tolerance   - Half width of the confidence interval at which to stop, 0 for none
+ * @param timeLimit   - Seconds after which to stop, 0 for no limit
+ * @param pointLimit  - Most points to draw if neither is reached first, 0 for no limit.
+ *                      Capped at estimatorMaxPoints of the estimator
+ * @param radius      - Radius of the circle to calculate the area of.
+ * @param *pointsUsed - Set to the number of points drawn
+ * @param *error      - Set to the half width of the confidence interval reached
  *
- * @return int of how program exits
+ * @return double of the calculated area of the circle
  */
-int main(int argc, char *argv[]) {
-    // Default Values, used if not arguments provided
-    int pointCount = 100000;
-    double radius = 1.0;
-
-    // Retrieving Arguments
-    switch(argc){
-        case 3:
-            radius = atof(argv[2]);
-        case 2:
-            pointCount = atoi(argv[1]);
-        default:
-            printf("Number of Points = %d, Circle Radius = %f\n", pointCount, radius);
-    }
-
-    printf("The Area of the circle is: %f\n", calculateCircleArea(radius, pointCount));
-    return EXIT_SUCCESS;
+static double estimatorRunAdaptive(void *e, double tolerance, double timeLimit, uint64_t pointLimit,
+                                   double radius, uint64_t *pointsUsed, double *error){
+    Estimator *estimator = (Estimator*) e;
+    Progress progress;
+    uint64_t pointCount = 0;
+    int done = 0;
+
+    if(pointLimit == 0){
+        pointLimit = PROGRESS_CHUNK_POINTS * SCHEDULER_MAX_CHUNKS;
+    }
+    if(pointLimit > estimatorMaxPoints(estimator->estimatorType)){
+        pointLimit = estimatorMaxPoints(estimator->estimatorType);
+    }
+
+    progressInit(&progress, radius, estimatorUnit(estimator->estimatorType), tolerance, timeLimit);
+    countersStart(estimator);
+    while(!done && pointCount < pointLimit){
+        uint64_t chunkPoints = pointLimit - pointCount < PROGRESS_CHUNK_POINTS ?
+                               pointLimit - pointCount : PROGRESS_CHUNK_POINTS;
+        uint64_t chunkCirclePoints = sampleChunk(estimator, radius, chunkPoints);
+        pointCount += chunkPoints;
+        done = progressReport(&progress, chunkPoints, chunkCirclePoints);
+    }
+    countersStop(estimator);
+    estimator->pointIndex = randomBlockRound(estimator->pointIndex);
+
+    double area = progressArea(&progress);
+    *pointsUsed = progress.pointCount;
+    *error = progressError(&progress);
+    progressDestroy(&progress);
+
+    return area;
 }
+
+/*
+ * Function: estimatorDestroy
+ * ------------------------
+ * @param *e - void pointer to the estimator to free
+ */
+static void estimatorDestroy(void *e){
+    Estimator *estimator = (Estimator*) e;
+    if(estimator->instrument & INSTRUMENT_COUNTERS){
+        perfClose(&estimator->perf);
+    }
+    if(estimator->instrument){
+        statsDestroy(&estimator->stats);
+    }
+    free(estimator);
+}
+
+/*
+ * Function: estimatorStats
+ * ------------------------
+ * @param *e - void pointer to the estimator
+ *
+ * @return const EngineStats* of the instrumentation, NULL if not instrumented
+ */
+static const EngineStats* estimatorStats(void *e){
+    Estimator *estimator = (Estimator*) e;
+    return estimator->instrument ? &estimator->stats : NULL;
+}
+
+const EngineOps serialEngine = {
+    .create = estimatorCreate,
+    .run = estimatorRun,
+    .runRange = estimatorRunRange,
+    .runAdaptive = estimatorRunAdaptive,
+    .destroy = estimatorDestroy,
+    .stats = estimatorStats
+};
@@ -4,178 +4,403 @@
  * Date: 12/11/2020
  * Last Modified: 12/11/2020
  *
+ * The sharded engine: every thread counts into its own workspace and the counts are
+ * summed once all threads have finished.
+ *
  */
 #include <stdio.h>
 #include <stdlib.h>
-#include <time.h>
-#include <unistd.h>
 #include <pthread.h>
+#include "engine.h"
+#include "kernel.h"
+#include "topology.h"
+#include "scheduler.h"
+#include "pool.h"
+#include "progress.h"
+#include "stats.h"
+#include "perf.h"
 
 /* Structure: Workspace
- * Holds all variables required for each worker thread.
+ * Holds all variables required for each worker thread. Workspaces are aligned to a cache
+ * line so the workspaces of different threads never share one.
  *
- * @variable pointCount   - Number of points to calculate
- * @variable circlePoints - Number of points calculated that were inside the circle
- * @variable *radius      - Pointer to the double containing the radius of the circle.
- * @variable seed         - A unique seed for each thread that is provided to the rand_r function
+ * @variable pointCount   - Number of points calculated by this thread
+ * @variable circlePoints - Number of points calculated that were inside the circle, or their
+ *                          score with the sample mean estimator
+ * @variable random       - The random number stream used by this thread, seeded for each
+ *                          block of points it draws
+ * @variable *stats       - Instrumentation of this thread, NULL if not instrumented
+ * @variable perf         - Hardware counters of this thread, with INSTRUMENT_COUNTERS
  */
 typedef struct WorkspaceStruct{
-    int pointCount;
-    int circlePoints;
-    double* radius;
-    int seed;
+    _Alignas(CACHE_LINE_SIZE) uint64_t pointCount;
+    uint64_t circlePoints;
+    RandomStream random;
+    WorkerStats *stats;
+    PerfCounters perf;
 }Workspace;
 
+/* Structure: Estimator
+ * Reusable estimation context. Owns a persistent pool of worker threads, their workspaces
+ * and random number streams, so estimations can be run back to back without creating
+ * threads. Each estimation continues the block streams of the previous one.
+ *
+ * @variable pool        - The worker threads
+ * @variable **workspaces - Workspace of each thread, allocated by the thread itself after it
+ *                         has been pinned, so the memory is first touched, and therefore placed,
+ *                         on the thread's NUMA node
+ * @variable scheduler   - Hands out the chunks of points of the current estimation
+ * @variable radius      - Radius of the circle of the current estimation
+ * @variable randomType  - Random number generator used by the threads
+ * @variable seed        - Seed of the run, which with the index of a block gives its stream
+ * @variable estimatorType - Estimator of the area from the streams, see estimator.h
+ * @variable sequence    - Low-discrepancy sequence used instead of the streams, see sequence.h
+ * @variable firstIndex  - Index of point 0 of the current estimation, in the sequence or the
+ *                         strata or the block streams. Chunk n of the scheduler uses the same
+ *                         range of indices whichever thread takes it. Always on a block.
+ * @variable nextIndex   - Index of point 0 of the next estimation. Always on a block.
+ * @variable *progress   - Running totals of an estimation run to a tolerance, NULL otherwise
+ * @variable *checkpoint - Checkpoint of the next estimation, NULL once it has run or if none
+ * @variable instrument  - INSTRUMENT_ flags of what is recorded in stats, 0 for nothing
+ * @variable stats       - Instrumentation of every thread
+ */
+typedef struct EstimatorStruct{
+    ThreadPool pool;
+    Workspace **workspaces;
+    Scheduler scheduler;
+    double radius;
+    RandomType randomType;
+    uint64_t seed;
+    EstimatorType estimatorType;
+    Sequence sequence;
+    uint64_t firstIndex;
+    uint64_t nextIndex;
+    Progress *progress;
+    Checkpoint *checkpoint;
+    int instrument;
+    EngineStats stats;
+}Estimator;
 
 /*
- * Function: isInCircle
+ * Function: createWorkspace
  * ------------------------
- * Calculates whether the coordinate ( x , y ) is within the bounds of the circle with
- * the radius provided.
- * Uses Pythagoras' Theorem: a^2 + b^2 = c^2 to calculate length of point to the
- * center of the circle. Returns boolean c^2 < r^2 where r is the radius of the circle
+ * Pool task run once by every thread when the estimator is created. Allocates and seeds
+ * the thread's workspace.
  *
- * @param radius - Radius of the circle to check.
- * @param x      - The x coordinate of the point to check is in the circle
- * @param y      - The y coordinate of the point to check is in the circle
- *
- * @return int of 1 if coordinate (x,y) is within the circle, otherwise returns 0
+ * @param *e     - void pointer to the estimator
+ * @param worker - Index of the current thread
  */
-int isInCircle(double radius, double x, double y){
-    return (x*x) + (y*y) < (radius*radius);
+static void createWorkspace(void *e, int worker){
+    Estimator *estimator = (Estimator*) e;
+
+    Workspace *workspace = aligned_alloc(CACHE_LINE_SIZE, sizeof(Workspace));
+    if(workspace == NULL){
+        perror("Error allocating Workspace: ");
+        exit(EXIT_FAILURE);
+    }
+    workspace->pointCount = 0;
+    workspace->circlePoints = 0;
+    randomSeed(&workspace->random, estimator->randomType, estimator->seed, 0);
+    workspace->stats = estimator->instrument ? &estimator->stats.workers[worker] : NULL;
+    workspace->perf.opened = 0;
+    if(estimator->instrument & INSTRUMENT_COUNTERS){
+        perfOpen(&workspace->perf); // Counts the calling thread, so opened here rather than in estimatorCreate
+    }
+
+    estimator->workspaces[worker] = workspace;
 }
 
 /*
  * Function: calculateCirclePoints
  * ------------------------
- * Iterates through a large number of random coordinates, counting how many are within the
- * bounds of a circle. It then stores this number in the workspace provided.
- *
- * @param *ws - void pointer to the workspace of the current thread
+ * Pool task run by every thread for each estimation. Takes chunks of points from the
+ * scheduler until none are left, counting how many of the random coordinates are within
+ * the bounds of a circle. It then stores this number in the thread's workspace.
+ * When running to a tolerance each chunk is also reported to the running totals, and the
+ * scheduler is stopped once the tolerance is reached. With a checkpoint, chunks restored
+ * from it are skipped and every other chunk is reported to it.
+ * When instrumented, each chunk is timed as sampling and each report as lock time. The
+ * hardware counters cover the whole task. The radius is read once, before the first chunk.
  *
- * @return void* that will always be NULL if the thread executes properly
+ * @param *e     - void pointer to the estimator
+ * @param worker - Index of the current thread
  */
-void* calculateCirclePoints(void *ws){
-    Workspace *workspace = (Workspace*) ws;
+static void calculateCirclePoints(void *e, int worker){
+    Estimator *estimator = (Estimator*) e;
+    Workspace *workspace = estimator->workspaces[worker];
+    WorkerStats *stats = workspace->stats;
+    Checkpoint *checkpoint = estimator->checkpoint;
+    const double radius = estimator->radius;
+    uint64_t firstPoint, chunkPoints;
+    double start = 0;
 
-    for(int i = 0; i < workspace->pointCount; i++){
-        double x = ((double)rand_r(&workspace->seed)*2 / (double)RAND_MAX) - 1; // Random double between -1 and 1
-        double y = ((double)rand_r(&workspace->seed)*2 / (double)RAND_MAX) - 1; // Random double between -1 and 1
+    workspace->pointCount = 0;
+    workspace->circlePoints = 0;
+    if(estimator->instrument & INSTRUMENT_COUNTERS){
+        perfStart(&workspace->perf);
+    }
 
-        if(isInCircle(*workspace->radius, x, y)){
-            workspace->circlePoints++;
+    while(schedulerNext(&estimator->scheduler, worker, &firstPoint, &chunkPoints)){
+        uint64_t chunk = firstPoint / estimator->scheduler.chunkPoints;
+        if(checkpoint != NULL && checkpointRestored(checkpoint, chunk)){
+            continue;
+        }
+        if(stats != NULL){
+            start = monotonicSeconds();
+        }
+        uint64_t chunkCirclePoints;
+        if(estimator->sequence.type == SEQUENCE_RANDOM){
+            chunkCirclePoints = estimatorSampleRange(estimator->estimatorType, &workspace->random, estimator->seed,
+                                                     radius, estimator->firstIndex + firstPoint, chunkPoints, NULL);
+        } else {
+            chunkCirclePoints = countCirclePointsSequence(&estimator->sequence, radius,
+                                                          estimator->firstIndex + firstPoint, chunkPoints, NULL);
+        }
+        workspace->circlePoints += chunkCirclePoints;
+        workspace->pointCount += chunkPoints;
+        if(checkpoint != NULL){
+            checkpointReport(checkpoint, chunk, chunkPoints, chunkCirclePoints);
+        }
+        if(stats != NULL){
+            double end = monotonicSeconds();
+            stats->samplingSeconds += end - start;
+            stats->chunks++;
+            stats->points += chunkPoints;
+            start = end;
         }
-    }
 
-    return NULL;
+        if(estimator->progress != NULL){
+            int done = progressReport(estimator->progress, chunkPoints, chunkCirclePoints);
+            if(stats != NULL){
+                stats->lockSeconds += monotonicSeconds() - start;
+                stats->lockAcquisitions++;
+            }
+            if(done){
+                schedulerStop(&estimator->scheduler);
+            }
+        }
+    }
+    if(estimator->instrument & INSTRUMENT_COUNTERS){
+        perfStop(&workspace->perf, stats->counters, &stats->countersRead, &stats->countersScaled);
+    }
 }
 
 /*
- * Function: calculateCircleArea
+ * Function: estimatorCreate
  * ------------------------
- * Creates the number of threads provided as a parameter and evenly distributes each thread
- * a number of points to calculate. It waits until all the threads are finished to join
- * them back up and calculate the area of the circle. This value is returned.
+ * Allocates an estimator, starts its worker threads and creates their workspaces.
  *
- * @param pointCount  - Number of random coordinates to iterate through. The greater the
- *                      pointCount, the more accurate the area calculation will be.
- * @param threadCount - Number of worker threads to create and use to calculate the points.
- * @param radius      - Radius of the circle to calculate the area of.
+ * @param *options - Settings of the engine: thread count, random number generator, seed and
+ *                   affinity
  *
- * @return double of the calculated area of the circle
+ * @return void* of the estimator, or NULL if the threads could not be created
  */
-double calculateCircleArea(int pointCount, int threadCount, double radius){
-    Workspace workspaces[threadCount];
-    pthread_t workerThreads[threadCount];
-
-    int pointsPerThread = pointCount / threadCount;
-    int remainingPoints = pointCount % threadCount;
-    int initialSeed = time(NULL);
-    int circlePoints = 0;
-
-    for(int i = 0; i < threadCount; i++) {
-        workspaces[i].pointCount = pointsPerThread + (i < remainingPoints);
-        workspaces[i].circlePoints = 0;
-        workspaces[i].radius = &radius;
-        workspaces[i].seed = initialSeed + i;
-
-        int status = pthread_create(&(workerThreads[i]), NULL, calculateCirclePoints, &workspaces[i]);
-        if(status != 0){
-            perror("Error creating Thread: ");
-        }
+static void* estimatorCreate(const EngineOptions *options){
+    Estimator *estimator = malloc(sizeof(Estimator));
+    if(estimator == NULL){
+        return NULL;
+    }
+    estimator->radius = 1.0;
+    estimator->randomType = options->randomType;
+    estimator->seed = options->seed;
+    estimator->estimatorType = options->estimatorType;
+    sequenceInit(&estimator->sequence, options->sequence, estimator->seed);
+    estimator->firstIndex = 0;
+    estimator->nextIndex = 0;
+    estimator->progress = NULL;
+    estimator->checkpoint = options->checkpoint;
+    estimator->instrument = options->instrument;
+    if(estimator->instrument && !statsCreate(&estimator->stats, options->threadCount)){
+        free(estimator);
+        return NULL;
     }
+    estimator->workspaces = calloc(options->threadCount, sizeof(Workspace*));
 
-    for(int i = 0; i < threadCount; i++) {
-        pthread_join(workerThreads[i], NULL);
-        circlePoints += workspaces[i].circlePoints;
+    if(estimator->workspaces == NULL ||
+       !schedulerInit(&estimator->scheduler, 0, SCHEDULER_CHUNK_POINTS, options->threadCount)){
+        free(estimator->workspaces);
+        if(estimator->instrument){
+            statsDestroy(&estimator->stats);
+        }
+        free(estimator);
+        return NULL;
+    }
+    if(!poolCreate(&estimator->pool, options->threadCount, options->affinity)){
+        schedulerDestroy(&estimator->scheduler);
+        free(estimator->workspaces);
+        if(estimator->instrument){
+            statsDestroy(&estimator->stats);
+        }
+        free(estimator);
+        return NULL;
     }
 
-    return ((double)circlePoints/(double)pointCount)*4*radius*radius;
+    poolRun(&estimator->pool, createWorkspace, estimator);
+    if(estimator->instrument){
+        statsRecordSpawn(&estimator->stats, &estimator->pool);
+    }
+    return estimator;
 }
 
 /*
- * Function: main
+ * Function: estimatorRunRange
  * ------------------------
- * Iterates through a large number of random coordinates, counting how many are within the
- * bounds of a circle. It then calculates a rough estimate for the area of the circle.
- * This process is done with multiple threads, by splitting the total number of point
- * calculations evenly between threads and calculating the sum of the points in the circle
- * once all threads have finished.
- * The time taken to calculate the area of the circle is calculated and displayed on completion.
- *
- * @param argc - Number of command line arguments provided
- * @param *argv[] - array of pointers to the command line arguments
- *        argv[0] - The name of the this executable file.
- *        argv[1...n]:
- *          [-p] number of points to iterate through
- *          [-t] number of worker threads to create
- *          [-r] radius of the circle to calculate
- *          [-c] calculate and display execution time
- *
- * @return int of how program exits
+ * Splits the points into chunks, handed out by a work stealing scheduler so threads that
+ * finish early take over chunks from slower ones, and waits until all the threads are
+ * finished. With a checkpoint the chunks it holds are restored rather than drawn, and it is
+ * saved while the threads run and once they have finished. The next estimation is not moved.
+ *
+ * @param *e         - void pointer to the estimator
+ * @param firstPoint - Index of the first point to draw, a multiple of RANDOM_BLOCK_POINTS
+ * @param pointCount - Number of points to draw
+ * @param radius     - Radius of the circle to calculate the area of.
+ *
+ * @return uint64_t of the score of the points, see estimatorSample
  */
-int main(int argc, char *argv[]) {
-    // Default Values, used if not arguments provided
-    int pointCount = 100000;
-    int threadCount = 10;
-    double radius = 1.0;
-    int timer = 0;
-    int c;
-
-    // Retrieving Arguments
-    while ((c = getopt(argc, argv, "p:t:r:c")) != -1){
-        switch(c){
-            case 'p': // Point Count
-                pointCount = atoi(optarg);
-                break;
-            case 't': // Thread Count
-                threadCount = atoi(optarg);
-                break;
-            case 'r': // Radius
-                radius = atof(optarg);
-                break;
-            case 'c': // Clock (timer)
-                timer = 1;
-                break;
+static uint64_t estimatorRunRange(void *e, uint64_t firstPoint, uint64_t pointCount, double radius){
+    Estimator *estimator = (Estimator*) e;
+    uint64_t circlePoints = 0;
+
+    estimator->radius = radius;
+    estimator->firstIndex = firstPoint;
+    schedulerReset(&estimator->scheduler, pointCount, SCHEDULER_CHUNK_POINTS);
+    if(estimator->checkpoint != NULL){
+        if(!checkpointStart(estimator->checkpoint, estimator->scheduler.chunkPoints)){
+            fprintf(stderr, "Error restoring checkpoint: it does not match the chunks of the run\n");
+            exit(EXIT_FAILURE);
         }
+        circlePoints = estimator->checkpoint->restoredScore;
+    }
+    poolRun(&estimator->pool, calculateCirclePoints, estimator);
+    if(estimator->instrument){
+        statsRecordJoin(&estimator->stats, &estimator->pool);
+    }
+    if(estimator->checkpoint != NULL){
+        checkpointFinish(estimator->checkpoint);
+        estimator->checkpoint = NULL;
     }
 
-    struct timespec startTime, endTime;
+    for(int i = 0; i < estimator->pool.threadCount; i++) {
+        circlePoints += estimator->workspaces[i]->circlePoints;
+    }
+    return circlePoints;
+}
 
-    if(timer) {
-        clock_gettime(CLOCK_REALTIME, &startTime);
+/*
+ * Function: estimatorRun
+ * ------------------------
+ * Draws the points of the next estimation, see estimatorRunRange, and calculates the area
+ * of the circle. This value is returned.
+ *
+ * @param *e         - void pointer to the estimator
+ * @param pointCount - Number of random coordinates to iterate through. The greater the
+ *                     pointCount, the more accurate the area calculation will be.
+ * @param radius     - Radius of the circle to calculate the area of.
+ *
+ * @return double of the calculated area of the circle
+ */
+static double estimatorRun(void *e, uint64_t pointCount, double radius){
+    Estimator *estimator = (Estimator*) e;
+    uint64_t firstPoint = estimator->nextIndex;
+
+    estimator->nextIndex += randomBlockRound(pointCount);
+    uint64_t circlePoints = estimatorRunRange(estimator, firstPoint, pointCount, radius);
+
+    return estimatorArea(estimator->estimatorType, circlePoints, pointCount, radius);
+}
+
+/*
+ * Function: estimatorRunAdaptive
+ * ------------------------
+ * Keeps drawing points until the 95% confidence interval of the area is narrower than the
+ * tolerance, or until the time limit has passed, instead of drawing a fixed number of
+ * points. The threads report every chunk and the variance of the chunk estimates gives the
+ * confidence interval. Threads check the scheduler's stop flag between chunks, so a time
+ * limited run overruns by at most one chunk (PROGRESS_CHUNK_POINTS points) per thread, and
+ * the area uses every point drawn.
+ *
+ * @param *e          - void pointer to the estimator
+ * @param tolerance   - Half width of the confidence interval at which to stop, 0 for none
+ * @param timeLimit   - Seconds after which to stop, 0 for no limit
+ * @param pointLimit  - Most points to draw if neither is reached first, 0 for no limit.
+ *                      Capped at estimatorMaxPoints of the estimator
+ * @param radius      - Radius of the circle to calculate the area of.
+ * @param *pointsUsed - Set to the number of points drawn
+ * @param *error      - Set to the half width of the confidence interval reached
+ *
+ * @return double of the calculated area of the circle
+ */
+static double estimatorRunAdaptive(void *e, double tolerance, double timeLimit, uint64_t pointLimit,
+                                   double radius, uint64_t *pointsUsed, double *error){
+    Estimator *estimator = (Estimator*) e;
+    Progress progress;
+
+    if(pointLimit == 0){
+        pointLimit = PROGRESS_CHUNK_POINTS * SCHEDULER_MAX_CHUNKS;
     }
+    if(pointLimit > estimatorMaxPoints(estimator->estimatorType)){
+        pointLimit = estimatorMaxPoints(estimator->estimatorType);
+    }
+
+    progressInit(&progress, radius, estimatorUnit(estimator->estimatorType), tolerance, timeLimit);
+    estimator->radius = radius;
+    estimator->progress = &progress;
+    estimator->firstIndex = estimator->nextIndex;
+    estimator->nextIndex += randomBlockRound(pointLimit); // Chunks not handed out are skipped
+    schedulerReset(&estimator->scheduler, pointLimit, PROGRESS_CHUNK_POINTS);
+    poolRun(&estimator->pool, calculateCirclePoints, estimator);
+    if(estimator->instrument){
+        statsRecordJoin(&estimator->stats, &estimator->pool);
+    }
+    estimator->progress = NULL;
 
-    double area = calculateCircleArea(pointCount, threadCount, radius);
+    double area = progressArea(&progress);
+    *pointsUsed = progress.pointCount;
+    *error = progressError(&progress);
+    progressDestroy(&progress);
 
-    printf("Number of Points = %d, Number of Threads = %d, Circle Radius = %f\n",pointCount, threadCount,radius);
-    printf("The Area of the circle is: %f\n", area);
+    return area;
+}
 
-    if(timer) {
-        clock_gettime(CLOCK_REALTIME, &endTime);
-        double elapsedTime = (endTime.tv_sec - startTime.tv_sec) +
-                             (endTime.tv_nsec - startTime.tv_nsec) / 1000000000.0;
-        printf("Elapsed Time: %f seconds\n", elapsedTime);
+/*
+ * Function: estimatorDestroy
+ * ------------------------
+ * Stops the worker threads of an estimator and frees it and their workspaces.
+ *
+ * @param *e - void pointer to the estimator to destroy
+ */
+static void estimatorDestroy(void *e){
+    Estimator *estimator = (Estimator*) e;
+    poolDestroy(&estimator->pool);
+    for(int i = 0; i < estimator->pool.threadCount; i++) {
+        perfClose(&estimator->workspaces[i]->perf);
+        free(estimator->workspaces[i]);
     }
-    return EXIT_SUCCESS;
+    free(estimator->workspaces);
+    schedulerDestroy(&estimator->scheduler);
+    if(estimator->instrument){
+        statsDestroy(&estimator->stats);
+    }
+    free(estimator);
+}
+
+/*
+ * Function: estimatorStats
+ * ------------------------
+ * @param *e - void pointer to the estimator
+ *
+ * @return const EngineStats* of the instrumentation, NULL if not instrumented
+ */
+static const EngineStats* estimatorStats(void *e){
+    Estimator *estimator = (Estimator*) e;
+    return estimator->instrument ? &estimator->stats : NULL;
 }
+
+const EngineOps shardedEngine = {
+    .create = estimatorCreate,
+    .run = estimatorRun,
+    .runRange = estimatorRunRange,
+    .runAdaptive = estimatorRunAdaptive,
+    .destroy = estimatorDestroy,
+    .stats = estimatorStats
+};
@@ -4,198 +4,566 @@
  * Date: 12/11/2020
  * Last Modified: 12/11/2020
  *
+ * The shared engine: every thread adds its circle points to one shared total, using the
+ * strategy chosen in the engine options.
+ *
  */
 #include <stdio.h>
 #include <stdlib.h>
-#include <time.h>
-#include <unistd.h>
 #include <pthread.h>
+#include <stdatomic.h>
+#include "engine.h"
+#include "kernel.h"
+#include "topology.h"
+#include "scheduler.h"
+#include "pool.h"
+#include "progress.h"
+#include "stats.h"
+#include "perf.h"
+
+// Number of shards used by the sharded strategy, threads are spread over them
+#define SHARD_COUNT 8
+// Points each thread draws with one call, and counts locally before flushing with the
+// batched strategy
+#define BATCH_FLUSH_POINTS 65536
+
+/* Structure: CounterShard
+ * One shard of the shared counter, on its own cache line so shards do not false share.
+ *
+ * @variable circlePoints - Number of points inside the circle added to this shard
+ */
+typedef struct CounterShardStruct{
+    _Alignas(CACHE_LINE_SIZE) atomic_uint_fast64_t circlePoints;
+}CounterShard;
+
+typedef struct EstimatorStruct Estimator;
 
 /* Structure: Workspace
- * Holds all variables required for each worker thread.
+ * Holds all variables required for each worker thread. Workspaces are aligned to a cache
+ * line, so the streams the threads advance on every point never share one.
  *
- * @variable pointCount - Number of points to calculate
- * @variable seed       - A unique seed for each thread that is provided to the rand_r function
+ * @variable *estimator - The estimator the thread belongs to
+ * @variable random     - The random number stream used by this thread, seeded for each block
+ *                        of points it draws
+ * @variable id         - Index of the thread
+ * @variable *stats     - Instrumentation of this thread, NULL if not instrumented
+ * @variable perf       - Hardware counters of this thread, with INSTRUMENT_COUNTERS
  */
 typedef struct WorkspaceStruct{
-    int pointCount;
-    int seed;
+    _Alignas(CACHE_LINE_SIZE) Estimator *estimator;
+    RandomStream random;
     int id;
+    WorkerStats *stats;
+    PerfCounters perf;
 }Workspace;
 
-// Global Variables : accessed/shared by all threads
-double radius = 1;
-int verbose = 0;
-volatile int circlePoints = 0, available = 1;
-pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
-pthread_cond_t condvar = PTHREAD_COND_INITIALIZER;
+/* Structure: Estimator
+ * Reusable estimation context. Owns a persistent pool of worker threads and their
+ * workspaces and random number streams, so estimations can be run back to back without
+ * creating threads. Also holds the shared total: accessed/shared by all threads.
+ *
+ * @variable pool               - The worker threads
+ * @variable *workspaces        - Workspace of each thread
+ * @variable scheduler          - Hands out the chunks of points of the current estimation
+ * @variable *progress          - Running totals of an estimation run to a tolerance, NULL otherwise
+ * @variable *checkpoint        - Checkpoint of the next estimation, NULL once it has run or if none
+ * @variable radius             - Radius of the circle of the current estimation
+ * @variable estimatorType      - Estimator of the area from the streams, see estimator.h. The
+ *                               shared total holds its score.
+ * @variable sequence           - Low-discrepancy sequence used instead of the streams, see sequence.h
+ * @variable seed               - Seed of the run, which with the index of a block gives its stream
+ * @variable firstIndex         - Index of point 0 of the current estimation, in the sequence,
+ *                               the strata or the block streams. Always on a block.
+ * @variable nextIndex          - Index of point 0 of the next estimation. Always on a block.
+ * @variable strategy           - How the threads update the shared total
+ * @variable instrument         - INSTRUMENT_ flags of what is recorded in stats, 0 for nothing
+ * @variable stats              - Instrumentation of every thread
+ * @variable spawnRecorded      - Set once the spawn time of the threads has been recorded
+ * @variable circlePoints       - Shared total of the mutex strategy, protected by mutex
+ * @variable mutex              - Protects circlePoints
+ * @variable atomicCirclePoints - Shared total of the atomic and batched strategies
+ * @variable shards             - Shared total of the sharded strategy
+ */
+struct EstimatorStruct{
+    ThreadPool pool;
+    Workspace *workspaces;
+    Scheduler scheduler;
+    Progress *progress;
+    Checkpoint *checkpoint;
+    double radius;
+    EstimatorType estimatorType;
+    Sequence sequence;
+    uint64_t seed;
+    uint64_t firstIndex;
+    uint64_t nextIndex;
+    Strategy strategy;
+    int instrument;
+    EngineStats stats;
+    int spawnRecorded;
+    uint64_t circlePoints;
+    pthread_mutex_t mutex;
+    atomic_uint_fast64_t atomicCirclePoints;
+    CounterShard shards[SHARD_COUNT];
+};
 
 /*
- * Function: isInCircle
+ * Function: addCirclePoints
  * ------------------------
- * Calculates whether the coordinate ( x , y ) is within the bounds of the circle with
- * the radius provided.
- * Uses Pythagoras' Theorem: a^2 + b^2 = c^2 to calculate length of point to the
- * center of the circle. Returns boolean c^2 < r^2 where r is the radius of the circle
+ * Adds a thread's circle points to the shared total using the selected strategy, counting
+ * each update and timing each mutex acquisition when instrumented.
  *
- * @param x      - The x coordinate of the point to check is in the circle
- * @param y      - The y coordinate of the point to check is in the circle
+ * @param *workspace      - The workspace of the current thread
+ * @param newCirclePoints - Number of points to add
+ */
+static void addCirclePoints(Workspace *workspace, uint64_t newCirclePoints){
+    Estimator *estimator = workspace->estimator;
+    WorkerStats *stats = workspace->stats;
+
+    switch(estimator->strategy){
+        case STRATEGY_MUTEX: {
+            double start = stats != NULL ? monotonicSeconds() : 0;
+            pthread_mutex_lock(&estimator->mutex); // Locks the mutex
+            if(stats != NULL){
+                stats->lockSeconds += monotonicSeconds() - start;
+                stats->lockAcquisitions++;
+            }
+
+            estimator->circlePoints += newCirclePoints; // Change variable protected by mutex
+            pthread_mutex_unlock(&estimator->mutex);
+            break;
+        }
+        case STRATEGY_ATOMIC:
+        case STRATEGY_BATCHED:
+            atomic_fetch_add_explicit(&estimator->atomicCirclePoints, newCirclePoints, memory_order_relaxed);
+            if(stats != NULL){stats->lockAcquisitions++;}
+            break;
+        case STRATEGY_SHARDED:
+            atomic_fetch_add_explicit(&estimator->shards[workspace->id % SHARD_COUNT].circlePoints, newCirclePoints,
+                                      memory_order_relaxed);
+            if(stats != NULL){stats->lockAcquisitions++;}
+            break;
+    }
+}
+
+/*
+ * Function: addBatchCirclePoints
+ * ------------------------
+ * Adds the circle points of each batch of a block to the shared total, one update per
+ * batch with any points inside, as addCirclePoints would batch by batch. The lock free
+ * strategies loop over the batches themselves, so the strategy is not chosen again for
+ * every batch; a mutex acquisition costs far more than that choice.
  *
- * @return int of 1 if coordinate (x,y) is within the circle, otherwise returns 0
+ * @param *workspace    - The workspace of the current thread
+ * @param *batchCircles - Number of points inside the circle of each batch
+ * @param batchCount    - Number of batches
  */
-int isInCircle(double x, double y){
-    return (x*x) + (y*y) < (radius*radius);
+static void addBatchCirclePoints(Workspace *workspace, const uint32_t *batchCircles, uint64_t batchCount){
+    Estimator *estimator = workspace->estimator;
+    WorkerStats *stats = workspace->stats;
+
+    switch(estimator->strategy){
+        case STRATEGY_ATOMIC:
+        case STRATEGY_SHARDED: {
+            atomic_uint_fast64_t *total = estimator->strategy == STRATEGY_SHARDED ?
+                                          &estimator->shards[workspace->id % SHARD_COUNT].circlePoints :
+                                          &estimator->atomicCirclePoints;
+            uint64_t adds = 0;
+            for(uint64_t batch = 0; batch < batchCount; batch++){
+                if(batchCircles[batch] > 0){ // If any Random Coordinate of the batch is inside circle area
+                    atomic_fetch_add_explicit(total, batchCircles[batch], memory_order_relaxed);
+                    adds++;
+                }
+            }
+            if(stats != NULL){stats->lockAcquisitions += adds;}
+            break;
+        }
+        default:
+            for(uint64_t batch = 0; batch < batchCount; batch++){
+                if(batchCircles[batch] > 0){
+                    addCirclePoints(workspace, batchCircles[batch]);
+                }
+            }
+            break;
+    }
 }
 
 /*
- * Function: calculateCirclePoints
+ * Function: totalCirclePoints
  * ------------------------
- * Iterates through a large number of random coordinates, counting how many are within the
- * bounds of a circle. It then stores this number in the workspace provided.
+ * Reads the shared total. Only called once all worker threads have finished.
  *
- * @param *ws - void pointer to the workspace of the current thread
+ * @param *estimator - The estimator
  *
- * @return void* that will always be NULL if the thread executes properly
+ * @return uint64_t of the number of points inside the circle added by all threads
  */
-void* calculateCirclePoints(void *ws){
-    Workspace *workspace = (Workspace*) ws;
+static uint64_t totalCirclePoints(Estimator *estimator){
+    switch(estimator->strategy){
+        case STRATEGY_ATOMIC:
+        case STRATEGY_BATCHED:
+            return atomic_load(&estimator->atomicCirclePoints);
+        case STRATEGY_SHARDED: {
+            uint64_t total = 0;
+            for(int i = 0; i < SHARD_COUNT; i++){
+                total += atomic_load(&estimator->shards[i].circlePoints);
+            }
+            return total;
+        }
+        default:
+            return estimator->circlePoints;
+    }
+}
 
-    for(int i = 0; i < workspace->pointCount; i++){
-        double x = ((double)rand_r(&workspace->seed)*2 / (double)RAND_MAX) - 1; // Random double between -1 and 1
-        double y = ((double)rand_r(&workspace->seed)*2 / (double)RAND_MAX) - 1; // Random double between -1 and 1
+/*
+ * Function: resetCirclePoints
+ * ------------------------
+ * Sets the shared total back to zero before an estimation. Only called while no worker
+ * thread is running.
+ *
+ * @param *estimator - The estimator
+ */
+static void resetCirclePoints(Estimator *estimator){
+    estimator->circlePoints = 0;
+    atomic_store(&estimator->atomicCirclePoints, 0);
+    for(int i = 0; i < SHARD_COUNT; i++){
+        atomic_store(&estimator->shards[i].circlePoints, 0);
+    }
+}
 
-        if(isInCircle(x, y)){ // If Random Coordinate is inside circle area
-            pthread_mutex_lock(&mutex); // Locks the mutex
+/*
+ * Function: calculateCirclePoints
+ * ------------------------
+ * Pool task run by every thread for each estimation. Takes chunks of points from the
+ * scheduler until none are left. Each chunk is drawn in blocks of BATCH_FLUSH_POINTS, one
+ * call each. The batched strategy adds the number of points of each block that are within
+ * the bounds of a circle to the shared total; the other strategies get the count of each
+ * batch of RANDOM_LANES points from the same call and add every batch, so the strategies
+ * only differ in how they publish.
+ * When running to a tolerance each chunk is also reported to the running totals, and the
+ * scheduler is stopped once the tolerance is reached. With a checkpoint, chunks restored
+ * from it are skipped and every other chunk is reported to it.
+ * When instrumented, each chunk is timed as sampling, less the lock time within it. The
+ * hardware counters cover the whole task, including updates of the shared total, and are
+ * opened by the thread the first time it runs the task. The radius is read once, before the
+ * first block.
+ *
+ * @param *e     - void pointer to the estimator
+ * @param worker - Index of the current thread
+ */
+static void calculateCirclePoints(void *e, int worker){
+    Estimator *estimator = (Estimator*) e;
+    Workspace *workspace = &estimator->workspaces[worker];
+    WorkerStats *stats = workspace->stats;
+    // Count of each batch of the current block, NULL with the batched strategy
+    uint32_t blockBatches[BATCH_FLUSH_POINTS / RANDOM_LANES];
+    uint32_t *batchCircles = estimator->strategy == STRATEGY_BATCHED ? NULL : blockBatches;
+    Checkpoint *checkpoint = estimator->checkpoint;
+    const double radius = estimator->radius;
+    uint64_t firstPoint, chunkPoints;
+    double start = 0, lockStart = 0;
 
-            while(available == 0){ // If another thread is updating circle points then wait
-                if(verbose){printf("Thread %d - WAITING\n", workspace->id);}
-                pthread_cond_wait(&condvar, &mutex); // Wait until signalled
-            }
+    if(estimator->instrument & INSTRUMENT_COUNTERS){
+        if(!workspace->perf.opened){
+            perfOpen(&workspace->perf);
+        }
+        perfStart(&workspace->perf);
+    }
 
-            // Change variables protected by mutex
-            available = 0;
-            circlePoints++;
+    while(schedulerNext(&estimator->scheduler, workspace->id, &firstPoint, &chunkPoints)){
+        uint64_t chunk = firstPoint / estimator->scheduler.chunkPoints;
+        uint64_t chunkCirclePoints = 0;
+        if(checkpoint != NULL && checkpointRestored(checkpoint, chunk)){
+            continue;
+        }
+        if(stats != NULL){
+            start = monotonicSeconds();
+            lockStart = stats->lockSeconds;
+        }
 
-            if(verbose){printf("Thread %d - ADDED - Total Circle Points = %d\n", workspace->id, circlePoints);}
+        for(uint64_t i = 0; i < chunkPoints; i += BATCH_FLUSH_POINTS){
+            uint64_t blockPoints = chunkPoints - i < BATCH_FLUSH_POINTS ? chunkPoints - i : BATCH_FLUSH_POINTS;
+            uint64_t blockCirclePoints;
+            if(estimator->sequence.type == SEQUENCE_RANDOM){
+                blockCirclePoints = estimatorSampleRange(estimator->estimatorType, &workspace->random,
+                                                         estimator->seed, radius,
+                                                         estimator->firstIndex + firstPoint + i, blockPoints,
+                                                         batchCircles);
+            } else {
+                blockCirclePoints = countCirclePointsSequence(&estimator->sequence, radius,
+                                                              estimator->firstIndex + firstPoint + i, blockPoints,
+                                                              batchCircles);
+            }
+            chunkCirclePoints += blockCirclePoints;
 
-            // Unlock mutex allowing other thread to alter circlePoints
-            pthread_mutex_unlock(&mutex);
-            available = 1;
-            // Signal for another thread to start
-            pthread_cond_signal(&condvar);
+            if(batchCircles != NULL){
+                addBatchCirclePoints(workspace, batchCircles, (blockPoints + RANDOM_LANES - 1) / RANDOM_LANES);
+            } else if(blockCirclePoints > 0){ // If any Random Coordinate of the block is inside circle area
+                addCirclePoints(workspace, blockCirclePoints);
+            }
+        }
+        if(stats != NULL){
+            double end = monotonicSeconds();
+            stats->samplingSeconds += end - start - (stats->lockSeconds - lockStart);
+            stats->chunks++;
+            stats->points += chunkPoints;
+            start = end;
+        }
+        if(checkpoint != NULL){
+            checkpointReport(checkpoint, chunk, chunkPoints, chunkCirclePoints);
         }
-    }
 
-    return NULL;
+        if(estimator->progress != NULL){
+            int done = progressReport(estimator->progress, chunkPoints, chunkCirclePoints);
+            if(stats != NULL){
+                stats->lockSeconds += monotonicSeconds() - start;
+                stats->lockAcquisitions++;
+            }
+            if(done){
+                schedulerStop(&estimator->scheduler);
+            }
+        }
+    }
+    if(estimator->instrument & INSTRUMENT_COUNTERS){
+        perfStop(&workspace->perf, stats->counters, &stats->countersRead, &stats->countersScaled);
+    }
 }
 
 /*
- * Function: calculateCircleArea
+ * Function: estimatorCreate
  * ------------------------
- * Creates the number of threads provided as a parameter and evenly distributes each thread
- * a number of points to calculate. It waits until all the threads are finished to join
- * them back up and calculate the area of the circle. This value is returned.
+ * Allocates an estimator, starts its worker threads and seeds their random number streams
+ * and the sequence.
  *
- * @param pointCount  - Number of random coordinates to iterate through. The greater the
- *                      pointCount, the more accurate the area calculation will be.
- * @param threadCount - Number of worker threads to create and use to calculate the points.
+ * @param *options - Settings of the engine
  *
- * @return double of the calculated area of the circle
+ * @return void* of the estimator, or NULL if the threads could not be created
  */
-double calculateCircleArea(int pointCount, int threadCount){
-    Workspace workspaces[threadCount];
-    pthread_t workerThreads[threadCount];
+static void* estimatorCreate(const EngineOptions *options){
+    Estimator *estimator = aligned_alloc(CACHE_LINE_SIZE, sizeof(Estimator));
+    if(estimator == NULL){
+        return NULL;
+    }
+    estimator->progress = NULL;
+    estimator->checkpoint = options->checkpoint;
+    estimator->radius = 1.0;
+    estimator->estimatorType = options->estimatorType;
+    estimator->seed = options->seed;
+    sequenceInit(&estimator->sequence, options->sequence, estimator->seed);
+    estimator->firstIndex = 0;
+    estimator->nextIndex = 0;
+    estimator->strategy = options->strategy;
+    estimator->instrument = options->instrument;
+    estimator->spawnRecorded = 0;
+    resetCirclePoints(estimator);
 
-    int pointsPerThread = pointCount / threadCount;
-    int remainingPoints = pointCount % threadCount;
-    int initialSeed = time(NULL);
+    if(estimator->instrument && !statsCreate(&estimator->stats, options->threadCount)){
+        free(estimator);
+        return NULL;
+    }
+    estimator->workspaces = aligned_alloc(CACHE_LINE_SIZE, sizeof(Workspace) * options->threadCount);
+    if(estimator->workspaces == NULL ||
+       !schedulerInit(&estimator->scheduler, 0, SCHEDULER_CHUNK_POINTS, options->threadCount)){
+        free(estimator->workspaces);
+        if(estimator->instrument){
+            statsDestroy(&estimator->stats);
+        }
+        free(estimator);
+        return NULL;
+    }
 
-    for(int i = 0; i < threadCount; i++) {
-        workspaces[i].pointCount = pointsPerThread + (i < remainingPoints);
-        workspaces[i].seed = initialSeed + i;
-        workspaces[i].id = i;
+    for(int i = 0; i < options->threadCount; i++) {
+        estimator->workspaces[i].estimator = estimator;
+        randomSeed(&estimator->workspaces[i].random, options->randomType, estimator->seed, 0);
+        estimator->workspaces[i].id = i;
+        estimator->workspaces[i].stats = estimator->instrument ? &estimator->stats.workers[i] : NULL;
+        estimator->workspaces[i].perf.opened = 0;
+    }
 
-        int status = pthread_create(&(workerThreads[i]), NULL, calculateCirclePoints, &workspaces[i]);
-        if(status != 0){
-            perror("Error creating Thread: ");
+    if(!poolCreate(&estimator->pool, options->threadCount, options->affinity)){
+        schedulerDestroy(&estimator->scheduler);
+        free(estimator->workspaces);
+        if(estimator->instrument){
+            statsDestroy(&estimator->stats);
         }
+        free(estimator);
+        return NULL;
     }
+    pthread_mutex_init(&estimator->mutex, NULL);
+    return estimator;
+}
 
-    for(int i = 0; i < threadCount; i++) {
-        pthread_join(workerThreads[i], NULL);
+/*
+ * Function: recordRun
+ * ------------------------
+ * Records the spawn time of the threads after their first run, and the join time of every
+ * run, when the estimator is instrumented. Threads are only pinned and ready once the
+ * pool has run a task.
+ *
+ * @param *estimator - The estimator, whose run has just finished
+ */
+static void recordRun(Estimator *estimator){
+    if(!estimator->instrument){
+        return;
     }
-
-    return ((double)circlePoints/(double)pointCount)*4*radius*radius;
+    if(!estimator->spawnRecorded){
+        statsRecordSpawn(&estimator->stats, &estimator->pool);
+        estimator->spawnRecorded = 1;
+    }
+    statsRecordJoin(&estimator->stats, &estimator->pool);
 }
 
 /*
- * Function: main
+ * Function: estimatorRunRange
  * ------------------------
- * Iterates through a large number of random coordinates, counting how many are within the
- * bounds of a circle. It then calculates a rough estimate for the area of the circle.
- * This process is done with multiple threads, by splitting the total number of point
- * calculations evenly between threads and calculating the sum of the points in the circle
- * once all threads have finished.
- * The time taken to calculate the area of the circle is calculated and displayed on completion.
- *
- * @param argc - Number of command line arguments provided
- * @param *argv[] - array of pointers to the command line arguments
- *        argv[0] - The name of the this executable file.
- *        argv[1...n]:
- *          [-p] number of points to iterate through
- *          [-t] number of worker threads to create
- *          [-r] radius of the circle to calculate
- *          [-c] calculate and display execution time
- *          [-v] print out when each thread add a circle point
- *
- * @return int of how program exits
- */
-int main(int argc, char *argv[]) {
-    // Default Values, used if not arguments provided
-    int pointCount = 100000;
-    int threadCount = 10;
-    int timer = 0;
-    int c;
-
-    // Retrieving Arguments
-    while ((c = getopt(argc, argv, "p:t:r:cv")) != -1){
-        switch(c){
-            case 'p': // Point Count
-                pointCount = atoi(optarg);
-                break;
-            case 't': // Thread Count
-                threadCount = atoi(optarg);
-                break;
-            case 'r': // Radius
-                radius = atof(optarg);
-                break;
-            case 'c': // Clock (timer)
-                timer = 1;
-                break;
-            case 'v': // Verbose (extra information)
-                verbose = 1;
-                break;
+ * Splits the points into chunks, handed out by a work stealing scheduler so threads that
+ * finish early take over chunks from slower ones, and waits until all the threads are
+ * finished. With a checkpoint the chunks it holds are restored rather than drawn, and it is
+ * saved while the threads run and once they have finished. The next estimation is not moved.
+ *
+ * @param *e         - void pointer to the estimator
+ * @param firstPoint - Index of the first point to draw, a multiple of RANDOM_BLOCK_POINTS
+ * @param pointCount - Number of points to draw
+ * @param radius     - Radius of the circle to calculate the area of.
+ *
+ * @return uint64_t of the score of the points, see estimatorSample
+ */
+static uint64_t estimatorRunRange(void *e, uint64_t firstPoint, uint64_t pointCount, double radius){
+    Estimator *estimator = (Estimator*) e;
+    uint64_t restoredCirclePoints = 0;
+
+    estimator->radius = radius;
+    estimator->firstIndex = firstPoint;
+    resetCirclePoints(estimator);
+    schedulerReset(&estimator->scheduler, pointCount, SCHEDULER_CHUNK_POINTS);
+    if(estimator->checkpoint != NULL){
+        if(!checkpointStart(estimator->checkpoint, estimator->scheduler.chunkPoints)){
+            fprintf(stderr, "Error restoring checkpoint: it does not match the chunks of the run\n");
+            exit(EXIT_FAILURE);
         }
+        restoredCirclePoints = estimator->checkpoint->restoredScore;
+    }
+    poolRun(&estimator->pool, calculateCirclePoints, estimator);
+    recordRun(estimator);
+    if(estimator->checkpoint != NULL){
+        checkpointFinish(estimator->checkpoint);
+        estimator->checkpoint = NULL;
     }
 
+    return restoredCirclePoints + totalCirclePoints(estimator);
+}
+
+/*
+ * Function: estimatorRun
+ * ------------------------
+ * Draws the points of the next estimation, see estimatorRunRange, and calculates the area
+ * of the circle. This value is returned.
+ *
+ * @param *e         - void pointer to the estimator
+ * @param pointCount - Number of random coordinates to iterate through. The greater the
+ *                     pointCount, the more accurate the area calculation will be.
+ * @param radius     - Radius of the circle to calculate the area of.
+ *
+ * @return double of the calculated area of the circle
+ */
+static double estimatorRun(void *e, uint64_t pointCount, double radius){
+    Estimator *estimator = (Estimator*) e;
+    uint64_t firstPoint = estimator->nextIndex;
+
+    estimator->nextIndex += randomBlockRound(pointCount);
+    uint64_t circlePoints = estimatorRunRange(estimator, firstPoint, pointCount, radius);
 
-    struct timespec startTime, endTime;
-    if(timer) {
-        clock_gettime(CLOCK_REALTIME, &startTime); // Get the start time
+    return estimatorArea(estimator->estimatorType, circlePoints, pointCount, radius);
+}
+
+/*
+ * Function: estimatorRunAdaptive
+ * ------------------------
+ * Keeps drawing points until the 95% confidence interval of the area is narrower than the
+ * tolerance, or until the time limit has passed, instead of drawing a fixed number of
+ * points. The threads report every chunk and the variance of the chunk estimates gives the
+ * confidence interval. Threads check the scheduler's stop flag between chunks, so a time
+ * limited run overruns by at most one chunk (PROGRESS_CHUNK_POINTS points) per thread, and
+ * the area uses every point drawn.
+ *
+ * @param *e          - void pointer to the estimator
+ * @param tolerance   - Half width of the confidence interval at which to stop, 0 for none
+ * @param timeLimit   - Seconds after which to stop, 0 for no limit
+ * @param pointLimit  - Most points to draw if neither is reached first, 0 for no limit.
+ *                      Capped at estimatorMaxPoints of the estimator
+ * @param radius      - Radius of the circle to calculate the area of.
+ * @param *pointsUsed - Set to the number of points drawn
+ * @param *error      - Set to the half width of the confidence interval reached
+ *
+ * @return double of the calculated area of the circle
+ */
+static double estimatorRunAdaptive(void *e, double tolerance, double timeLimit, uint64_t pointLimit,
+                                   double radius, uint64_t *pointsUsed, double *error){
+    Estimator *estimator = (Estimator*) e;
+    Progress progress;
+
+    if(pointLimit == 0){
+        pointLimit = PROGRESS_CHUNK_POINTS * SCHEDULER_MAX_CHUNKS;
+    }
+    if(pointLimit > estimatorMaxPoints(estimator->estimatorType)){
+        pointLimit = estimatorMaxPoints(estimator->estimatorType);
     }
 
-    double area = calculateCircleArea(pointCount, threadCount); // Calculate the area of the circle
+    progressInit(&progress, radius, estimatorUnit(estimator->estimatorType), tolerance, timeLimit);
+    estimator->radius = radius;
+    resetCirclePoints(estimator);
+    estimator->progress = &progress;
+    estimator->firstIndex = estimator->nextIndex;
+    estimator->nextIndex += randomBlockRound(pointLimit); // Chunks not handed out are skipped
+    schedulerReset(&estimator->scheduler, pointLimit, PROGRESS_CHUNK_POINTS);
+    poolRun(&estimator->pool, calculateCirclePoints, estimator);
+    recordRun(estimator);
+    estimator->progress = NULL;
 
-    // Print Results
-    printf("Number of Points = %d, Number of Threads = %d, Circle Radius = %f\n", pointCount, threadCount,radius);
-    printf("The Area of the circle is: %f\n", area);
+    *pointsUsed = progress.pointCount;
+    *error = progressError(&progress);
+    progressDestroy(&progress);
 
-    if(timer) {
-        clock_gettime(CLOCK_REALTIME, &endTime); // Get the time at the end of the algorithm
-        double elapsedTime = (endTime.tv_sec - startTime.tv_sec) + // Calculate the diff in time between start and end
-                             (endTime.tv_nsec - startTime.tv_nsec) / 1000000000.0;
-        printf("Elapsed Time: %f seconds\n", elapsedTime);
+    return estimatorArea(estimator->estimatorType, totalCirclePoints(estimator), *pointsUsed, radius);
+}
+
+/*
+ * Function: estimatorDestroy
+ * ------------------------
+ * Stops the worker threads of an estimator and frees it and their workspaces.
+ *
+ * @param *e - void pointer to the estimator to destroy
+ */
+static void estimatorDestroy(void *e){
+    Estimator *estimator = (Estimator*) e;
+    poolDestroy(&estimator->pool);
+    for(int i = 0; i < estimator->pool.threadCount; i++){
+        perfClose(&estimator->workspaces[i].perf);
+    }
+    free(estimator->workspaces);
+    schedulerDestroy(&estimator->scheduler);
+    pthread_mutex_destroy(&estimator->mutex);
+    if(estimator->instrument){
+        statsDestroy(&estimator->stats);
     }
+    free(estimator);
+}
 
-    return EXIT_SUCCESS;
+/*
+ * Function: estimatorStats
+ * ------------------------
+ * @param *e - void pointer to the estimator
+ *
+ * @return const EngineStats* of the instrumentation, NULL if not instrumented
+ */
+static const EngineStats* estimatorStats(void *e){
+    Estimator *estimator = (Estimator*) e;
+    return estimator->instrument ? &estimator->stats : NULL;
 }
+
+const EngineOps sharedEngine = {
+    .create = estimatorCreate,
+    .run = estimatorRun,
+    .runRange = estimatorRunRange,
+    .runAdaptive = estimatorRunAdaptive,
+    .destroy = estimatorDestroy,
+    .stats = estimatorStats
+};
@@ -0,0 +1,220 @@
+/* STATS.C
+ *
+ * Per thread instrumentation records and the clock they are timed with. See stats.h.
+ *
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include "stats.h"
+
+/*
+ * Function: monotonicSeconds
+ * ------------------------
+ * @return double of the current CLOCK_MONOTONIC time in seconds
+ */
+double monotonicSeconds(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1000000000.0;
+}
+
+/*
+ * Function: statsCreate
+ * ------------------------
+ * Allocates a zeroed record for every worker thread.
+ *
+ * @param *stats      - The instrumentation to create
+ * @param workerCount - Number of worker threads
+ *
+ * @return int of 1 on success, 0 if the records could not be allocated
+ */
+int statsCreate(EngineStats *stats, int workerCount){
+    stats->workerCount = workerCount;
+    stats->workers = aligned_alloc(CACHE_LINE_SIZE, sizeof(WorkerStats) * workerCount);
+    if(stats->workers == NULL){
+        return 0;
+    }
+    memset(stats->workers, 0, sizeof(WorkerStats) * workerCount);
+    return 1;
+}
+
+/*
+ * Function: statsDestroy
+ * ------------------------
+ * @param *stats - The instrumentation to free
+ */
+void statsDestroy(EngineStats *stats){
+    free(stats->workers);
+    stats->workers = NULL;
+}
+
+/*
+ * Function: statsRecordSpawn
+ * ------------------------
+ * Records how long each thread of a pool took to be created, pinned and ready.
+ *
+ * @param *stats - The instrumentation of the pool's engine
+ * @param *pool  - The pool, after its first task has finished
+ */
+void statsRecordSpawn(EngineStats *stats, const ThreadPool *pool){
+    for(int i = 0; i < pool->threadCount && i < stats->workerCount; i++){
+        stats->workers[i].spawnSeconds += pool->workers[i].ready - pool->workers[i].created;
+    }
+}
+
+/*
+ * Function: statsRecordJoin
+ * ------------------------
+ * Records how long each thread of a pool waited for the slowest thread of the task that
+ * has just finished. Called as soon as poolRun returns.
+ *
+ * @param *stats - The instrumentation of the pool's engine
+ * @param *pool  - The pool
+ */
+void statsRecordJoin(EngineStats *stats, const ThreadPool *pool){
+    double end = monotonicSeconds();
+
+    for(int i = 0; i < pool->threadCount && i < stats->workerCount; i++){
+        stats->workers[i].joinSeconds += end - pool->workers[i].finished;
+    }
+}
+
+/*
+ * Function: printRow
+ * ------------------------
+ * Prints one line of the breakdown, times in milliseconds.
+ *
+ * @param *file   - Where to print
+ * @param *label  - Thread index or "Total"
+ * @param *worker - The record to print
+ */
+static void printRow(FILE *file, const char *label, const WorkerStats *worker){
+    fprintf(file, "%6s %10.3f %12.3f %10.3f %10.3f %8" PRIu64 " %14" PRIu64 " %12" PRIu64 "\n",
+            label, worker->spawnSeconds * 1000, worker->samplingSeconds * 1000, worker->lockSeconds * 1000,
+            worker->joinSeconds * 1000, worker->chunks, worker->points, worker->lockAcquisitions);
+}
+
+/*
+ * Function: statsPrint
+ * ------------------------
+ * Prints the per thread breakdown, followed by the totals of every thread.
+ *
+ * @param *stats - The instrumentation to print
+ * @param *file  - Where to print
+ */
+void statsPrint(const EngineStats *stats, FILE *file){
+    WorkerStats total;
+    char label[16];
+
+    memset(&total, 0, sizeof(total));
+    fprintf(file, "%6s %10s %12s %10s %10s %8s %14s %12s\n", "Thread", "Spawn(ms)", "Sampling(ms)",
+            "Lock(ms)", "Join(ms)", "Chunks", "Points", "Acquisitions");
+
+    for(int i = 0; i < stats->workerCount; i++){
+        const WorkerStats *worker = &stats->workers[i];
+        snprintf(label, sizeof(label), "%d", i);
+        printRow(file, label, worker);
+
+        total.spawnSeconds += worker->spawnSeconds;
+        total.samplingSeconds += worker->samplingSeconds;
+        total.lockSeconds += worker->lockSeconds;
+        total.joinSeconds += worker->joinSeconds;
+        total.chunks += worker->chunks;
+        total.points += worker->points;
+        total.lockAcquisitions += worker->lockAcquisitions;
+    }
+    printRow(file, "Total", &total);
+}
+
+/*
+ * Function: printCounterRatio
+ * ------------------------
+ * Prints one column of the hardware counter breakdown, or n/a if a counter is missing.
+ * Ratios of counters scaled for multiplexing are marked with a *.
+ *
+ * @param *file       - Where to print
+ * @param *worker     - The record to print
+ * @param numerator   - Event counted
+ * @param denominator - Event divided by, or PERF_EVENT_COUNT to divide by the points
+ */
+static void printCounterRatio(FILE *file, const WorkerStats *worker, PerfEvent numerator, PerfEvent denominator){
+    int available = (worker->countersRead >> numerator) & 1;
+    double divisor = (double)worker->points;
+
+    if(denominator != PERF_EVENT_COUNT){
+        available &= (worker->countersRead >> denominator) & 1;
+        divisor = (double)worker->counters[denominator];
+    }
+    unsigned events = 1u << numerator | (denominator != PERF_EVENT_COUNT ? 1u << denominator : 0);
+    if(!available || divisor == 0){
+        fprintf(file, " %14s", "n/a");
+    } else if(worker->countersScaled & events){
+        fprintf(file, " %13.4f*", (double)worker->counters[numerator] / divisor);
+    } else {
+        fprintf(file, " %14.4f", (double)worker->counters[numerator] / divisor);
+    }
+}
+
+/*
+ * Function: statsPrintCounters
+ * ------------------------
+ * Prints the hardware counters of each thread and of every thread together: cycles and
+ * instructions per sample, IPC, and branch, L1 data and last level cache misses per sample.
+ *
+ * @param *stats - The instrumentation to print
+ * @param *file  - Where to print
+ */
+void statsPrintCounters(const EngineStats *stats, FILE *file){
+    WorkerStats total;
+    char label[16];
+
+    memset(&total, 0, sizeof(total));
+    total.countersRead = ~0u;
+    for(int i = 0; i < stats->workerCount; i++){
+        const WorkerStats *worker = &stats->workers[i];
+        total.points += worker->points;
+        for(int event = 0; event < PERF_EVENT_COUNT; event++){
+            total.counters[event] += worker->counters[event];
+        }
+        // Threads that calculated no points may not have opened their counters
+        if(worker->points > 0){
+            total.countersRead &= worker->countersRead;
+        }
+        total.countersScaled |= worker->countersScaled;
+    }
+    if(total.points == 0 || (total.countersRead & ((1u << PERF_EVENT_COUNT) - 1)) == 0){
+        fprintf(file, "Hardware counters unavailable: perf_event_open failed, check perf_event_paranoid "
+                      "and that the CPU (or virtual machine) exposes a PMU\n");
+        return;
+    }
+
+    fprintf(file, "%6s %14s %14s %14s %14s %14s %14s\n", "Thread", "Cycles/Sample", "Instr/Sample", "IPC",
+            "BrMiss/Sample", "L1dMiss/Sample", "LLCMiss/Sample");
+    for(int i = 0; i <= stats->workerCount; i++){
+        const WorkerStats *worker = i < stats->workerCount ? &stats->workers[i] : &total;
+        if(i < stats->workerCount){
+            snprintf(label, sizeof(label), "%d", i);
+        } else {
+            snprintf(label, sizeof(label), "Total");
+        }
+        fprintf(file, "%6s", label);
+        printCounterRatio(file, worker, PERF_CYCLES, PERF_EVENT_COUNT);
+        printCounterRatio(file, worker, PERF_INSTRUCTIONS, PERF_EVENT_COUNT);
+        printCounterRatio(file, worker, PERF_INSTRUCTIONS, PERF_CYCLES);
+        printCounterRatio(file, worker, PERF_BRANCH_MISSES, PERF_EVENT_COUNT);
+        printCounterRatio(file, worker, PERF_L1D_MISSES, PERF_EVENT_COUNT);
+        printCounterRatio(file, worker, PERF_LLC_MISSES, PERF_EVENT_COUNT);
+        fprintf(file, "\n");
+    }
+    if(total.countersScaled != 0){
+        fprintf(file, "* Multiplexed by the kernel, scaled from the time counted:");
+        for(int event = 0; event < PERF_EVENT_COUNT; event++){
+            if(total.countersScaled & (1u << event)){
+                fprintf(file, " %s", perfEventName((PerfEvent) event));
+            }
+        }
+        fprintf(file, "\n");
+    }
+}
@@ -0,0 +1,77 @@
+/* STATS.H
+ *
+ * Per thread instrumentation of the engines. Each worker thread owns a cache line aligned
+ * record of the time it spent in each phase of a run and how often it touched shared state,
+ * so recording needs no synchronisation. Records add up over every run of an engine and
+ * are printed as a per thread breakdown at exit.
+ *
+ * Phases:
+ *   spawn    - from pthread_create to the thread being pinned and ready for work
+ *   sampling - drawing points and testing them against the circle
+ *   lock     - acquiring the locks protecting shared totals
+ *   join     - waiting, after finishing, for the other threads of the run to finish
+ *
+ * Optionally, each worker also reads the hardware counters of perf.h over every task it
+ * runs, giving IPC and misses per sample.
+ *
+ */
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "topology.h"
+#include "pool.h"
+#include "perf.h"
+
+// Flags of EngineOptions.instrument
+#define INSTRUMENT_PHASES 1
+#define INSTRUMENT_COUNTERS 2
+
+/* Structure: WorkerStats
+ * Instrumentation of one worker thread, on its own cache line.
+ *
+ * @variable spawnSeconds     - Time spent being created
+ * @variable samplingSeconds  - Time spent drawing and testing points
+ * @variable lockSeconds      - Time spent acquiring locks
+ * @variable joinSeconds      - Time spent waiting for the other threads to finish
+ * @variable chunks           - Number of chunks calculated
+ * @variable points           - Number of points calculated
+ * @variable lockAcquisitions - Number of mutex acquisitions (atomic adds for lock free totals)
+ * @variable counters         - Hardware counter totals, indexed by PerfEvent
+ * @variable countersRead     - Bit (1 << event) set for each counter that could be read
+ * @variable countersScaled   - Bit (1 << event) set for each counter scaled for multiplexing
+ */
+typedef struct WorkerStatsStruct{
+    _Alignas(CACHE_LINE_SIZE) double spawnSeconds;
+    double samplingSeconds;
+    double lockSeconds;
+    double joinSeconds;
+    uint64_t chunks;
+    uint64_t points;
+    uint64_t lockAcquisitions;
+    uint64_t counters[PERF_EVENT_COUNT];
+    unsigned countersRead;
+    unsigned countersScaled;
+}WorkerStats;
+
+/* Structure: EngineStats
+ * Instrumentation of every worker thread of an engine.
+ *
+ * @variable workerCount - Number of worker threads
+ * @variable *workers    - Record of each worker thread
+ */
+typedef struct EngineStatsStruct{
+    int workerCount;
+    WorkerStats *workers;
+}EngineStats;
+
+double monotonicSeconds(void);
+int statsCreate(EngineStats *stats, int workerCount);
+void statsDestroy(EngineStats *stats);
+void statsRecordSpawn(EngineStats *stats, const ThreadPool *pool);
+void statsRecordJoin(EngineStats *stats, const ThreadPool *pool);
+void statsPrint(const EngineStats *stats, FILE *file);
+void statsPrintCounters(const EngineStats *stats, FILE *file);
+
+#endif //STATS_H
@@ -0,0 +1,115 @@
+#!/bin/sh
+# CLI_TEST.SH
+#
+# End to end checks of OS2_Coursework and shardmerge, run by ctest. Each check compares
+# the Result line, seed:firstPoint:points:score, of runs that must give the same points.
+#
+# Usage: cli_test.sh <check> <OS2_Coursework> <shardmerge> <scratch directory>
+#   threads    - -t 1 and -t 4 of every engine, estimator and generator, and every strategy
+#                and sequence, give the result of the serial engine
+#   checkpoint - a run killed and resumed from its checkpoint gives the uninterrupted result
+#   extend     - a result extended with -X gives the result of a direct run of the larger count
+#   shard      - contiguous shards merge to the result of one run, overlapping ones are rejected
+#   cluster    - a coordinator and its forked workers give the result of one process
+
+check=$1
+program=$2
+shardmerge=$3
+scratch=$4
+seed=20240917
+points=1000003
+
+mkdir -p "$scratch" || exit 1
+
+# Prints the Result line of a run
+result(){
+    "$program" -S "$seed" "$@" | grep '^Result = '
+}
+
+# Fails the check if the two results differ
+same(){
+    if [ -z "$1" ] || [ "$1" != "$2" ]; then
+        echo "FAIL: $3: '$2', expected '$1'" >&2
+        exit 1
+    fi
+    echo "ok: $3"
+}
+
+case "$check" in
+    threads)
+        for generator in xoshiro philox; do
+            for estimator in hit stratified antithetic mean; do
+                expected=$(result -m serial -g "$generator" -E "$estimator" -p "$points")
+                for engine in sharded shared; do
+                    for threads in 1 4; do
+                        same "$expected" "$(result -m "$engine" -t "$threads" -g "$generator" -E "$estimator" \
+                                            -p "$points")" "$engine -t $threads -g $generator -E $estimator"
+                    done
+                done
+            done
+        done
+        expected=$(result -m serial -p "$points")
+        for strategy in mutex atomic batched sharded; do
+            same "$expected" "$(result -m shared -t 4 -s "$strategy" -p "$points")" "shared -t 4 -s $strategy"
+        done
+        for sequence in r2 halton sobol; do
+            expected=$(result -m serial -q "$sequence" -p "$points")
+            for engine in sharded shared; do
+                same "$expected" "$(result -m "$engine" -t 4 -q "$sequence" -p "$points")" "$engine -t 4 -q $sequence"
+            done
+        done
+        ;;
+    checkpoint)
+        # Long enough to be killed after a few saves
+        points=2000000000
+        rm -f "$scratch/run.checkpoint" "$scratch/run.checkpoint.tmp"
+        "$program" -S "$seed" -t 2 -p "$points" -C "$scratch/run.checkpoint" -I 0.05 > /dev/null &
+        pid=$!
+        waited=0
+        while [ ! -s "$scratch/run.checkpoint" ] && [ "$waited" -lt 100 ]; do
+            sleep 0.1
+            waited=$((waited + 1))
+        done
+        sleep 0.2
+        kill -9 "$pid" 2> /dev/null
+        wait "$pid" 2> /dev/null
+        [ -s "$scratch/run.checkpoint" ] || { echo "FAIL: no checkpoint was saved" >&2; exit 1; }
+        same "$(result -t 2 -p "$points")" "$(result -t 2 -p "$points" -C "$scratch/run.checkpoint")" \
+             "resumed from a killed run"
+        ;;
+    extend)
+        for estimator in hit mean; do
+            prior=$(result -E "$estimator" -p 200003 | cut -d ' ' -f 3)
+            same "$(result -E "$estimator" -p "$points")" "$(result -E "$estimator" -p "$points" -X "$prior")" \
+                 "-E $estimator extended from 200003 points"
+        done
+        prior=$(result -P float -p 200003 | cut -d ' ' -f 3)
+        same "$(result -P float -p "$points")" "$(result -P float -p "$points" -X "$prior")" "-P float extended"
+        ;;
+    shard)
+        # Two contiguous shards of 10 and 7 blocks, then one overlapping the first
+        "$program" -S "$seed" -F 0 -p 655360 -O "$scratch/first.json" > /dev/null || exit 1
+        "$program" -S "$seed" -F 655360 -p 458752 -O "$scratch/second.shard" > /dev/null || exit 1
+        "$program" -S "$seed" -F 327680 -p 458752 -O "$scratch/overlap.json" > /dev/null || exit 1
+        same "$(result -p 1114112)" "$("$shardmerge" "$scratch/second.shard" "$scratch/first.json" | grep '^Result = ')" \
+             "merged contiguous shards"
+        if "$shardmerge" "$scratch/first.json" "$scratch/overlap.json" > /dev/null 2>&1; then
+            echo "FAIL: overlapping shards were merged" >&2
+            exit 1
+        fi
+        echo "ok: overlapping shards rejected"
+        ;;
+    cluster)
+        # Three ranges of CLUSTER_RANGE_POINTS, the last one partial
+        points=40000003
+        expected=$(result -p "$points")
+        for workers in 1 3; do
+            same "$expected" "$(result -t 1 -p "$points" -L "$scratch/coordinator.sock" -N "$workers")" \
+                 "coordinator with $workers workers"
+        done
+        ;;
+    *)
+        echo "Unknown check: $check" >&2
+        exit 1
+        ;;
+esac
@@ -0,0 +1,126 @@
+/* KERNEL_TEST.C
+ *
+ * Checks every sampling kernel the CPU supports against a plain scalar reference built
+ * from the hit tests of kernel.h. Each kernel, in both precisions and both variants (the
+ * unit circle and any radius), must count exactly the points the reference counts on the
+ * same stream, in total and batch by batch.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include "kernel.h"
+#include "random.h"
+
+// Points drawn by each check, not a whole number of batches so the last one is partial
+#define TEST_POINTS 100003
+#define TEST_BATCHES ((TEST_POINTS + RANDOM_LANES - 1) / RANDOM_LANES)
+#define TEST_SEED 20240917
+
+static const KernelType testKernels[] = {KERNEL_SCALAR, KERNEL_SSE2, KERNEL_AVX2, KERNEL_AVX512, KERNEL_FIXED};
+static const Precision testPrecisions[] = {PRECISION_DOUBLE, PRECISION_FLOAT};
+static const double testRadii[] = {1.0, 2.5};
+
+/*
+ * Function: referenceCount
+ * ------------------------
+ * Counts the points inside the circle one lane at a time, as the scalar kernels describe:
+ * every batch draws from all RANDOM_LANES lanes, and only the lanes of the points asked
+ * for are counted.
+ *
+ * @param *stream       - The xoshiro256** stream to draw points from
+ * @param type          - The kernel whose points are counted, only KERNEL_FIXED differs
+ * @param precision     - PRECISION_DOUBLE or PRECISION_FLOAT
+ * @param radius        - Radius of the circle
+ * @param *batchCircles - Set to the number of points inside the circle of each batch
+ *
+ * @return uint64_t of the number of points inside the circle
+ */
+static uint64_t referenceCount(RandomStream *stream, KernelType type, Precision precision, double radius,
+                               uint32_t *batchCircles){
+    uint64_t circlePoints = 0;
+
+    for(uint64_t i = 0; i < TEST_POINTS; i += RANDOM_LANES){
+        uint32_t batchCirclePoints = 0;
+        for(int lane = 0; lane < RANDOM_LANES; lane++){
+            int inside;
+            if(type == KERNEL_FIXED){
+                inside = (int) isInCircleFixed(xoshiroLaneNext(stream->state, lane));
+            } else if(precision == PRECISION_FLOAT){
+                inside = isInCircleFloat((float) radius, (float)(radius * radius), xoshiroLaneNext(stream->state, lane));
+            } else {
+                double x = randomBitsToCoordinate(xoshiroLaneNext(stream->state, lane)) * radius;
+                double y = randomBitsToCoordinate(xoshiroLaneNext(stream->state, lane)) * radius;
+                inside = isInCircle(radius * radius, x, y);
+            }
+            batchCirclePoints += i + (uint64_t) lane < TEST_POINTS && inside;
+        }
+        batchCircles[i / RANDOM_LANES] = batchCirclePoints;
+        circlePoints += batchCirclePoints;
+    }
+    return circlePoints;
+}
+
+/*
+ * Function: checkKernel
+ * ------------------------
+ * Compares the selected kernel with the reference, through countCirclePoints (the unit
+ * circle variant when the radius is 1, the scaled one otherwise) and through
+ * countCirclePointsBatches.
+ *
+ * @param type      - The selected kernel
+ * @param precision - The selected precision
+ * @param radius    - Radius of the circle
+ *
+ * @return int of 1 if the counts match, otherwise returns 0
+ */
+static int checkKernel(KernelType type, Precision precision, double radius){
+    static uint32_t expectedBatches[TEST_BATCHES], batches[TEST_BATCHES];
+    RandomStream stream;
+
+    randomSeed(&stream, RANDOM_XOSHIRO, TEST_SEED, 0);
+    uint64_t expected = referenceCount(&stream, type, precision, radius, expectedBatches);
+
+    randomSeed(&stream, RANDOM_XOSHIRO, TEST_SEED, 0);
+    uint64_t total = countCirclePoints(&stream, radius, TEST_POINTS);
+
+    randomSeed(&stream, RANDOM_XOSHIRO, TEST_SEED, 0);
+    uint64_t batchTotal = countCirclePointsBatches(&stream, radius, TEST_POINTS, batches);
+
+    int matched = total == expected && batchTotal == expected;
+    for(uint64_t batch = 0; batch < TEST_BATCHES; batch++){
+        matched = matched && batches[batch] == expectedBatches[batch];
+    }
+    if(!matched){
+        fprintf(stderr, "Kernel %s, precision %s, radius %f: %" PRIu64 " and %" PRIu64 " in batches, expected %"
+                PRIu64 "\n", kernelTypeName(type), precisionName(precision), radius, total, batchTotal, expected);
+    }
+    return matched;
+}
+
+/*
+ * Function: main
+ * ------------------------
+ * Checks every supported kernel, precision and radius.
+ *
+ * @return int of EXIT_SUCCESS if every kernel matches the reference, otherwise EXIT_FAILURE
+ */
+int main(void){
+    int checks = 0, failures = 0;
+
+    for(size_t k = 0; k < sizeof(testKernels) / sizeof(testKernels[0]); k++){
+        if(!kernelSupported(testKernels[k])){
+            printf("Kernel %s not supported, skipped\n", kernelTypeName(testKernels[k]));
+            continue;
+        }
+        for(size_t p = 0; p < sizeof(testPrecisions) / sizeof(testPrecisions[0]); p++){
+            kernelSelect(testKernels[k], testPrecisions[p]);
+            for(size_t r = 0; r < sizeof(testRadii) / sizeof(testRadii[0]); r++){
+                failures += !checkKernel(testKernels[k], testPrecisions[p], testRadii[r]);
+                checks++;
+            }
+        }
+    }
+    printf("%d of %d kernel checks passed\n", checks - failures, checks);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,250 @@
+/* TOPOLOGY.C
+ *
+ * Builds the order in which CPUs are handed to worker threads for each affinity policy.
+ * On Linux the NUMA node of each CPU is read from /sys/devices/system/node. On other
+ * systems, or if sysfs is not available, every CPU is treated as being on node 0 and
+ * threads are not pinned.
+ *
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+#include "topology.h"
+
+// Highest number of NUMA nodes looked for in sysfs
+#define MAX_NODES 64
+// Highest number of CPUs handled
+#define MAX_CPUS 1024
+
+static int compactOrder[MAX_CPUS];
+static int scatterOrder[MAX_CPUS];
+static int availableCpus = 0;
+static int nodeOf[MAX_CPUS];
+static int nodeCount = 1;
+static pthread_once_t topologyOnce = PTHREAD_ONCE_INIT;
+
+static const char *affinityNames[] = {
+    [AFFINITY_NONE] = "none",
+    [AFFINITY_COMPACT] = "compact",
+    [AFFINITY_SCATTER] = "scatter"
+};
+
+#ifdef __linux__
+/*
+ * Function: readNodeCpus
+ * ------------------------
+ * Reads the cpulist file of a NUMA node, e.g. "0-7,16-23", and records the node of
+ * each CPU listed.
+ *
+ * @param node - The NUMA node to read
+ *
+ * @return int of 1 if the node exists, otherwise returns 0
+ */
+static int readNodeCpus(int node){
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+
+    FILE *file = fopen(path, "r");
+    if(file == NULL){
+        return 0;
+    }
+
+    int first, last;
+    while(fscanf(file, "%d", &first) == 1){
+        last = first;
+        int c = fgetc(file);
+        if(c == '-'){
+            if(fscanf(file, "%d", &last) != 1){
+                break;
+            }
+            c = fgetc(file);
+        }
+        for(int cpu = first; cpu <= last && cpu < MAX_CPUS; cpu++){
+            nodeOf[cpu] = node;
+        }
+        if(c != ','){
+            break;
+        }
+    }
+
+    fclose(file);
+    return 1;
+}
+#endif
+
+/*
+ * Function: buildTopology
+ * ------------------------
+ * Builds the compact and scatter CPU orders from the CPUs this process may run on.
+ * Run once, the first time a thread is pinned.
+ */
+static void buildTopology(void){
+#ifdef __linux__
+    for(int node = 0; node < MAX_NODES; node++){
+        if(readNodeCpus(node)){
+            nodeCount = node + 1;
+        }
+    }
+
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if(sched_getaffinity(0, sizeof(allowed), &allowed) != 0){
+        perror("Error reading CPU affinity: ");
+        return;
+    }
+
+    // Compact: every CPU of node 0, then node 1, ...
+    for(int node = 0; node < nodeCount; node++){
+        for(int cpu = 0; cpu < MAX_CPUS && cpu < CPU_SETSIZE; cpu++){
+            if(CPU_ISSET(cpu, &allowed) && nodeOf[cpu] == node){
+                compactOrder[availableCpus++] = cpu;
+            }
+        }
+    }
+
+    // Scatter: the first CPU of each node, then the second CPU of each node, ...
+    int taken[MAX_NODES] = {0};
+    int scattered = 0;
+    while(scattered < availableCpus){
+        for(int node = 0; node < nodeCount; node++){
+            int seen = 0;
+            for(int i = 0; i < availableCpus; i++){
+                if(nodeOf[compactOrder[i]] == node && seen++ == taken[node]){
+                    scatterOrder[scattered++] = compactOrder[i];
+                    taken[node]++;
+                    break;
+                }
+            }
+        }
+    }
+#else
+    availableCpus = (int) sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+}
+
+/*
+ * Function: pinThread
+ * ------------------------
+ * Pins the calling thread to a CPU chosen by the affinity policy. Threads beyond the
+ * number of available CPUs wrap around.
+ *
+ * @param affinity    - The affinity policy
+ * @param threadIndex - Index of the calling worker thread
+ *
+ * @return int of the CPU the thread was pinned to, or -1 if it was not pinned
+ */
+int pinThread(Affinity affinity, int threadIndex){
+    pthread_once(&topologyOnce, buildTopology);
+
+#ifdef __linux__
+    if(affinity == AFFINITY_NONE || availableCpus == 0){
+        return -1;
+    }
+
+    int *order = affinity == AFFINITY_SCATTER ? scatterOrder : compactOrder;
+    int cpu = order[threadIndex % availableCpus];
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if(pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0){
+        return -1;
+    }
+    return cpu;
+#else
+    (void) affinity;
+    (void) threadIndex;
+    return -1;
+#endif
+}
+
+/*
+ * Function: cpuCount
+ * ------------------------
+ * @return int of the number of CPUs this process may run on
+ */
+int cpuCount(void){
+    pthread_once(&topologyOnce, buildTopology);
+    return availableCpus > 0 ? availableCpus : 1;
+}
+
+/*
+ * Function: numaNodeCount
+ * ------------------------
+ * @return int of the number of NUMA nodes, 1 if the layout is not known
+ */
+int numaNodeCount(void){
+    pthread_once(&topologyOnce, buildTopology);
+    return nodeCount;
+}
+
+/*
+ * Function: pinProcessToNode
+ * ------------------------
+ * Restricts the calling thread, and every thread it creates afterwards, to the CPUs of a
+ * NUMA node it may run on. Called by a process before it starts its worker threads, which
+ * then stay on the node without being pinned one by one.
+ *
+ * @param node - The NUMA node
+ *
+ * @return int of the number of CPUs of the node the process now runs on, 0 if it was not pinned
+ */
+int pinProcessToNode(int node){
+    pthread_once(&topologyOnce, buildTopology);
+
+#ifdef __linux__
+    cpu_set_t set;
+    int cpus = 0;
+    CPU_ZERO(&set);
+    for(int i = 0; i < availableCpus; i++){
+        if(nodeOf[compactOrder[i]] == node){
+            CPU_SET(compactOrder[i], &set);
+            cpus++;
+        }
+    }
+    if(cpus == 0 || sched_setaffinity(0, sizeof(set), &set) != 0){
+        return 0;
+    }
+    return cpus;
+#else
+    (void) node;
+    return 0;
+#endif
+}
+
+/*
+ * Function: affinityFromName
+ * ------------------------
+ * Converts an affinity policy name given on the command line into an Affinity.
+ *
+ * @param *name     - "none", "compact" or "scatter"
+ * @param *affinity - Set to the matching policy
+ *
+ * @return int of 1 if the name is known, otherwise returns 0
+ */
+int affinityFromName(const char *name, Affinity *affinity){
+    for(int i = 0; i < (int)(sizeof(affinityNames) / sizeof(affinityNames[0])); i++){
+        if(strcmp(name, affinityNames[i]) == 0){
+            *affinity = (Affinity) i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Function: affinityName
+ * ------------------------
+ * @param affinity - The affinity policy
+ *
+ * @return const char* of the name of the policy
+ */
+const char* affinityName(Affinity affinity){
+    return affinityNames[affinity];
+}
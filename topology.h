@@ -0,0 +1,33 @@
+/* TOPOLOGY.H
+ *
+ * CPU topology helpers: pinning worker threads to CPUs, or a worker process to a NUMA
+ * node, and the cache line size used to pad per-thread data.
+ *
+ */
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+// Size of a cache line, per-thread data is aligned to this to avoid false sharing
+#define CACHE_LINE_SIZE 64
+
+/* Enum: Affinity
+ * How worker threads are pinned to CPUs.
+ *
+ * AFFINITY_NONE    - Threads are not pinned, the scheduler places them
+ * AFFINITY_COMPACT - Thread i runs on the i-th available CPU, filling one NUMA node first
+ * AFFINITY_SCATTER - Threads are spread round robin over the NUMA nodes
+ */
+typedef enum AffinityEnum{
+    AFFINITY_NONE,
+    AFFINITY_COMPACT,
+    AFFINITY_SCATTER
+}Affinity;
+
+int pinThread(Affinity affinity, int threadIndex);
+int cpuCount(void);
+int numaNodeCount(void);
+int pinProcessToNode(int node);
+int affinityFromName(const char *name, Affinity *affinity);
+const char* affinityName(Affinity affinity);
+
+#endif //TOPOLOGY_H